@@ -5,6 +5,8 @@
 #include <utility>
 #include <exception>
 #include "FA.hpp"
+#include "edge_map.hpp"
+#include "arena.hpp"
 #include <functional>
 #include <iostream>
 #include <iterator>
@@ -95,9 +97,10 @@ template <typename N, typename V>
 class DFA : public FA<N, V>{
 protected:
     N start; bool start_flag{false};
-    std::unordered_map< N, dfa_node<N> > name_map;
-    std::unordered_map< N, std::unordered_map< V, N > > edge_map;
-    std::unordered_set<V> alphabet;
+    fa_map< N, dfa_node<N> > name_map;
+    fa_map< N, edge_map_t< V, N > > edge_map;
+    fa_map< N, N > default_map; // the "otherwise" transition of each state (if any)
+    fa_set<V> alphabet;
 
     void create_dfa(N node){
         if(!this->name_map.count(node)){ // create the node if it doesn't exist
@@ -105,15 +108,24 @@ protected:
             this->name_map[node] = df;
         }
     }
+
+    // Returns the target of the edge (or NULL if it does not exist). Falls back to the default transition
+    // when the node has no explicit edge for the value.
+    const N* step(const N& node, V val){
+        auto it = this->edge_map.find(node);
+        const N* target = (it == this->edge_map.end() ? NULL : edge_lookup(it->second, val));
+        if(target == NULL && !this->default_map.empty()){
+            auto def = this->default_map.find(node);
+            if(def != this->default_map.end()) target = &def->second;
+        }
+        return target;
+    }
 public:
     /**
      * @brief Construct a new DFA object
      * 
      */
-    DFA(){
-        this->name_map = std::unordered_map< N, dfa_node<N> >();
-        this->edge_map = std::unordered_map< N, std::unordered_map< V, N > >();
-    }
+    DFA(){}
 
     /**
      * @brief Destroy the DFA object
@@ -152,7 +164,47 @@ public:
     }
 
     /**
-     * @brief Checks if the transition exists on the given node. 
+     * @brief Adds a default ("otherwise") transition from the first node to the second node. The default
+     * transition is taken for every value that does not have an explicit transition out of the first node.
+     * 
+     * @param node1 the first node.
+     * @param node2 the second node.
+     */
+    void add_default_transition(N node1, N node2) {
+        this->create_dfa(node1);
+        this->create_dfa(node2);
+
+        this->default_map[node1] = node2;
+    }
+
+    /**
+     * @brief Does the given node have a default transition?
+     * 
+     * @param node the name of the node.
+     * @return true if the node has a default transition.
+     * @return false if the node does not have a default transition.
+     */
+    bool has_default_transition(N node) {
+        return this->default_map.count(node);
+    }
+
+    /**
+     * @brief Returns the target of the default transition of the given node. This function errors if the node
+     * does not have a default transition.
+     * 
+     * @param node the name of the node.
+     * @return N the state after taking the default transition.
+     */
+    N default_state(N node) {
+        auto it = this->default_map.find(node);
+        if(it == this->default_map.end())
+            throw std::runtime_error("The default transition does not exist!");
+        return it->second;
+    }
+
+    /**
+     * @brief Checks if the transition exists on the given node (either explicitly or through the default
+     * transition). 
      * 
      * @param node the name of the node.
      * @param val the value that represents the state transition.
@@ -160,7 +212,7 @@ public:
      * @return false if the transition does not exist.
      */
     bool has_transition(N node, V val) override {
-        return this->name_map.count(node) && this->edge_map[node].count(val);
+        return this->step(node, val) != NULL;
     }
 
 
@@ -183,6 +235,44 @@ public:
         this->name_map[node].set_accept(true);
     }
 
+    /**
+     * @brief Removes a final state from this DFA (the node becomes a reject node).
+     * 
+     * @param node the name of the node.
+     */
+    void remove_final_state(N node) {
+        if(!this->name_map.count(node))
+            throw std::runtime_error("The node was not set!");
+        this->name_map[node].set_accept(false);
+    }
+
+    /**
+     * @brief Removes the explicit transition out of the given node with the given value (if it exists).
+     * 
+     * @param node the name of the node.
+     * @param val the value of the transition.
+     */
+    void remove_transition(N node, V val) {
+        auto it = this->edge_map.find(node);
+        if(it == this->edge_map.end()) return;
+        it->second.erase(val);
+        if(it->second.empty()) this->edge_map.erase(it);
+    }
+
+    /**
+     * @brief Removes the given node and all of its out transitions. Transitions into the node must be
+     * removed by the caller, and the start node cannot be removed.
+     * 
+     * @param node the name of the node.
+     */
+    void remove_state(N node) {
+        if(this->start_flag && node == this->start)
+            throw std::runtime_error("Cannot remove the start!");
+        this->name_map.erase(node);
+        this->edge_map.erase(node);
+        this->default_map.erase(node);
+    }
+
     /**
      * @brief Returns the states (also known as states) in the DFA.
      * 
@@ -196,6 +286,26 @@ public:
         return ret;
     }
 
+    /**
+     * @brief Calls `f(state)` for every state, without copying the states into a set (see `states`).
+     *
+     * @tparam F a callable (const N&).
+     * @param f the callback.
+     */
+    template <class F>
+    void for_each_state(F f) {
+        for(auto& vertex : this->name_map) f(vertex.first);
+    }
+
+    /**
+     * @brief The number of explicit transitions (not counting the default transitions).
+     */
+    size_t edge_count() const {
+        size_t ret = 0;
+        for(auto& v : this->edge_map) ret += v.second.size();
+        return ret;
+    }
+
     /**
      * @brief Returns the out transitions from the given state/node. 
      * 
@@ -217,6 +327,21 @@ public:
         return ret;
     }
 
+    /**
+     * @brief Calls `f(val, state)` for every explicit out transition of the given node, without copying the
+     * transitions into a set (see `transitions`).
+     *
+     * @tparam F a callable (V, const N&).
+     * @param node the name of the state/node.
+     * @param f the callback.
+     */
+    template <class F>
+    void for_each_transition(const N& node, F f) {
+        auto it = this->edge_map.find(node);
+        if(it == this->edge_map.end()) return;
+        for(auto& e : it->second) f(e.first, e.second);
+    }
+
     /**
      * @brief Returns the state after starting at the given state and taking the specified state transition.
      * This function errors if the node was not set, or if the edge does not exist.
@@ -226,11 +351,13 @@ public:
      * @return N the state after taking the transition
      */
     N next_state(N node, V val) override {
-        if(!this->name_map.count(node))
-            throw std::runtime_error("The node was not set!");
-        if(!this->edge_map[node].count(val))
+        const N* target = this->step(node, val);
+        if(target == NULL){
+            if(!this->name_map.count(node))
+                throw std::runtime_error("The node was not set!");
             throw std::runtime_error("The edge does not exist!");
-        return this->edge_map[node][val];
+        }
+        return *target;
     }
 
     /**
@@ -285,10 +412,11 @@ public:
     bool run(it begin, it end) {
         N st = this->start;
         while(begin != end){
-            if(!this->has_transition(st, *begin)){
+            const N* target = this->step(st, *begin);
+            if(target == NULL){
                 return false;
             }
-            st = this->next_state(st, *begin);
+            st = *target;
             ++begin;
         }
         return this->is_accept(st);
@@ -320,10 +448,11 @@ public:
     N follow(it begin, it end) {
         N st = this->start;
         while(begin != end){
-            if(!this->has_transition(st, *begin)){
+            const N* target = this->step(st, *begin);
+            if(target == NULL){
                 throw std::runtime_error("...");
             }
-            st = this->next_state(st, *begin);
+            st = *target;
             ++begin;
         }
         return st;
@@ -352,27 +481,50 @@ public:
          * - run DFS on the first DFA; 
          * - if the transition exists, then add the pair of states to the 
          * stack
+         * - values that only the second DFA has an explicit edge for can still be taken through
+         * the default transition of the first DFA, and if both states have a default transition, 
+         * then so does the pair.
          */
 
         DFA<std::pair<N,N>,V> new_dfa;
         new_dfa.add_start({dfa1.get_start(),dfa2.get_start()});
-        std::vector<std::pair<N, N> > stk{{dfa1.get_start(), dfa2.get_start()}};
-        std::unordered_set<std::pair<N,N> > seen{};
+        fa_vector<std::pair<N, N> > stk{{dfa1.get_start(), dfa2.get_start()}};
+        fa_set<std::pair<N,N> > seen{};
+        auto visit = [&](const std::pair<N,N>& next, V transition, const N* t1, const N* t2){
+            std::pair<N,N> next_state = {*t1, *t2};
+            new_dfa.add_transition(next, transition, next_state);
+            if(dfa1.is_accept(next_state.first) && dfa2.is_accept(next_state.second)) new_dfa.add_final_state(next_state);
+            if(!seen.count(next_state)) stk.push_back(next_state);
+        };
         while(stk.size()){
             std::pair<N,N> next = stk.back(); stk.pop_back();
             if(seen.count(next)) continue;
             if(dfa1.is_accept(next.first) && dfa2.is_accept(next.second))
                 new_dfa.add_final_state(next);
             seen.insert(next); // add the state to the seen states.
-            for(auto pts : dfa1.transitions(next.first)){
-                V transition = pts.first;
-                if(dfa2.has_transition(next.second, transition)){
-                    std::pair<N,N> next_state = {dfa1.next_state(next.first, transition), dfa2.next_state(next.second, transition)};
-                    new_dfa.add_transition(next, transition, next_state);
-                    if(dfa1.is_accept(next_state.first) && dfa2.is_accept(next_state.second)) new_dfa.add_final_state(next_state);
-                    stk.push_back(next_state);
+            auto e1 = dfa1.edge_map.find(next.first);
+            if(e1 != dfa1.edge_map.end()){
+                for(auto pts : e1->second){
+                    const N* t2 = dfa2.step(next.second, pts.first);
+                    if(t2 != NULL) visit(next, pts.first, &pts.second, t2);
                 }
             }
+            auto d1 = dfa1.default_map.find(next.first);
+            if(d1 == dfa1.default_map.end()) continue;
+            auto e2 = dfa2.edge_map.find(next.second);
+            if(e2 != dfa2.edge_map.end()){
+                for(auto pts : e2->second){
+                    if(e1 != dfa1.edge_map.end() && e1->second.count(pts.first)) continue;
+                    visit(next, pts.first, &d1->second, &pts.second);
+                }
+            }
+            auto d2 = dfa2.default_map.find(next.second);
+            if(d2 != dfa2.default_map.end()){
+                std::pair<N,N> next_state = {d1->second, d2->second};
+                new_dfa.add_default_transition(next, next_state);
+                if(dfa1.is_accept(next_state.first) && dfa2.is_accept(next_state.second)) new_dfa.add_final_state(next_state);
+                if(!seen.count(next_state)) stk.push_back(next_state);
+            }
         }
         return new_dfa;
     }
@@ -393,30 +545,42 @@ public:
     }
 
     /**
-     * @brief Run a simple DFS algorithm on this DFA to find some of the
-     * accept paths (does not find cycle paths). Assume that the DFA is a DAG.
+     * @brief Run a simple DFS algorithm on this DFA to find all of the accept paths (does not 
+     * find cycle paths). The DFA may share states between paths (ie. it may be a DAG rather than 
+     * a tree); only states that can still reach an accept state are walked.
      * 
      * @return std::unordered_set<std::vector<V> > all of the accepts paths.
      */
     std::unordered_set<std::vector<V> > accept_paths(){
         std::unordered_set<std::vector<V> > paths;
-        std::unordered_map<N, N> parent;
-        for(N state : this->states()){
-            for(auto pts : this->transitions(state)){
-                parent[pts.second] = state;
+        fa_map<N, bool> live;   // can an accept state be reached from the state?
+        std::function<bool(const N&)> is_live = [&](const N& state){
+            auto it = live.find(state);
+            if(it != live.end()) return it->second;
+            live[state] = false; // guards against cycles
+            bool ret = this->is_accept(state);
+            auto edges = this->edge_map.find(state);
+            if(edges != this->edge_map.end()){
+                for(auto e : edges->second) ret = is_live(e.second) || ret;
             }
-        }
-        std::unordered_set<N> accepts = this->accept_states();
-        for(N ac : accepts){
-            N cur = ac;
-            std::list<V> path;
-            while(cur != this->get_start()){
-                // std::cout << "Looking for " << parent[cur] << " -> " << cur;
-                path.push_front(this->get_transition(parent[cur], cur));
-                cur = parent[cur];
+            return live[state] = ret;
+        };
+        std::vector<V> path;
+        fa_set<N> on_path;
+        std::function<void(const N&)> walk = [&](const N& state){
+            if(this->is_accept(state)) paths.insert(path);
+            auto edges = this->edge_map.find(state);
+            if(edges == this->edge_map.end()) return;
+            on_path.insert(state);
+            for(auto e : edges->second){
+                if(on_path.count(e.second) || !is_live(e.second)) continue;
+                path.push_back(e.first);
+                walk(e.second);
+                path.pop_back();
             }
-            paths.insert(std::vector<V>(path.begin(), path.end()));
-        }
+            on_path.erase(state);
+        };
+        if(is_live(this->get_start())) walk(this->get_start());
         return paths;
     }
 
@@ -443,7 +607,7 @@ public:
     static DFA<ll, TP> compress_dfa(DFA<NP,TP>& dfa) {
         DFA<ll, TP> comp_dfa = DFA<ll,TP>();
         ll vertex_id = 0;
-        std::unordered_map<NP, ll> m = std::unordered_map<NP, ll>();
+        fa_map<NP, ll> m;
         for(NP vertex : dfa.states()){
             m[vertex] = vertex_id++;
         }
@@ -451,11 +615,13 @@ public:
             for(auto edge : dfa.transitions(vertex)){
                 comp_dfa.add_transition(m[vertex], edge.first, m[edge.second]);
             }
+            if(dfa.has_default_transition(vertex))
+                comp_dfa.add_default_transition(m[vertex], m[dfa.default_state(vertex)]);
         }
+        comp_dfa.add_start(m[dfa.get_start()]);
         for(NP vertex : dfa.states()){
             if(dfa.is_accept(vertex)) comp_dfa.add_final_state(m[vertex]);
         }
-        comp_dfa.add_start(m[dfa.get_start()]);
         return comp_dfa;
     }
 
@@ -465,14 +631,54 @@ public:
      * @return std::unordered_set<char> 
      */
     std::unordered_set<char> get_alphabet(){
-        return this->alphabet;
+        return std::unordered_set<char>(this->alphabet.begin(), this->alphabet.end());
+    }
+
+    /**
+     * @brief The estimated heap used by the DFA, by component (see memory_usage.hpp). The state table keeps the name
+     * of every state twice (as the key and in its node), and the accept flag of a state is the rest of its node.
+     *
+     * @return memory_usage_t the bytes.
+     */
+    memory_usage_t memory_usage() const {
+        memory_usage_t ret;
+        size_t table = hash_table_bytes(this->name_map);
+        ret.accept = this->name_map.size() * (sizeof(dfa_node<N>) - sizeof(N));
+        ret.states = table - ret.accept;
+        for(auto& vertex : this->name_map) ret.states += 2 * heap_bytes(vertex.first);
+        ret.edges = hash_table_bytes(this->edge_map);
+        for(auto& v : this->edge_map){
+            ret.edges += heap_bytes(v.first) + edge_heap_bytes(v.second);
+            for(auto& e : v.second) ret.edges += heap_bytes(e.second);
+        }
+        ret.defaults = hash_table_bytes(this->default_map);
+        ret.alphabet = hash_table_bytes(this->alphabet);
+        return ret;
+    }
+
+    /**
+     * @brief Relabels every transition in this DFA with the given function. State names are kept, and the
+     * function must be injective over the alphabet of this DFA.
+     * 
+     * @tparam F a callable from V to V.
+     * @param f the relabeling function.
+     */
+    template <class F>
+    void relabel(F f){
+        for(auto& v : this->edge_map){
+            edge_map_t< V, N > relabeled;
+            for(auto e : v.second){
+                relabeled[f(e.first)] = e.second;
+            }
+            v.second = relabeled;
+        }
+        fa_set<V> relabeled_alphabet;
+        for(V val : this->alphabet) relabeled_alphabet.insert(f(val));
+        this->alphabet = relabeled_alphabet;
     }
 
     friend std::ostream& operator<<(std::ostream& os, const DFA<N, V>& dt);
     friend std::istream& operator>>(std::istream& os, const DFA<N, V>& dt);
-
-    friend std::ostream& serialize(std::ostream& os, DFA<N, V>& dt);
-    friend std::istream& deserialize(std::istream& os, DFA<N, V>& dt);
 };
 
 // Standard output for compressed DFA:
@@ -488,6 +694,9 @@ std::ostream& operator<<(std::ostream& out, const DFA<long long, char>& dfa) {
         }
         out << "\n";
     }
+    for(auto d : dfa.default_map){
+        out << d.first << ": (*, " << d.second << ")\n";
+    }
     return out;
 }
 
@@ -503,5 +712,8 @@ std::ostream& operator<<(std::ostream& out, const DFA<std::string, char>& dfa) {
         }
         out << "\n";
     }
+    for(auto d : dfa.default_map){
+        out << d.first << ": (*, " << d.second << ")\n";
+    }
     return out;
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "DFA.hpp"
+#include "subset_interner.hpp"
 #include <vector>
+#include <cassert>
 
 /**
  * @brief Represents an NFA transition.
@@ -80,12 +82,17 @@ namespace std {
         }
     };
 
+    // Order independent, but each element hash is mixed first (a plain xor cancels out the equal halves of
+    // eg. {("ab", 1), ("ab", 2)}).
     template <typename V> struct hash<unordered_set<V> > {
         size_t operator()(const unordered_set<V>& x) const
         {
-            size_t tot = 0;
-            for(V elm : x){
-                tot ^= std::hash<V>{}(elm);
+            uint64_t tot = x.size();
+            for(const V& elm : x){
+                uint64_t h = std::hash<V>{}(elm) + 0x9e3779b97f4a7c15ULL;
+                h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+                tot += h ^ (h >> 31);
             }
             return tot;
         }
@@ -152,98 +159,210 @@ protected:
     }
 
     /**
-     * @brief Removes all of the epsilons in the NFA by converting the nodes to
-     * sets of nodes.
+     * @brief Computes the epsilon closure of every vertex in the NFA.
      * 
-     * @param nfa the nfa we want to remove epsilons from.
-     * @return NFA<std::unordered_set<N>,T> the nfa after the remove epsilon transformation.
+     * @param nfa the nfa.
+     * @return fa_map<N,fa_set<N>> a map of the vertex to the set of all of the states 
+     * we can get to by DFS through epsilons.
      */
-    static NFA<std::unordered_set<N>,T> remove_epsilon(NFA<N,T>& nfa){
-        /**
-         * The algorithm for removing epsilons from the NFA is as follows:
-         * 1. Run DFS through all of the states and add the transitions 
-         * 2. 1-to-1 matching except, when the vertex that we are visiting has an epsilon edge
-         * 3. If an epsilon edge exists, then we DFS through all epsilon transitions and add that to the 
-         * unordered set of "reachable states".
-         */
-
+    static fa_map<N,fa_set<N>> epsilon_closures(NFA<N,T>& nfa){
         // Create an directed map of all states connected by an epsilon
-        std::unordered_multimap<N,N> epsilon_edges = {};
-        for(auto edge : nfa.edge_map){
-            for(auto ed2 : edge.second){
-                assert(ed2.first.nfa_flag != nfa_val<T>::STAR); // check that all stars have been taken out.
+        fa_map<N,fa_vector<N>> epsilon_edges = {};
+        for(auto& edge : nfa.edge_map){
+            for(auto& ed2 : edge.second){
                 if(ed2.first.nfa_flag == nfa_val<T>::EPSILON){
-                    epsilon_edges.insert({edge.first, ed2.second});
+                    epsilon_edges[edge.first].push_back(ed2.second);
                 }
             }
         }
 
-        // Create a map of the vertex to the set of all of the states we
-        // can get to by DFS through epsilons.
-        std::unordered_map<N,std::unordered_set<N>> vertex_map = {};
-        for(auto vertex : nfa.states()){
-            std::vector<N> verts;
-            verts.push_back(vertex);
-            std::unordered_set<N> seen = {};
+        fa_map<N,fa_set<N>> vertex_map = {};
+        fa_vector<N> verts;
+        for(auto& vertex : nfa.name_map){
+            verts.assign(1, vertex.first);
+            fa_set<N>& seen = vertex_map[vertex.first];
             while(verts.size() > 0){
                 N next = verts[verts.size() - 1];
                 verts.pop_back();
                 if(!seen.count(next)){
                     seen.insert(next);
-                    auto range = epsilon_edges.equal_range(next);
-                    for(auto p = range.first; p != range.second; ++p){
-                        if(!seen.count(p->second)) verts.push_back(p->second);
+                    auto edges = epsilon_edges.find(next);
+                    if(edges == epsilon_edges.end()) continue;
+                    for(const N& to : edges->second){
+                        if(!seen.count(to)) verts.push_back(to);
                     }
                 }
             }
-            vertex_map[vertex] = seen;
+        }
+        return vertex_map;
+    }
+
+    /**
+     * @brief Removes all of the epsilons in the NFA by converting the nodes to
+     * sets of nodes.
+     * 
+     * @param nfa the nfa we want to remove epsilons from.
+     * @return NFA<std::unordered_set<N>,T> the nfa after the remove epsilon transformation.
+     */
+    static NFA<std::unordered_set<N>,T> remove_epsilon(NFA<N,T>& nfa){
+        /**
+         * Without STARs, removing the epsilons is the subset construction: a state becomes the set of the states
+         * we can get to by DFS through epsilons, and a value goes from a set to the closure of the targets of
+         * the value (see `determinize_interned`).
+         */
+        for(auto edge : nfa.edge_map){
+            for(auto ed2 : edge.second){
+                assert(ed2.first.nfa_flag != nfa_val<T>::STAR); // check that all stars have been taken out.
+            }
         }
 
+        std::vector<std::unordered_set<N> > subsets;
+        DFA<ll, T> dfa = determinize_interned(nfa, &subsets);
         NFA<std::unordered_set<N>, T> ret_nfa;
-        std::vector<std::unordered_set<N> > stk;
-        stk.push_back(vertex_map[nfa.get_start()]);
-        std::unordered_set<std::unordered_set<N>> seen = {};
-        ret_nfa.add_start(vertex_map[nfa.get_start()]);
-        while(stk.size() > 0){
-            std::unordered_set<N> next = stk[stk.size() - 1];
-            stk.pop_back();
-            if(!seen.count(next)){
-                seen.insert(next);
-                std::unordered_set<T> valid_edges;
-                for(N node : next){
-                    for(auto edge : nfa.transitions(node)){
-                        valid_edges.insert(edge.first);
-                    }
-                }
-                for(T edge_val : valid_edges){
-                    std::unordered_set<N> con = {};
-                    for(N node : next){
-                        for(auto edge : nfa.transitions(node)){
-                            if(edge.first.nfa_flag != nfa_val<T>::NONE) continue;
-                            if((T) edge.first == edge_val){
-                                con.insert(vertex_map[edge.second].begin(), vertex_map[edge.second].end());
-                            }
-                        }
-                    }
-                    ret_nfa.add_transition(next, edge_val, con);
-                    for(N node : con){
-                        if(nfa.is_accept(node)){
-                            ret_nfa.add_final_state(con);
-                            break;
-                        }
-                    }
-                    stk.push_back(con);
+        ret_nfa.add_start(subsets[dfa.get_start()]);
+        for(size_t id = 0; id < subsets.size(); ++id){
+            dfa.for_each_transition(id, [&](T val, ll next){
+                ret_nfa.add_transition(subsets[id], val, subsets[next]);
+            });
+        }
+        for(size_t id = 0; id < subsets.size(); ++id){
+            if(dfa.is_accept(id)) ret_nfa.add_final_state(subsets[id]);
+        }
+        return ret_nfa;
+    }
+
+    /**
+     * @brief The subset construction of `determinize`, on interned sets: the states of the NFA are numbered, and
+     * every set of them is interned as a sorted vector of numbers (see subset_interner.hpp), so the DFA states are
+     * the ids of the sets (the start is 0) and no `std::unordered_set` is hashed or compared.
+     *
+     * @param nfa the nfa (may contain EPSILONs and STARs).
+     * @param subsets if not NULL, set to the NFA states of every DFA state (indexed by the id of the state).
+     * @return DFA<ll,T> the DFA with default transitions.
+     */
+    static DFA<ll,T> determinize_interned(NFA<N,T>& nfa, std::vector<std::unordered_set<N> >* subsets = NULL){
+        fa_vector<N> names;                     // the NFA state of every number
+        fa_map<N, uint32_t> number;
+        auto number_of = [&](const N& node){
+            auto it = number.find(node);
+            if(it != number.end()) return it->second;
+            number[node] = names.size();
+            names.push_back(node);
+            return (uint32_t) names.size() - 1;
+        };
+        fa_vector<fa_vector<std::pair<T, uint32_t> > > labeled;
+        fa_vector<fa_vector<uint32_t> > starred, epsilons;
+        for(auto& vertex : nfa.name_map) number_of(vertex.first);
+        labeled.resize(names.size()); starred.resize(names.size()); epsilons.resize(names.size());
+        for(auto& edges : nfa.edge_map){
+            uint32_t from = number_of(edges.first);
+            for(auto& edge : edges.second){
+                uint32_t to = number_of(edge.second);
+                if(edge.first.nfa_flag == nfa_val<T>::NONE) labeled[from].push_back({(T) edge.first, to});
+                else if(edge.first.nfa_flag == nfa_val<T>::STAR) starred[from].push_back(to);
+                else epsilons[from].push_back(to);
+            }
+        }
+        // The epsilon closure of every state (sorted).
+        fa_vector<fa_vector<uint32_t> > closure(names.size());
+        fa_vector<uint32_t> seen_at(names.size(), UINT32_MAX);
+        fa_vector<uint32_t> stk;
+        for(uint32_t v = 0; v < names.size(); ++v){
+            stk.assign(1, v);
+            seen_at[v] = v;
+            while(stk.size()){
+                uint32_t cur = stk.back(); stk.pop_back();
+                closure[v].push_back(cur);
+                for(uint32_t next : epsilons[cur]){
+                    if(seen_at[next] != v) (seen_at[next] = v, stk.push_back(next));
                 }
             }
+            std::sort(closure[v].begin(), closure[v].end());
         }
-        for(N node : vertex_map[nfa.get_start()]){
-            if(nfa.is_accept(node)){
-                ret_nfa.add_final_state(vertex_map[nfa.get_start()]);
-                break;
+
+        subset_interner sets;
+        fa_vector<bool> accepts;
+        fa_vector<size_t> work;
+        DFA<ll, T> ret_dfa;
+        auto intern = [&](fa_vector<uint32_t>& set){
+            bool added;
+            size_t id = sets.intern(set, &added);
+            if(added){
+                bool acc = false;
+                for(uint32_t m : set) acc = acc || nfa.is_accept(names[m]);
+                accepts.push_back(acc);
+                work.push_back(id);
             }
+            return (ll) id;
+        };
+        fa_vector<uint32_t> set = closure[number_of(nfa.get_start())];
+        ret_dfa.add_start(intern(set));
+        fa_vector<std::pair<T, uint32_t> > moves;
+        fa_vector<uint32_t> star_targets, con;
+        while(work.size()){
+            size_t cur = work.back(); work.pop_back();
+            moves.clear(); star_targets.clear();
+            sets.for_each_member(cur, [&](uint32_t m){
+                moves.insert(moves.end(), labeled[m].begin(), labeled[m].end());
+                for(uint32_t t : starred[m]) star_targets.insert(star_targets.end(), closure[t].begin(), closure[t].end());
+            });
+            subset_interner::canonical(star_targets);
+            fa_map<T, fa_vector<uint32_t> > targets;
+            for(auto& move : moves){
+                fa_vector<uint32_t>& target = targets[move.first];
+                target.insert(target.end(), closure[move.second].begin(), closure[move.second].end());
+            }
+            for(auto& target : targets){
+                con.assign(target.second.begin(), target.second.end());
+                con.insert(con.end(), star_targets.begin(), star_targets.end());
+                subset_interner::canonical(con);
+                if(con == star_targets) continue; // the default transition already covers this value.
+                ret_dfa.add_transition(cur, target.first, intern(con));
+            }
+            if(star_targets.size()) ret_dfa.add_default_transition(cur, intern(star_targets));
         }
-        
-        return ret_nfa;
+        for(size_t id = 0; id < sets.size(); ++id){
+            if(accepts[id]) ret_dfa.add_final_state(id);
+        }
+        if(subsets){
+            subsets->assign(sets.size(), std::unordered_set<N>());
+            for(size_t id = 0; id < sets.size(); ++id){
+                sets.for_each_member(id, [&](uint32_t m){ (*subsets)[id].insert(names[m]); });
+            }
+        }
+        return ret_dfa;
+    }
+
+    /**
+     * @brief Converts the NFA into a DFA without expanding the STAR transitions. Instead, each
+     * STAR becomes part of a default ("otherwise") transition of the DFA state, so the DFA only has
+     * explicit edges for the values that appear in the NFA.
+     * 
+     * @param nfa the nfa (may contain EPSILONs and STARs).
+     * @return DFA<std::unordered_set<N>,T> the DFA with default transitions.
+     */
+    static DFA<std::unordered_set<N>,T> determinize(NFA<N,T>& nfa){
+        /**
+         * Subset construction where, for a set of states S:
+         * - an explicit value c goes to the closure of the c-targets and the STAR-targets of S.
+         * - every other value goes to the closure of the STAR-targets of S (the default transition).
+         * The construction runs on interned sets (see `determinize_interned`), which are then named by their
+         * states.
+         */
+        std::vector<std::unordered_set<N> > subsets;
+        DFA<ll, T> dfa = determinize_interned(nfa, &subsets);
+        DFA<std::unordered_set<N>, T> ret_dfa;
+        ret_dfa.add_start(subsets[dfa.get_start()]);
+        for(size_t id = 0; id < subsets.size(); ++id){
+            dfa.for_each_transition(id, [&](T val, ll next){
+                ret_dfa.add_transition(subsets[id], val, subsets[next]);
+            });
+            if(dfa.has_default_transition(id)) ret_dfa.add_default_transition(subsets[id], subsets[dfa.default_state(id)]);
+        }
+        for(size_t id = 0; id < subsets.size(); ++id){
+            if(dfa.is_accept(id)) ret_dfa.add_final_state(subsets[id]);
+        }
+        return ret_dfa;
     }
 
 public:
@@ -291,6 +410,27 @@ public:
         return this->convert_to_dfa(*this, dict_begin, dict_end);
     }
 
+    /**
+     * @brief Converts this NFA into a DFA, keeping each STAR as a default transition (see `determinize`)
+     * rather than expanding it over an alphabet.
+     * 
+     * @return DFA<std::unordered_set<N>, T> the converted NFA.
+     */
+    DFA<std::unordered_set<N>, T> convert_to_dfa(){
+        return determinize(*this);
+    }
+
+    /**
+     * @brief Converts this NFA into a DFA with `ll` states, like `convert_to_dfa().compress_dfa()` but without
+     * naming the states by their sets of NFA states.
+     *
+     * @param subsets if not NULL, set to the NFA states of every DFA state (indexed by the state).
+     * @return DFA<ll, T> the converted NFA.
+     */
+    DFA<ll, T> convert_to_compressed_dfa(std::vector<std::unordered_set<N> >* subsets = NULL){
+        return determinize_interned(*this, subsets);
+    }
+
     /**
      * @brief Converts the given NFA into a DFA.
      * 
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "DFA.hpp"
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <iostream>
+
+/**
+ * @brief Maps the bytes that an index actually uses onto a dense symbol space 0..k-1. Every byte outside of the
+ * alphabet is mapped to a single "other" symbol (k), which never has an edge in the index. A default constructed
+ * alphabet_map is the identity map over all 256 bytes.
+ */
+class alphabet_map {
+private:
+    unsigned char to_sym[256];
+    unsigned char to_byte[256];
+    int k;
+public:
+    /**
+     * @brief Construct the identity alphabet map.
+     *
+     */
+    alphabet_map() : k(256) {
+        for(int i = 0; i < 256; ++i) to_sym[i] = to_byte[i] = (unsigned char) i;
+    }
+
+    /**
+     * @brief Construct a new alphabet map from the given alphabet. Symbols are assigned in (unsigned) byte order.
+     *
+     * @tparam col a collection of chars.
+     * @param alphabet the bytes used by the index.
+     */
+    template <class col>
+    alphabet_map(const col& alphabet){
+        std::vector<unsigned char> bytes;
+        for(char c : alphabet) bytes.push_back((unsigned char) c);
+        std::sort(bytes.begin(), bytes.end());
+        bytes.erase(std::unique(bytes.begin(), bytes.end()), bytes.end());
+        this->k = bytes.size();
+        for(int i = 0; i < 256; ++i) to_sym[i] = (unsigned char) this->k;
+        for(int i = 0; i < 256; ++i) to_byte[i] = '?';
+        for(int i = 0; i < this->k; ++i){
+            to_sym[bytes[i]] = (unsigned char) i;
+            to_byte[i] = bytes[i];
+        }
+    }
+
+    /**
+     * @brief The number of symbols in the alphabet (not including the "other" symbol).
+     *
+     * @return int the number of symbols.
+     */
+    int size() const {
+        return this->k;
+    }
+
+    /**
+     * @brief The symbol that all bytes outside of the alphabet map to. When all 256 bytes are in the alphabet
+     * no byte maps to it.
+     *
+     * @return char the "other" symbol.
+     */
+    char other() const {
+        return (char) this->k;
+    }
+
+    char encode(char c) const {
+        return (char) to_sym[(unsigned char) c];
+    }
+
+    char decode(char s) const {
+        return (char) to_byte[(unsigned char) s];
+    }
+
+    std::string encode(const std::string& s) const {
+        std::string ret(s);
+        for(char& c : ret) c = this->encode(c);
+        return ret;
+    }
+
+    std::string decode(const std::string& s) const {
+        std::string ret(s);
+        for(char& c : ret) c = this->decode(c);
+        return ret;
+    }
+
+    /**
+     * @brief Adds a byte to the alphabet (if it is not already in it). The new byte gets the next symbol, and
+     * the "other" symbol moves up by one; no index has an edge labeled with the "other" symbol, so indexes
+     * labeled with this map stay valid.
+     *
+     * @param c the byte.
+     * @return char the symbol of the byte.
+     */
+    char add(char c){
+        unsigned char b = (unsigned char) c;
+        if(to_sym[b] != this->k) return (char) to_sym[b];
+        to_byte[this->k] = b;
+        to_sym[b] = (unsigned char) this->k++;
+        for(int i = 0; i < 256; ++i){
+            if(i != b && to_sym[i] == this->k - 1) to_sym[i] = (unsigned char) this->k;
+        }
+        return (char) to_sym[b];
+    }
+
+    /**
+     * @brief Are the symbols still in (unsigned) byte order? They are when the map is constructed, until `add` gives
+     * a byte that is smaller than some byte of the alphabet the next symbol; the encoded words then no longer sort
+     * like the decoded ones.
+     *
+     * @return true if the symbols are in byte order.
+     */
+    bool byte_ordered() const {
+        for(int i = 1; i < this->k; ++i){
+            if(to_byte[i - 1] >= to_byte[i]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns all of the symbols in the alphabet (ie. the values a STAR transition expands to).
+     *
+     * @return std::unordered_set<char> the symbols 0..k-1.
+     */
+    std::unordered_set<char> symbols() const {
+        std::unordered_set<char> ret;
+        for(int i = 0; i < this->k; ++i) ret.insert((char) i);
+        return ret;
+    }
+
+    /**
+     * @brief Relabels every transition of the given DFA from bytes to symbols. State names are not changed.
+     *
+     * @param dfa the DFA.
+     */
+    void apply(DFA<ll, char>& dfa) const {
+        dfa.relabel([this](char c){ return this->encode(c); });
+    }
+
+    friend std::ostream& serialize_alphabet(std::ostream& os, const alphabet_map& am);
+    friend std::istream& deserialize_alphabet(std::istream& is, alphabet_map& am);
+};
+
+// Alphabet table: the number of symbols (2 bytes) followed by the byte of each symbol.
+std::ostream& serialize_alphabet(std::ostream& os, const alphabet_map& am){
+    unsigned short k = am.k;
+    os.write((char*) &k, sizeof(unsigned short));
+    os.write((char*) am.to_byte, k);
+    return os;
+}
+
+std::istream& deserialize_alphabet(std::istream& is, alphabet_map& am){
+    unsigned short k = 0;
+    is.read((char*) &k, sizeof(unsigned short));
+    std::vector<char> bytes(k);
+    if(k) is.read(bytes.data(), k);
+    am = alphabet_map(std::vector<char>());
+    for(char c : bytes) am.add(c); // keep the symbols in table order (bytes added later are not sorted)
+    return is;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+/**
+ * @file arena.hpp
+ * @brief A bump allocator for query-scoped automata. While an `arena_scope` is active on a thread, every
+ * container built with an `arena_allocator` (ie. the maps inside of a DFA/NFA) is carved out of the arena and
+ * nothing is freed until the arena itself is destroyed. Outside of a scope, `arena_allocator` falls back to
+ * the heap. The containers below pass their allocator on to the containers inside of them, so an automaton built
+ * outside of a scope keeps all of its maps on the heap even when it gains a state inside of one.
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <utility>
+#include <scoped_allocator>
+
+/**
+ * @brief Allocation counters (per thread).
+ */
+typedef struct _alloc_stats_t_ {
+    size_t heap_calls{0};         // calls of operator new (only counted by programs that include util/alloc_counter.cpp)
+    size_t heap_allocations{0};   // allocations that arena_allocator sent to operator new
+    size_t arena_allocations{0};  // allocations that were bump-allocated
+    size_t arena_bytes{0};        // bytes handed out by arenas
+    size_t arena_blocks{0};       // blocks requested by arenas
+} alloc_stats_t;
+
+inline alloc_stats_t& alloc_stats(){
+    static thread_local alloc_stats_t stats;
+    return stats;
+}
+
+class arena {
+private:
+    std::vector<char*> blocks;
+    char* cur{NULL};
+    size_t left{0};
+    size_t block_size;
+public:
+    /**
+     * @brief Construct a new arena object. No memory is requested until the first allocation.
+     *
+     * @param block_size the size of each block requested from the heap.
+     */
+    explicit arena(size_t block_size = 1 << 20) : block_size(block_size) {}
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    /**
+     * @brief Destroy the arena object, releasing every block at once.
+     *
+     */
+    ~arena(){
+        this->release();
+    }
+
+    /**
+     * @brief Bump-allocates n bytes with the given alignment.
+     *
+     * @param n the number of bytes.
+     * @param align the alignment (must be a power of 2).
+     * @return void* the allocated memory.
+     */
+    void* allocate(size_t n, size_t align){
+        size_t pad = (align - ((size_t) cur & (align - 1))) & (align - 1);
+        if(cur == NULL || pad + n > left){
+            size_t size = n + align > block_size ? n + align : block_size;
+            char* block = (char*) std::malloc(size);
+            if(block == NULL) throw std::bad_alloc();
+            blocks.push_back(block);
+            cur = block; left = size;
+            pad = (align - ((size_t) cur & (align - 1))) & (align - 1);
+            alloc_stats().arena_blocks++;
+        }
+        void* ret = cur + pad;
+        cur += pad + n; left -= pad + n;
+        alloc_stats().arena_allocations++;
+        alloc_stats().arena_bytes += n;
+        return ret;
+    }
+
+    /**
+     * @brief Frees every block owned by this arena. Everything allocated from the arena is invalidated.
+     *
+     */
+    void release(){
+        for(char* block : blocks) std::free(block);
+        blocks.clear();
+        cur = NULL; left = 0;
+    }
+
+    /**
+     * @brief The arena that is active on this thread (or NULL if allocations go to the heap).
+     *
+     * @return arena*& the active arena.
+     */
+    static arena*& current(){
+        static thread_local arena* active = NULL;
+        return active;
+    }
+};
+
+/**
+ * @brief Makes the given arena the active arena of this thread for the lifetime of the scope. A NULL arena
+ * keeps allocations on the heap.
+ */
+class arena_scope {
+private:
+    arena* prev;
+public:
+    explicit arena_scope(arena* a) : prev(arena::current()) {
+        if(a) arena::current() = a;
+    }
+
+    ~arena_scope(){
+        arena::current() = prev;
+    }
+};
+
+/**
+ * @brief An allocator that binds to the active arena when it is constructed. Memory from an arena is never
+ * returned individually; it is released with the arena.
+ *
+ * @tparam T the type of the allocated objects.
+ */
+template <typename T>
+class arena_allocator {
+public:
+    typedef T value_type;
+    arena* source;
+
+    arena_allocator() : source(arena::current()) {}
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) : source(other.source) {}
+
+    T* allocate(size_t n){
+        if(source) return (T*) source->allocate(n * sizeof(T), alignof(T));
+        alloc_stats().heap_allocations++;
+        return (T*) ::operator new(n * sizeof(T));
+    }
+
+    void deallocate(T* p, size_t){
+        if(!source) ::operator delete(p);
+    }
+
+    /**
+     * @brief A copy of a container binds to the arena that is active where the copy is made (not to the arena of
+     * the original, which may be released before the copy).
+     */
+    arena_allocator select_on_container_copy_construction() const {
+        return arena_allocator();
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& a, const arena_allocator<U>& b){
+    return a.source == b.source;
+}
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& a, const arena_allocator<U>& b){
+    return a.source != b.source;
+}
+
+// The allocator of the containers below: the elements that are containers themselves get the allocator of the
+// outer container (instead of binding to whatever arena is active when they are constructed).
+template <typename T>
+using fa_allocator = std::scoped_allocator_adaptor<arena_allocator<T> >;
+
+// Containers used inside of the finite automata.
+template <typename K, typename V>
+using fa_map = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, fa_allocator<std::pair<const K, V> > >;
+
+template <typename K>
+using fa_set = std::unordered_set<K, std::hash<K>, std::equal_to<K>, fa_allocator<K> >;
+
+template <typename T>
+using fa_vector = std::vector<T, fa_allocator<T> >;
@@ -0,0 +1,181 @@
+#pragma once
+
+/**
+ * @file edge_map.hpp
+ * @brief The per-state edge containers used by the DFA. The container is chosen at compile time through
+ * `edge_map_t<V, N>`: byte-sized alphabets (ie. `char`) use a `byte_edge_map`, every other transition type
+ * falls back to an `fa_map<V, N>` (an `std::unordered_map` with an `arena_allocator`).
+ */
+
+#include <unordered_map>
+#include <type_traits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+#include "arena.hpp"
+#include "memory_usage.hpp"
+
+/**
+ * @brief An edge map for 8-bit alphabets. A 256-bit label mask records which labels have an out edge, and the
+ * targets are kept in a vector sorted by (unsigned) label. The position of a label in the vector is the number
+ * of set bits below it in the mask, so a lookup is a bit test followed by a popcount.
+ *
+ * @tparam V the type of the transition (must be one byte wide).
+ * @tparam N the type of the name of the nodes.
+ */
+template <typename V, typename N>
+class byte_edge_map {
+private:
+    uint64_t mask[4]{0, 0, 0, 0};
+    fa_vector<std::pair<V, N> > edges;
+
+    static unsigned char label(V val) {
+        return (unsigned char) val;
+    }
+
+    bool test(unsigned char l) const {
+        return (mask[l >> 6] >> (l & 63)) & 1;
+    }
+
+    size_t rank(unsigned char l) const {
+        size_t r = 0;
+        for(int w = 0; w < (l >> 6); ++w) r += __builtin_popcountll(mask[w]);
+        uint64_t below = (l & 63) ? (mask[l >> 6] & ((1ULL << (l & 63)) - 1)) : 0;
+        return r + __builtin_popcountll(below);
+    }
+public:
+    typedef typename fa_vector<std::pair<V, N> >::iterator iterator;
+    typedef typename fa_vector<std::pair<V, N> >::const_iterator const_iterator;
+    typedef typename fa_vector<std::pair<V, N> >::allocator_type allocator_type;
+
+    byte_edge_map() {}
+
+    /**
+     * @brief Construct an empty edge map that allocates its edges with the given allocator (the allocator of the
+     * map holding it, see `fa_allocator`).
+     */
+    explicit byte_edge_map(const allocator_type& alloc) : edges(alloc) {}
+
+    byte_edge_map(const byte_edge_map& other, const allocator_type& alloc) : edges(other.edges, alloc) {
+        std::copy(other.mask, other.mask + 4, mask);
+    }
+
+    /**
+     * @brief Returns the target of the given label, inserting a default constructed target if the label
+     * is not present.
+     *
+     * @param val the label of the edge.
+     * @return N& a reference to the target of the edge.
+     */
+    N& operator[](V val) {
+        unsigned char l = label(val);
+        size_t r = rank(l);
+        if(!test(l)){
+            mask[l >> 6] |= (1ULL << (l & 63));
+            edges.insert(edges.begin() + r, std::pair<V, N>(val, N()));
+        }
+        return edges[r].second;
+    }
+
+    /**
+     * @brief Returns the target of the given label.
+     *
+     * @param val the label of the edge.
+     * @return const N& the target of the edge (throws if the label is not present).
+     */
+    const N& at(V val) const {
+        unsigned char l = label(val);
+        if(!test(l)) throw std::out_of_range("byte_edge_map::at");
+        return edges[rank(l)].second;
+    }
+
+    /**
+     * @brief Returns a pointer to the target of the given label, or NULL if the label is not present.
+     *
+     * @param val the label of the edge.
+     * @return const N* the target of the edge.
+     */
+    const N* lookup(V val) const {
+        unsigned char l = label(val);
+        return test(l) ? &edges[rank(l)].second : NULL;
+    }
+
+    size_t count(V val) const {
+        return test(label(val));
+    }
+
+    /**
+     * @brief Removes the edge with the given label (if it exists).
+     *
+     * @param val the label of the edge.
+     * @return size_t the number of edges removed.
+     */
+    size_t erase(V val) {
+        unsigned char l = label(val);
+        if(!test(l)) return 0;
+        edges.erase(edges.begin() + rank(l));
+        mask[l >> 6] &= ~(1ULL << (l & 63));
+        return 1;
+    }
+
+    size_t size() const { return edges.size(); }
+    bool empty() const { return edges.empty(); }
+
+    /**
+     * @brief The heap used by the edges (the mask is kept inline).
+     */
+    size_t heap_size() const { return heap_bytes(edges); }
+
+    iterator begin() { return edges.begin(); }
+    iterator end() { return edges.end(); }
+    const_iterator begin() const { return edges.begin(); }
+    const_iterator end() const { return edges.end(); }
+};
+
+/**
+ * @brief Selects the edge container for a transition type. Integral types that are one byte wide use the
+ * `byte_edge_map`.
+ */
+template <typename V, typename N, bool = (std::is_integral<V>::value && sizeof(V) == 1)>
+struct edge_map_selector {
+    typedef fa_map<V, N> type;
+};
+
+template <typename V, typename N>
+struct edge_map_selector<V, N, true> {
+    typedef byte_edge_map<V, N> type;
+};
+
+template <typename V, typename N>
+using edge_map_t = typename edge_map_selector<V, N>::type;
+
+/**
+ * @brief Looks up the target of an edge in any edge container without inserting.
+ *
+ * @return const N* the target, or NULL if the edge does not exist.
+ */
+template <typename V, typename N>
+const N* edge_lookup(const fa_map<V, N>& m, V val) {
+    auto it = m.find(val);
+    return it == m.end() ? NULL : &it->second;
+}
+
+template <typename V, typename N>
+const N* edge_lookup(const byte_edge_map<V, N>& m, V val) {
+    return m.lookup(val);
+}
+
+/**
+ * @brief The heap used by an edge container (outside of the container itself).
+ */
+template <typename V, typename N>
+size_t edge_heap_bytes(const fa_map<V, N>& m) {
+    return hash_table_bytes(m);
+}
+
+template <typename V, typename N>
+size_t edge_heap_bytes(const byte_edge_map<V, N>& m) {
+    return m.heap_size();
+}
@@ -10,16 +10,57 @@
 #include <iterator>
 #include <fstream>
 #include <list>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+#include <string.h>
 #include "DFA.hpp"
+#include "alphabet_map.hpp"
 
 // The types of state.
-enum ENCODING_VERSION:char {V1_1=2, NORMALIZED=1};
-enum STATE_TYPE:char {reject=0b0, accept=0b1, start=0b10, end_read=0b100};
+enum ENCODING_VERSION:char {V1_1=2, NORMALIZED=1, REMAPPED=4};
+enum STATE_TYPE:char {reject=0b0, accept=0b1, start=0b10, end_read=0b100, has_default=0b1000};
 const ll eos = LONG_MAX;
 
+#define ENCODE_BLOCK    (1 << 20)      // the bytes that an encode_buffer collects before it writes them
+
+/**
+ * @brief Collects the fields of an encoding and writes them to the stream ENCODE_BLOCK bytes at a time (instead of a
+ * write per field). The rest is written by `flush` (or when the buffer is destroyed).
+ */
+class encode_buffer {
+private:
+    std::ostream& os;
+    std::string buf;
+public:
+    explicit encode_buffer(std::ostream& os) : os(os) {
+        buf.reserve(ENCODE_BLOCK);
+    }
+
+    encode_buffer(const encode_buffer&) = delete;
+    encode_buffer& operator=(const encode_buffer&) = delete;
+
+    ~encode_buffer(){
+        this->flush();
+    }
+
+    template <class X>
+    void put(const X& x){
+        buf.append((const char*) &x, sizeof(X));
+        if(buf.size() >= ENCODE_BLOCK) this->flush();
+    }
+
+    void flush(){
+        if(buf.size()) os.write(buf.data(), buf.size());
+        buf.clear();
+    }
+};
+
 // Serialize and deserialize for compressed DFAs 
 template <class V>
-std::ostream& serialize(std::ostream& os, DFA<long long, V>& dt){
+std::ostream& serialize(std::ostream& os, DFA<long long, V>& dt, const alphabet_map* am = NULL){
     /**
      * The idea:
      *  - We want to run a BFS on the DFA until we see each one of the states.
@@ -27,89 +68,148 @@ std::ostream& serialize(std::ostream& os, DFA<long long, V>& dt){
      *  states!
      *  - A byte at the beginning of the file indicates what the version of the file is.
      *  - A byte at the beginning of the state adj list indicates whether the state is
-     *  a normal state (aka. a reject state), a start state, or an accept state.
+     *  a normal state (aka. a reject state), a start state, or an accept state, and whether the
+     *  state has a default transition (whose target follows the state name).
+     *  - If the DFA is labeled with alphabet symbols, the REMAPPED bit is set and the alphabet table
+     *  follows the version byte.
      */
-    os.put(ENCODING_VERSION::V1_1);   // write the current encoding version
+    os.put(ENCODING_VERSION::V1_1 | (am ? ENCODING_VERSION::REMAPPED : 0));   // write the current encoding version
+    if(am) serialize_alphabet(os, *am);
+    encode_buffer out(os);
     ll start = dt.get_start(); // eos is the end of state adj list.
     std::list<ll> q{dt.get_start()};
     std::unordered_set<ll> seen;
-    bool first{true};
     while(q.size()){
-        first = false;
         ll cur = q.front(); q.pop_front();
         if(seen.count(cur)) continue;
         seen.insert(cur);
-        os.put((cur == start ? STATE_TYPE::start : 0) + (dt.is_accept(cur) ? STATE_TYPE::accept : STATE_TYPE::reject));
-        os.write((char*)&cur, sizeof(ll));
-        for(std::pair<V,ll> p : dt.transitions(cur)){
-            os.write((char*)&p.second, sizeof(ll));
-            os.write((char*)&p.first, sizeof(V));
-            q.push_back(p.second);
+        bool def = dt.has_default_transition(cur);
+        out.put((char) ((cur == start ? STATE_TYPE::start : 0)
+            + (dt.is_accept(cur) ? STATE_TYPE::accept : STATE_TYPE::reject) + (def ? STATE_TYPE::has_default : 0)));
+        out.put(cur);
+        if(def){
+            ll d = dt.default_state(cur);
+            out.put(d);
+            q.push_back(d);
         }
-        os.write((char*)&eos, sizeof(ll));
+        dt.for_each_transition(cur, [&](V val, ll next){
+            out.put(next);
+            out.put(val);
+            q.push_back(next);
+        });
+        out.put(eos);
     }
-    os.put(STATE_TYPE::end_read); // write end_read
+    out.put((char) STATE_TYPE::end_read); // write end_read
+    out.flush();
     return os;
 }
 
 // Deserialize using the above convention.
 template <class V>
-std::istream& deserialize(std::istream& is, DFA<long long, V>& dt){
+std::istream& deserialize(std::istream& is, DFA<long long, V>& dt, alphabet_map* am = NULL){
     dt = DFA<ll, V>(); // create a new DFA.
     char st;           // the state_type
     assert((is.get(st), st) & ENCODING_VERSION::V1_1);   // we only support encoding version 1.1
+    alphabet_map header;
+    if(st & ENCODING_VERSION::REMAPPED) deserialize_alphabet(is, header);
+    if(am) *am = header;
+    std::vector<ll> accepts;    // added at the end (the states may be written before the edges into them)
     while(is.get(st) && st != STATE_TYPE::end_read){ // while we can get a state_type character and it is not end_read
         ll v, t; is.read((char*) &v, sizeof(ll));
         if(st & STATE_TYPE::start) dt.add_start(v);
+        if(st & STATE_TYPE::has_default){
+            ll d; is.read((char*) &d, sizeof(ll));
+            dt.add_default_transition(v, d);
+        }
         while((is.read((char*) &t, sizeof(ll)), t != eos)){
             if(is.eof() || !is.good()) break;
             V trans; is.read((char*)&trans, sizeof(V));
             dt.add_transition(v, trans, t);
         }
-        if(st & STATE_TYPE::accept) dt.add_final_state(v);
+        if(st & STATE_TYPE::accept) accepts.push_back(v);
         if(is.eof() || !is.good()) break;
     }
+    for(ll v : accepts) dt.add_final_state(v);
     return is;
 }
 
 /**
- * @brief "Normalizes" the serialized DFA at the given location. This function is strongly coupled with the 
- * serialize and deserialize functions, and, if a new serialze protocol is used to encode DFAs, then this function
- * must be changed as well.
+ * @brief "Normalizes" the serialized DFA at the given location: the name of every state, and the target of every
+ * transition, is rewritten as the offset of the state in the file (so a reader can seek to a state instead of
+ * searching for it, see lazy_DFA.hpp). This function is strongly coupled with the serialize and deserialize
+ * functions, and, if a new serialze protocol is used to encode DFAs, then this function must be changed as well.
+ * Anything after the serialized DFA (eg. the positions of a suffix tree) is left as it is.
  * 
  * @tparam V the type of the DFA transition
  * @param fs the fstream of the file, assume that the fstream has been correctly positioned at the beginning of the
  * serialized DFA.
+ * @param names if not NULL, filled with the new name (offset) of every old name.
  * @return the fstream.
  */
 template <class V>
-std::fstream& normalize(std::fstream& fs) {
+std::fstream& normalize(std::fstream& fs, std::unordered_map<ll, ll>* names = NULL) {
   std::unordered_map<ll, ll> position_map;
+  std::vector<std::pair<ll, ll> > records;  // the offset and the length of every state
   char ch;
   ll beginning = fs.tellg();
-  ll pos = beginning;
   fs.get(ch);
   assert(ch & ENCODING_VERSION::V1_1); // only works with V1.1
-  while(fs.get(ch)) { // the type of the node
+  char version = ch;
+  if(version & ENCODING_VERSION::NORMALIZED) return fs;
+  if(version & ENCODING_VERSION::REMAPPED){ // skip the alphabet table
+    alphabet_map header; deserialize_alphabet(fs, header);
+  }
+  ll pos = fs.tellg();
+  while(fs.get(ch) && ch != STATE_TYPE::end_read) { // the type of the node
     ll v, t; fs.read((char*) &v, sizeof(ll));
     position_map[v] = pos;
+    if(ch & STATE_TYPE::has_default) fs.read((char*) &t, sizeof(ll));
     while((fs.read((char*) &t, sizeof(ll)), t != eos)){
       if(fs.eof() || !fs.good()) break;
       V trans; fs.read((char*)&trans, sizeof(V));
     }
-    pos = fs.tellg();
+    if(fs.eof() || !fs.good()) throw std::runtime_error("The serialized DFA is truncated!");
+    ll end = fs.tellg();
+    records.push_back({pos, end - pos});
+    pos = end;
   }
+  fs.clear();
 
-  // fill in the holes
-  for(auto position_pair : position_map){
-    fs.seekg(position_pair.second);
-    fs.get(ch);
-    fs.write((char*) &position_pair.second, sizeof(ll));
+  // fill in the holes (the states are rewritten in place, as their length does not change)
+  auto offset = [&position_map](ll name){
+    auto it = position_map.find(name);
+    if(it == position_map.end()) throw std::runtime_error("A transition leads to a state that was not serialized!");
+    return it->second;
+  };
+  std::vector<char> record;
+  for(auto r : records){
+    record.resize(r.second);
+    fs.seekg(r.first);
+    fs.read(record.data(), r.second);
+    ll at = 1, name;
+    memcpy(&name, &record[at], sizeof(ll));
+    name = offset(name);
+    memcpy(&record[at], &name, sizeof(ll));
+    at += sizeof(ll);
+    if(record[0] & STATE_TYPE::has_default){
+      memcpy(&name, &record[at], sizeof(ll));
+      name = offset(name);
+      memcpy(&record[at], &name, sizeof(ll));
+      at += sizeof(ll);
+    }
+    while(memcpy(&name, &record[at], sizeof(ll)), name != eos){
+      name = offset(name);
+      memcpy(&record[at], &name, sizeof(ll));
+      at += sizeof(ll) + sizeof(V);
+    }
+    fs.seekp(r.first);
+    fs.write(record.data(), r.second);
   }
 
-  fs.seekg(beginning);    // move to beginning
-  fs.put(ENCODING_VERSION::V1_1 | ENCODING_VERSION::NORMALIZED); // indicate that we have normalized the file
+  fs.seekp(beginning);    // move to beginning
+  fs.put(version | ENCODING_VERSION::NORMALIZED); // indicate that we have normalized the file
+  fs.flush();
+  if(names) names->swap(position_map);
 
   return fs;
 }
-
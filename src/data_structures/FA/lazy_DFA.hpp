@@ -4,19 +4,282 @@
  * @file lazy_DFA.hpp
  * @author Siddhant Mane (mane.si@northeastern.edu)
  * @brief Lazily traverses a serialized DFA.
- * @version 0.1
+ * @version 0.2
  * @date 2023-04-29
- * 
+ *
  * @copyright Copyright (c) 2023
- * 
+ *
  */
 
-#include "FA/DFA.hpp"
+#include "DFA.hpp"
+#include "encoding_util.hpp"
+#include "alphabet_map.hpp"
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
 
-template <class V, class T>
-class lazy_DFA : public DFA<V, T> {
+// The order of the labels of a decoded state (bytes in unsigned order, like a `byte_edge_map`).
+template <class V>
+inline bool lazy_label_less(const V& a, const V& b){
+  return a < b;
+}
+
+template <>
+inline bool lazy_label_less<char>(const char& a, const char& b){
+  return (unsigned char) a < (unsigned char) b;
+}
+
+/**
+ * @brief A read-only DFA that stays on disk. The DFA must be serialized and then normalized (see `normalize` in
+ * encoding_util.hpp), so the name of a state is the offset of the state in the file: a state is decoded by seeking
+ * to its name, and the decoded states are kept in an LRU cache of at most `cache_bytes` bytes. The memory used is
+ * the cache (and the stream buffer), whatever the size of the file.
+ *
+ * The cache is locked, so a lazy_DFA can be queried from several threads.
+ *
+ * @tparam V the type of the transitions.
+ */
+template <class V>
+class lazy_DFA : public READ_ONLY_FA<ll, V> {
 private:
+  typedef struct _lazy_state_t_ {
+    bool accept;
+    ll default_target{-1};                    // -1 if there is no default transition
+    std::vector<std::pair<V, ll> > edges;     // ordered by label
+    size_t bytes;                             // what the state costs in the cache
+  } state_t;
+  typedef std::shared_ptr<const state_t> state_ptr;
+  typedef std::pair<state_ptr, std::list<ll>::iterator> cache_entry_t;
+
+  std::ifstream is;
+  alphabet_map alphabet;
+  ll start;
+  ll end;                             // the offset of the end of the states
+  size_t cache_bytes, used{0};
+  std::list<ll> recency;              // the cached states, the most recently used first
+  std::unordered_map<ll, cache_entry_t> cache;
+  size_t hits{0}, misses{0};
+  std::mutex lock;
+
+  // Decodes the state at the offset (the stream must be locked).
+  state_ptr decode(ll s){
+    if(s < start || s >= end) throw std::runtime_error("The state does not exist!");
+    std::shared_ptr<state_t> st(new state_t());
+    char type; ll name, t;
+    is.seekg(s);
+    is.get(type);
+    is.read((char*) &name, sizeof(ll));
+    if(!is || name != s) throw std::runtime_error("The state does not exist!");
+    st->accept = type & STATE_TYPE::accept;
+    if(type & STATE_TYPE::has_default) is.read((char*) &st->default_target, sizeof(ll));
+    while(is.read((char*) &t, sizeof(ll)) && t != eos){
+      V val; is.read((char*) &val, sizeof(V));
+      st->edges.push_back({val, t});
+    }
+    if(!is) throw std::runtime_error("The serialized DFA is truncated!");
+    std::sort(st->edges.begin(), st->edges.end(), [](const std::pair<V, ll>& a, const std::pair<V, ll>& b){
+      return lazy_label_less(a.first, b.first);
+    });
+    st->edges.shrink_to_fit();
+    st->bytes = sizeof(state_t) + st->edges.capacity() * sizeof(std::pair<V, ll>)
+      + 4 * sizeof(void*) + sizeof(cache_entry_t) + sizeof(ll); // and the nodes of the list and of the map
+    return st;
+  }
+
+  // The decoded state (from the cache if it is there).
+  state_ptr fetch(ll s){
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = cache.find(s);
+    if(it != cache.end()){
+      ++hits;
+      recency.splice(recency.begin(), recency, it->second.second);
+      return it->second.first;
+    }
+    ++misses;
+    state_ptr st = this->decode(s);
+    recency.push_front(s);
+    cache[s] = {st, recency.begin()};
+    used += st->bytes;
+    while(used > cache_bytes && recency.size() > 1){ // evict the least recently used states
+      auto last = cache.find(recency.back());
+      used -= last->second.first->bytes;
+      cache.erase(last);
+      recency.pop_back();
+    }
+    return st;
+  }
+
+  // The target of the label (-1 if there is none).
+  ll step(const state_t& st, const V& val) const {
+    auto it = std::lower_bound(st.edges.begin(), st.edges.end(), val, [](const std::pair<V, ll>& a, const V& b){
+      return lazy_label_less(a.first, b);
+    });
+    if(it != st.edges.end() && it->first == val) return it->second;
+    return st.default_target;
+  }
 public:
-  
-};
+  /**
+   * @brief Opens a normalized DFA.
+   *
+   * @param path the file.
+   * @param cache_bytes the bytes that the decoded states may use.
+   */
+  lazy_DFA(const std::string& path, size_t cache_bytes) : is(path.c_str(), std::ifstream::binary),
+    cache_bytes(cache_bytes) {
+    char version;
+    if(!is.get(version)) throw std::runtime_error("Cannot open file!");
+    if(!(version & ENCODING_VERSION::V1_1) || !(version & ENCODING_VERSION::NORMALIZED))
+      throw std::runtime_error("The DFA is not normalized!");
+    if(version & ENCODING_VERSION::REMAPPED) deserialize_alphabet(is, alphabet);
+    start = is.tellg(); // the states are written from the start state on
+    char type;
+    if(!is.get(type) || !(type & STATE_TYPE::start)) throw std::runtime_error("The DFA has no start!");
+    // Find the end of the states: skip every state (without decoding it).
+    is.seekg(start);
+    ll t;
+    while(is.get(type) && type != STATE_TYPE::end_read){
+      is.seekg(sizeof(ll) * ((type & STATE_TYPE::has_default) ? 2 : 1), std::ios::cur);
+      while(is.read((char*) &t, sizeof(ll)) && t != eos) is.seekg(sizeof(V), std::ios::cur);
+    }
+    if(!is) throw std::runtime_error("The serialized DFA is truncated!");
+    end = (ll) is.tellg() - 1;
+  }
+
+  ll get_start() override {
+    return this->start;
+  }
+
+  bool is_accept(ll s) override {
+    return this->fetch(s)->accept;
+  }
+
+  /**
+   * @brief Every state of the DFA. Note that this reads the whole file (without caching the states).
+   *
+   * @return std::unordered_set<ll> the states.
+   */
+  std::unordered_set<ll> states() override {
+    std::lock_guard<std::mutex> guard(lock);
+    std::unordered_set<ll> ret;
+    is.seekg(start);
+    char type; ll t;
+    while(is.get(type) && type != STATE_TYPE::end_read){
+      ret.insert((ll) is.tellg() - 1);
+      is.seekg(sizeof(ll) * ((type & STATE_TYPE::has_default) ? 2 : 1), std::ios::cur);
+      while(is.read((char*) &t, sizeof(ll)) && t != eos) is.seekg(sizeof(V), std::ios::cur);
+    }
+    is.clear();
+    return ret;
+  }
 
+  std::unordered_set<std::pair<V, ll> > transitions(ll s) override {
+    state_ptr st = this->fetch(s);
+    return std::unordered_set<std::pair<V, ll> >(st->edges.begin(), st->edges.end());
+  }
+
+  /**
+   * @brief Calls f(label, next) for every explicit transition of the state, in label order.
+   */
+  template <class F>
+  void for_each_transition(ll s, F f){
+    state_ptr st = this->fetch(s);
+    for(auto& e : st->edges) f(e.first, e.second);
+  }
+
+  bool has_transition(ll s, V val){
+    return this->step(*this->fetch(s), val) >= 0;
+  }
+
+  ll next_state(ll s, V val) override {
+    ll next = this->step(*this->fetch(s), val);
+    if(next < 0) throw std::runtime_error("The edge does not exist!");
+    return next;
+  }
+
+  bool contains(const std::basic_string<V>& word){
+    ll s = this->start;
+    for(V c : word){
+      state_ptr st = this->fetch(s);
+      if((s = this->step(*st, c)) < 0) return false;
+    }
+    return this->is_accept(s);
+  }
+
+  /**
+   * @brief Returns the words of the DFA that the automaton accepts (eg. a Levenshtein automaton), by following
+   * the DFA and the automaton together. The DFA must be acyclic (eg. a DAWG).
+   *
+   * @param automaton the automaton.
+   * @return std::vector<std::basic_string<V>> the words, in label order.
+   */
+  std::vector<std::basic_string<V> > search(DFA<ll, V>& automaton){
+    std::vector<std::basic_string<V> > ret;
+    std::basic_string<V> prefix;
+    std::function<void(ll, ll)> walk = [&](ll s, ll q){
+      state_ptr st = this->fetch(s);
+      if(st->accept && automaton.is_accept(q)) ret.push_back(prefix);
+      for(auto& e : st->edges){
+        if(!automaton.has_transition(q, e.first)) continue;
+        prefix.push_back(e.first);
+        walk(e.second, automaton.next_state(q, e.first));
+        prefix.pop_back();
+      }
+    };
+    walk(this->start, automaton.get_start());
+    return ret;
+  }
+
+  /**
+   * @brief Calls f(word) for every word of the DFA, in label order (the DFA must be acyclic).
+   */
+  template <class F>
+  void for_each_word(F f){
+    std::basic_string<V> prefix;
+    std::function<void(ll)> walk = [&](ll s){
+      state_ptr st = this->fetch(s);
+      if(st->accept) f(prefix);
+      for(auto& e : st->edges){
+        prefix.push_back(e.first);
+        walk(e.second);
+        prefix.pop_back();
+      }
+    };
+    walk(this->start);
+  }
+
+  /**
+   * @brief The alphabet table of the file (the identity map if the DFA was not remapped).
+   */
+  const alphabet_map& get_alphabet() const {
+    return this->alphabet;
+  }
+
+  /**
+   * @brief The bytes used by the cached states (at most the budget, unless a single state is larger).
+   */
+  size_t memory(){
+    std::lock_guard<std::mutex> guard(lock);
+    return this->used;
+  }
+
+  /**
+   * @brief The number of cached states.
+   */
+  size_t cached(){
+    std::lock_guard<std::mutex> guard(lock);
+    return this->cache.size();
+  }
+
+  /**
+   * @brief The number of states that were found in the cache, and that had to be read from the file.
+   */
+  std::pair<size_t, size_t> cache_stats(){
+    std::lock_guard<std::mutex> guard(lock);
+    return {this->hits, this->misses};
+  }
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "DFA.hpp"
+#include "arena.hpp"
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <utility>
+#include <stdint.h>
+
+/**
+ * @brief A pull-style iterator over the words of an acyclic dictionary (eg. a DAWG or a suffix tree) that an
+ * automaton accepts (eg. a Levenshtein automaton). The dictionary and the automaton are walked together, depth first
+ * and in label order, without building their intersection: `next` resumes the walk where it stopped and stops again
+ * at the next word, so the first results come out before the rest of the search is done, and the walk ends after
+ * `limit` words.
+ *
+ * Every result is the word and the state of the dictionary where it ends, so anything kept by state (eg. the
+ * positions of a suffix tree) is found without following the word again from the root.
+ *
+ * The walk keeps its stack and its dead pairs in FA containers, so inside of an `arena_scope` they come out of the
+ * arena of the query (see arena.hpp).
+ *
+ * @tparam D the dictionary (`get_start`, `is_accept` and `for_each_transition`, eg. a DFA<ll, V>).
+ * @tparam V the type of the transitions.
+ */
+template <class D, class V = char>
+class match_iterator {
+private:
+    typedef struct _match_frame_t_ {
+        ll state;           // the state of the dictionary
+        ll q;               // the state of the automaton
+        size_t begin;       // the children of the state are children[begin, end)
+        size_t next, end;   // (and children[next, end) are still to walk)
+        size_t found;       // the number of results when the state was entered
+    } frame_t;
+
+    D& dict;
+    DFA<ll, V>& automaton;
+    size_t limit, found{0}, visited{0};
+    fa_vector<frame_t> stk;
+    fa_vector<std::pair<V, ll> > children;
+    std::basic_string<V> prefix;
+    fa_set<std::pair<ll, ll> > dead;                // the (state, q) pairs that lead to no result
+    bool pending{false};                            // the start itself is a result that has not been returned
+
+    // Pushes the (state, q) pair, returns whether it is a result.
+    bool enter(ll state, ll q){
+        ++visited;
+        size_t begin = children.size();
+        dict.for_each_transition(state, [this](V val, ll next){ children.push_back({val, next}); });
+        stk.push_back({state, q, begin, begin, children.size(), found});
+        return dict.is_accept(state) && automaton.is_accept(q);
+    }
+public:
+    /**
+     * @brief Starts the walk (nothing is searched until `next`, beyond the start).
+     *
+     * @param dict the dictionary (it must be acyclic, and must outlive the iterator).
+     * @param automaton the automaton (it must outlive the iterator).
+     * @param limit the number of results after which the walk ends (0: no limit).
+     */
+    match_iterator(D& dict, DFA<ll, V>& automaton, size_t limit = 0) : dict(dict), automaton(automaton),
+        limit(limit ? limit : SIZE_MAX) {
+        pending = this->enter(dict.get_start(), automaton.get_start());
+    }
+
+    match_iterator(const match_iterator&) = delete;
+    match_iterator& operator=(const match_iterator&) = delete;
+
+    /**
+     * @brief Finds the next result.
+     *
+     * @param word set to the word.
+     * @param state set to the state of the dictionary where the word ends.
+     * @return true if there was a result.
+     * @return false if there are no more results (or `limit` were returned).
+     */
+    bool next(std::basic_string<V>& word, ll& state){
+        if(found >= limit) return false;
+        if(pending){
+            pending = false;
+            ++found;
+            word = prefix;
+            state = stk.back().state;
+            return true;
+        }
+        while(stk.size()){
+            frame_t& f = stk.back();
+            if(f.next == f.end){ // done with the state
+                if(f.found == found) dead.insert({f.state, f.q});
+                children.resize(f.begin);
+                stk.pop_back();
+                continue;
+            }
+            std::pair<V, ll> child = children[f.next++];
+            if(!automaton.has_transition(f.q, child.first)) continue;
+            ll q = automaton.next_state(f.q, child.first);
+            if(dead.count({child.second, q})) continue;
+            prefix.resize(stk.size() - 1);
+            prefix.push_back(child.first);
+            if(this->enter(child.second, q)){
+                ++found;
+                word = prefix;
+                state = child.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief The number of results returned so far.
+     */
+    size_t count() const {
+        return this->found;
+    }
+
+    /**
+     * @brief The number of (dictionary, automaton) states that the walk entered so far.
+     */
+    size_t states_visited() const {
+        return this->visited;
+    }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+/**
+ * @file memory_usage.hpp
+ * @brief Estimates of the heap used by the node based containers of the automata. The standard containers do not
+ * report their memory, so it is estimated from their sizes the way libstdc++ lays them out: a hash table is an array
+ * of buckets plus one allocation per element (the element, a link and, for keys that are not integers, the cached
+ * hash), and every allocation is rounded up by malloc.
+ */
+
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <stddef.h>
+
+/**
+ * @brief The bytes of a structure, by component.
+ */
+typedef struct memory_usage_t {
+    size_t states{0};       // the state table (the names of the states)
+    size_t accept{0};       // the accept flags
+    size_t edges{0};        // the transitions
+    size_t defaults{0};     // the default transitions
+    size_t alphabet{0};     // the alphabet (and the alphabet map)
+    size_t positions{0};    // the positions of the chunks (suffix trees)
+    size_t other{0};        // the bookkeeping of a structure (eg. the register of a DAWG)
+
+    size_t total() const {
+        return states + accept + edges + defaults + alphabet + positions + other;
+    }
+
+    memory_usage_t& operator+=(const memory_usage_t& m){
+        states += m.states; accept += m.accept; edges += m.edges; defaults += m.defaults;
+        alphabet += m.alphabet; positions += m.positions; other += m.other;
+        return *this;
+    }
+} memory_usage;
+
+// The bytes malloc takes for an allocation (an 8 byte header, rounded up to 16 bytes, at least 32).
+inline size_t heap_block(size_t bytes){
+    size_t ret = (bytes + 8 + 15) & ~((size_t) 15);
+    return ret < 32 ? 32 : ret;
+}
+
+// The heap used by a value outside of itself (the characters of a string that do not fit in the string).
+template <class T>
+size_t heap_bytes(const T&){
+    return 0;
+}
+
+inline size_t heap_bytes(const std::string& s){
+    return s.capacity() > 15 ? heap_block(s.capacity() + 1) : 0;
+}
+
+template <class T, class A>
+size_t heap_bytes(const std::vector<T, A>& v){
+    return v.capacity() ? heap_block(v.capacity() * sizeof(T)) : 0;
+}
+
+/**
+ * @brief The heap of a hash table (`std::unordered_map`/`set` and their multi versions), without what its elements
+ * keep outside of themselves.
+ */
+template <class C>
+size_t hash_table_bytes(const C& c){
+    size_t hash = std::is_integral<typename C::key_type>::value ? 0 : sizeof(size_t);
+    size_t buckets = c.bucket_count() > 1 ? c.bucket_count() * sizeof(void*) : 0;
+    return buckets + c.size() * heap_block(sizeof(typename C::value_type) + sizeof(void*) + hash);
+}
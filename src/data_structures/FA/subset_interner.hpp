@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ * @file subset_interner.hpp
+ * @brief The interning table of the subset construction (see `NFA::determinize`). The states of the NFA are
+ * numbered, and every set of them is kept once, sorted, so equal sets get the same id and the construction compares
+ * ids instead of hashing and comparing `std::unordered_set`s.
+ */
+
+#include "arena.hpp"
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Interns sorted sets of NFA state numbers. The sets are stored back to back in a single pool, each with a
+ * 64 bit hash of its members, and are found through an open addressing table of ids (so a lookup is a probe and,
+ * on a hash match, a comparison of the members).
+ */
+class subset_interner {
+private:
+    fa_vector<uint32_t> pool;
+    fa_vector<size_t> offsets{0};       // the members of set i are pool[offsets[i], offsets[i + 1])
+    fa_vector<uint64_t> hashes;         // the hash of every set
+    fa_vector<int64_t> slots;           // the ids of the sets (-1 if the slot is empty), a power of 2 long
+
+    // The splitmix64 finalizer.
+    static uint64_t mix(uint64_t x){
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    template <class set_t>
+    static uint64_t hash(const set_t& set){
+        uint64_t h = mix(set.size());
+        for(uint32_t x : set) h = mix(h ^ (x + 0x9e3779b97f4a7c15ULL));
+        return h;
+    }
+
+    template <class set_t>
+    bool equal(size_t id, const set_t& set) const {
+        return offsets[id + 1] - offsets[id] == set.size()
+            && std::equal(set.begin(), set.end(), pool.begin() + offsets[id]);
+    }
+
+    // The slot of the set: either its id or the empty slot where it belongs.
+    template <class set_t>
+    size_t find(uint64_t h, const set_t& set) const {
+        size_t mask = slots.size() - 1;
+        for(size_t i = h & mask; ; i = (i + 1) & mask){
+            if(slots[i] < 0 || (hashes[slots[i]] == h && this->equal(slots[i], set))) return i;
+        }
+    }
+
+    void grow(){
+        fa_vector<int64_t> old;
+        old.swap(slots);
+        slots.assign(std::max((size_t) 64, old.size() * 2), -1);
+        size_t mask = slots.size() - 1;
+        for(int64_t id : old){
+            if(id < 0) continue;
+            size_t i = hashes[id] & mask;
+            while(slots[i] >= 0) i = (i + 1) & mask;
+            slots[i] = id;
+        }
+    }
+public:
+    /**
+     * @brief Sorts the set and removes its duplicates (the form `intern` expects).
+     */
+    template <class set_t>
+    static void canonical(set_t& set){
+        std::sort(set.begin(), set.end());
+        set.erase(std::unique(set.begin(), set.end()), set.end());
+    }
+
+    /**
+     * @brief Returns the id of the set, adding the set if it is new (the ids are given out from 0 in order).
+     *
+     * @param set the set (a vector of state numbers), sorted and without duplicates (see `canonical`).
+     * @param added if not NULL, set to whether the set is new.
+     * @return size_t the id of the set.
+     */
+    template <class set_t>
+    size_t intern(const set_t& set, bool* added = NULL){
+        if((hashes.size() + 1) * 4 > slots.size() * 3) this->grow(); // at most 3/4 full
+        uint64_t h = hash(set);
+        size_t slot = this->find(h, set);
+        if(added) *added = slots[slot] < 0;
+        if(slots[slot] >= 0) return slots[slot];
+        slots[slot] = hashes.size();
+        hashes.push_back(h);
+        pool.insert(pool.end(), set.begin(), set.end());
+        offsets.push_back(pool.size());
+        return hashes.size() - 1;
+    }
+
+    /**
+     * @brief The number of sets.
+     */
+    size_t size() const {
+        return hashes.size();
+    }
+
+    /**
+     * @brief Calls f(member) for every member of the set, in order.
+     */
+    template <class F>
+    void for_each_member(size_t id, F f) const {
+        for(size_t i = offsets[id]; i < offsets[id + 1]; ++i) f(pool[i]);
+    }
+};
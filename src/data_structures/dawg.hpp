@@ -0,0 +1,384 @@
+#pragma once
+
+#include "FA/DFA.hpp"
+#include <unordered_map>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <queue>
+
+/**
+ * @brief A directed acyclic word graph (DAWG), ie. a minimal acyclic DFA over a dictionary. Words can be
+ * inserted and removed online; the automaton is kept minimal after every update by the incremental algorithm
+ * of Carrasco and Forcada (the states on the path of the updated word are made private, updated, and merged
+ * back into the register of states from the end of the word to the start).
+ *
+ * Words may carry a weight (eg. a frequency), which is kept in the accept state of the word, so two states are
+ * only merged if the words below them have the same weights. Every state also keeps the largest weight below it,
+ * which bounds the weights of the words in its subtree (see `top_k`).
+ *
+ */
+class dawg : public DFA<ll, char> {
+protected:
+    std::unordered_map<std::string, ll> state_register; // signature -> state (every state except the start)
+    std::unordered_map<ll, ll> in_degree;
+    std::unordered_map<ll, ll> weight;          // accept state -> the weight of its word (if it is not 0)
+    std::unordered_map<ll, ll> bound;           // state -> the largest weight of a word below it (if it is not 0)
+    ll next_id{0};
+
+    /**
+     * @brief The right language of a state is determined by its accept flag and its out edges, so two states
+     * with the same signature are equivalent.
+     */
+    std::string signature(ll node) {
+        std::string sig(1, this->name_map[node].is_accept() ? '1' : '0');
+        if(sig[0] == '1'){
+            ll w = this->get_weight(node);
+            sig.append((char*) &w, sizeof(ll));
+        }
+        auto it = this->edge_map.find(node);
+        if(it != this->edge_map.end()){
+            for(auto e : it->second){
+                sig += e.first;
+                sig.append((char*) &e.second, sizeof(ll));
+            }
+        }
+        return sig;
+    }
+
+    ll new_state() {
+        ll id = next_id++;
+        this->create_dfa(id);
+        return id;
+    }
+
+    void link(ll from, char c, ll to) {
+        this->add_transition(from, c, to);
+        in_degree[to]++;
+    }
+
+    void unlink(ll from, char c) {
+        in_degree[this->next_state(from, c)]--;
+        this->remove_transition(from, c);
+    }
+
+    void unregister(ll node) {
+        auto it = state_register.find(signature(node));
+        if(it != state_register.end() && it->second == node) state_register.erase(it);
+    }
+
+    void delete_state(ll node) {
+        auto it = this->edge_map.find(node);
+        if(it != this->edge_map.end()){
+            for(auto e : it->second) in_degree[e.second]--;
+        }
+        this->remove_state(node);
+        in_degree.erase(node);
+        weight.erase(node);
+        bound.erase(node);
+    }
+
+    void set_weight(ll node, ll w) {
+        if(w) weight[node] = w;
+        else weight.erase(node);
+    }
+
+    // Recomputes the bound of the state from its weight and the bounds of its children.
+    void update_bound(ll node) {
+        ll b = this->is_accept(node) ? this->get_weight(node) : 0;
+        auto it = this->edge_map.find(node);
+        if(it != this->edge_map.end()){
+            for(auto e : it->second) b = std::max(b, this->get_bound(e.second));
+        }
+        if(b) bound[node] = b;
+        else bound.erase(node);
+    }
+
+    ll clone(ll node) {
+        ll cl = new_state();
+        if(this->is_accept(node)) this->add_final_state(cl);
+        set_weight(cl, this->get_weight(node));
+        auto it = this->edge_map.find(node);
+        if(it != this->edge_map.end()){
+            std::vector<std::pair<char, ll> > edges(it->second.begin(), it->second.end());
+            for(auto e : edges) link(cl, e.first, e.second);
+        }
+        return cl;
+    }
+
+    /**
+     * @brief Walks the longest prefix of the string that is in the DAWG. Every state on the path is taken out of
+     * the register, and every state from the first confluence state (ie. a state with more than one in edge)
+     * onwards is cloned so that the path can be changed without changing any other word.
+     *
+     * @param s the string.
+     * @return std::vector<ll> the states on the path (starting with the start state).
+     */
+    std::vector<ll> private_path(const std::string& s) {
+        std::vector<ll> path{this->start};
+        bool cloning = false;
+        for(char c : s){
+            const ll* target = this->step(path.back(), c);
+            if(target == NULL) break;
+            ll next = *target;
+            if(cloning || in_degree[next] > 1){ // the state is shared with other words, change a copy of it
+                cloning = true;
+                ll cl = clone(next);
+                unlink(path.back(), c);
+                link(path.back(), c, cl);
+                next = cl;
+            }else{
+                unregister(next);
+            }
+            path.push_back(next);
+        }
+        return path;
+    }
+
+    /**
+     * @brief Walks back along the path, replacing every state with an equivalent state in the register (or
+     * registering the state if there is none).
+     *
+     * @param path the path returned by `private_path`.
+     * @param s the string of the path.
+     */
+    void minimize_path(std::vector<ll>& path, const std::string& s) {
+        for(size_t i = path.size() - 1; i > 0; --i){
+            ll node = path[i];
+            update_bound(node);
+            std::string sig = signature(node);
+            auto it = state_register.find(sig);
+            if(it != state_register.end() && it->second != node){
+                ll equivalent = it->second;
+                unlink(path[i - 1], s[i - 1]);
+                link(path[i - 1], s[i - 1], equivalent);
+                delete_state(node);
+            }else{
+                state_register[sig] = node;
+            }
+        }
+        update_bound(path[0]);
+    }
+
+    ll build_state(DFA<ll, char>& dfa, ll node, std::unordered_map<ll, ll>& built,
+        const std::unordered_map<ll, ll>* weights) {
+        auto it = built.find(node);
+        if(it != built.end()) return it->second;
+        std::vector<std::pair<char, ll> > children;
+        for(auto e : dfa.transitions(node)){
+            children.push_back({e.first, build_state(dfa, e.second, built, weights)});
+        }
+        std::sort(children.begin(), children.end(), [](const std::pair<char, ll>& a, const std::pair<char, ll>& b){
+            return (unsigned char) a.first < (unsigned char) b.first;
+        });
+        std::string sig(1, dfa.is_accept(node) ? '1' : '0');
+        ll w = 0;
+        if(weights && dfa.is_accept(node)){
+            auto wt = weights->find(node);
+            if(wt != weights->end()) w = wt->second;
+        }
+        if(sig[0] == '1') sig.append((char*) &w, sizeof(ll));
+        for(auto c : children){
+            sig += c.first;
+            sig.append((char*) &c.second, sizeof(ll));
+        }
+        auto reg = state_register.find(sig);
+        if(reg != state_register.end()) return built[node] = reg->second;
+        ll id = new_state();
+        if(dfa.is_accept(node)) this->add_final_state(id);
+        set_weight(id, w);
+        for(auto c : children) link(id, c.first, c.second);
+        update_bound(id);
+        state_register[sig] = id;
+        return built[node] = id;
+    }
+public:
+    /**
+     * @brief Construct a new (empty) dawg object
+     *
+     */
+    dawg() : DFA<ll, char>{} {
+        this->add_start(new_state());
+    }
+
+    /**
+     * @brief Replaces the contents of this DAWG with the minimal automaton of the given acyclic DFA (eg. a
+     * compressed trie, or a DAWG read back from a cache).
+     *
+     * @param dfa an acyclic DFA.
+     * @param weights the weights of the accept states of the DFA (the words of the other accept states weigh 0).
+     */
+    void build(DFA<ll, char>& dfa, const std::unordered_map<ll, ll>* weights = NULL) {
+        *this = dawg();
+        std::unordered_map<ll, ll> built;
+        for(auto e : dfa.transitions(dfa.get_start())){
+            link(this->start, e.first, build_state(dfa, e.second, built, weights));
+        }
+        if(dfa.is_accept(dfa.get_start())){
+            this->add_final_state(this->start);
+            if(weights && weights->count(dfa.get_start())) set_weight(this->start, weights->at(dfa.get_start()));
+        }
+        update_bound(this->start);
+    }
+
+    /**
+     * @brief Inserts the string into the DAWG.
+     *
+     * @param s the string we wish to insert.
+     * @param w the weight of the string.
+     * @return true if the string was inserted.
+     * @return false if the string was already in the DAWG.
+     */
+    bool insert(const std::string& s, ll w = 0) {
+        if(this->run(s)) return false;
+        std::vector<ll> path = private_path(s);
+        for(size_t i = path.size() - 1; i < s.size(); ++i){
+            ll next = new_state();
+            link(path.back(), s[i], next);
+            path.push_back(next);
+        }
+        this->add_final_state(path.back());
+        set_weight(path.back(), w);
+        minimize_path(path, s);
+        return true;
+    }
+
+    /**
+     * @brief Removes the string from the DAWG.
+     *
+     * @param s the string we wish to remove.
+     * @return true if the string was removed.
+     * @return false if the string was not in the DAWG.
+     */
+    bool remove(const std::string& s) {
+        if(!this->run(s)) return false;
+        std::vector<ll> path = private_path(s);
+        this->remove_final_state(path.back());
+        set_weight(path.back(), 0);
+        while(path.size() > 1 && !this->is_accept(path.back()) && !this->edge_map.count(path.back())){
+            ll node = path.back(); path.pop_back();
+            unlink(path.back(), s[path.size() - 1]);
+            delete_state(node);
+        }
+        minimize_path(path, s);
+        return true;
+    }
+
+    /**
+     * @brief Does this DAWG contain the given string?
+     *
+     * @param s the string
+     * @return true if the string is contained in the DAWG
+     * @return false if the string is not contained in the DAWG.
+     */
+    bool contains(const std::string& s) {
+        return this->run(s);
+    }
+
+    /**
+     * @brief The number of states in the DAWG.
+     *
+     * @return size_t the number of states.
+     */
+    size_t size() {
+        return this->name_map.size();
+    }
+
+    /**
+     * @brief The estimated heap used by the DAWG (see `DFA::memory_usage`). The register of the states, the in
+     * degrees and the weights are counted as `other`.
+     *
+     * @return memory_usage_t the bytes.
+     */
+    memory_usage_t memory_usage() const {
+        memory_usage_t ret = DFA<ll, char>::memory_usage();
+        ret.other += hash_table_bytes(state_register) + hash_table_bytes(in_degree) + hash_table_bytes(weight)
+            + hash_table_bytes(bound);
+        for(auto& reg : state_register) ret.other += heap_bytes(reg.first);
+        return ret;
+    }
+
+    /**
+     * @brief The weight of the word of an accept state (0 if the word has no weight).
+     *
+     * @param node the accept state.
+     * @return ll the weight.
+     */
+    ll get_weight(ll node) const {
+        auto it = weight.find(node);
+        return it == weight.end() ? 0 : it->second;
+    }
+
+    /**
+     * @brief The largest weight of a word below the state (ie. of a word that the state is a prefix of).
+     *
+     * @param node the state.
+     * @return ll the bound.
+     */
+    ll get_bound(ll node) const {
+        auto it = bound.find(node);
+        return it == bound.end() ? 0 : it->second;
+    }
+
+    /**
+     * @brief The weights of the accept states (accept states that are not in the map weigh 0). The map is keyed
+     * by the states of this DAWG, so it can be saved along with a serialization of the DAWG and passed to `build`.
+     *
+     * @return const std::unordered_map<ll, ll>& the weights.
+     */
+    const std::unordered_map<ll, ll>& weights() const {
+        return this->weight;
+    }
+
+    /**
+     * @brief Returns the k heaviest words that the filter DFA (eg. a Levenshtein automaton) also accepts, heaviest
+     * first (then shorter words first, then in byte order). The search is best first: the product of the DAWG and the filter is expanded from the state whose
+     * bound is the largest, so a subtree whose bound cannot beat the k-th heaviest word is never expanded.
+     *
+     * @param filter the filter DFA.
+     * @param k the number of words.
+     * @param expanded if not NULL, set to the number of (DAWG, filter) states that were expanded.
+     * @return std::vector<std::pair<std::string, ll> > the words and their weights.
+     */
+    std::vector<std::pair<std::string, ll> > top_k(DFA<ll, char>& filter, size_t k, size_t* expanded = NULL) {
+        typedef struct _top_k_entry_t_ {
+            ll bound;
+            bool word;              // is this a word that was found (rather than a state that can be expanded)?
+            std::string prefix;
+            ll state, filter_state;
+        } entry_t;
+        // Heaviest first, then shorter prefixes first, then in byte order; a word comes before a state with the same
+        // prefix. The words of a state are never shorter than its prefix (nor smaller in byte order if they are as
+        // long), so words of the same weight come out shorter first, then in byte order.
+        auto lighter = [](const entry_t& a, const entry_t& b){
+            if(a.bound != b.bound) return a.bound < b.bound;
+            if(a.prefix.size() != b.prefix.size()) return a.prefix.size() > b.prefix.size();
+            if(a.prefix != b.prefix) return a.prefix > b.prefix;
+            return b.word && !a.word;
+        };
+        std::priority_queue<entry_t, std::vector<entry_t>, decltype(lighter)> pq(lighter);
+        std::vector<std::pair<std::string, ll> > ret;
+        size_t count = 0;
+        if(k) pq.push({this->get_bound(this->start), false, "", this->start, filter.get_start()});
+        while(pq.size() && ret.size() < k){
+            entry_t en = pq.top(); pq.pop();
+            if(en.word){
+                ret.push_back({en.prefix, en.bound});
+                continue;
+            }
+            ++count;
+            if(this->is_accept(en.state) && filter.is_accept(en.filter_state)){
+                pq.push({this->get_weight(en.state), true, en.prefix, en.state, en.filter_state});
+            }
+            auto it = this->edge_map.find(en.state);
+            if(it == this->edge_map.end()) continue;
+            for(auto e : it->second){
+                if(!filter.has_transition(en.filter_state, e.first)) continue;
+                pq.push({this->get_bound(e.second), false, en.prefix + e.first, e.second,
+                    filter.next_state(en.filter_state, e.first)});
+            }
+        }
+        if(expanded) *expanded = count;
+        return ret;
+    }
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "FA/DFA.hpp"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define DELETION_INDEX_MAGIC    0x31584944u    // "DIX1"
+
+/**
+ * @brief A symmetric delete (SymSpell) index over a dictionary. Every string that can be made by deleting up to
+ * `max_error` characters from the first `prefix_length` characters of a word is hashed into a bucket that lists
+ * the word. Two words within d edits of each other share such a deletion (a substitution deletes the character
+ * from both sides), so the candidates of a query are the words in the buckets of the deletions of the query, and
+ * only those are checked with an edit distance. A lookup is a few dozen hash probes instead of an automaton
+ * intersection.
+ *
+ * The layout is compact: the words are kept in one character pool, and the buckets are a single array of word
+ * ids indexed by an array of bucket offsets (the deletions themselves are not stored, so bucket collisions only
+ * add candidates). Words inserted after the index is built are kept in a small overlay that is scanned; removed
+ * words are filtered by the caller (eg. by checking the dictionary).
+ */
+class deletion_index {
+private:
+    uint32_t max_error{0};
+    uint32_t prefix_length{0};
+    std::vector<char> pool;                 // the words, back to back
+    std::vector<uint32_t> word_offsets;     // word i is pool[word_offsets[i], word_offsets[i + 1])
+    std::vector<uint32_t> bucket_offsets;   // bucket b lists postings[bucket_offsets[b], bucket_offsets[b + 1])
+    std::vector<uint32_t> postings;         // word ids
+    std::vector<std::string> overlay;       // words inserted after the index was built
+
+    static uint64_t hash(const std::string& s){
+        uint64_t h = 1469598103934665603ull;
+        for(char c : s) h = (h ^ (unsigned char) c) * 1099511628211ull;
+        return h;
+    }
+
+    // Adds the hash of every string made by deleting up to `d` characters of `s` (at or after position `from`).
+    static void deletions(std::string& s, uint32_t d, size_t from, std::vector<uint64_t>& out){
+        out.push_back(hash(s));
+        if(d == 0) return;
+        for(size_t i = from; i < s.size(); ++i){
+            char c = s[i];
+            s.erase(i, 1);
+            deletions(s, d - 1, i, out);
+            s.insert(s.begin() + i, c);
+        }
+    }
+
+    // The (distinct) hashes of the deletions of the prefix of the string.
+    void deletions(const std::string& s, uint32_t d, std::vector<uint64_t>& out) const {
+        std::string prefix = s.substr(0, prefix_length);
+        out.clear();
+        deletions(prefix, d, 0, out);
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+
+    template <class T>
+    static void write_vector(std::ostream& os, const std::vector<T>& v){
+        uint64_t n = v.size();
+        os.write((char*) &n, sizeof(n));
+        os.write((char*) v.data(), n * sizeof(T));
+    }
+
+    template <class T>
+    static bool read_vector(std::istream& is, std::vector<T>& v){
+        uint64_t n;
+        if(!is.read((char*) &n, sizeof(n))) return false;
+        v.resize(n);
+        return (bool) is.read((char*) v.data(), n * sizeof(T));
+    }
+public:
+    deletion_index(){}
+
+    /**
+     * @brief Builds the index of the given words.
+     *
+     * @param words the words.
+     * @param max_error the largest error the index can answer.
+     * @param prefix_length only deletions of the first `prefix_length` characters of a word are indexed (the
+     * candidates are still checked against the whole word), which keeps the index small for long words.
+     */
+    deletion_index(const std::vector<std::string>& words, uint32_t max_error = 2, uint32_t prefix_length = 7)
+        : max_error(max_error), prefix_length(std::max(prefix_length, max_error + 1)) {
+        word_offsets.reserve(words.size() + 1);
+        for(const std::string& w : words){
+            word_offsets.push_back(pool.size());
+            pool.insert(pool.end(), w.begin(), w.end());
+        }
+        word_offsets.push_back(pool.size());
+
+        // Count the deletions, then size the buckets and fill them (the deletions are made twice rather than kept).
+        std::vector<uint64_t> dels;
+        size_t total = 0;
+        for(const std::string& w : words){
+            deletions(w, max_error, dels);
+            total += dels.size();
+        }
+        size_t buckets = 1;
+        while(buckets < total / 2 + 1) buckets <<= 1;
+        bucket_offsets.assign(buckets + 1, 0);
+        for(const std::string& w : words){
+            deletions(w, max_error, dels);
+            for(uint64_t h : dels) ++bucket_offsets[(h & (buckets - 1)) + 1];
+        }
+        for(size_t b = 0; b < buckets; ++b) bucket_offsets[b + 1] += bucket_offsets[b];
+        std::vector<uint32_t> fill(bucket_offsets.begin(), bucket_offsets.end() - 1);
+        postings.resize(total);
+        for(size_t i = 0; i < words.size(); ++i){
+            deletions(words[i], max_error, dels);
+            for(uint64_t h : dels) postings[fill[h & (buckets - 1)]++] = i;
+        }
+    }
+
+    /**
+     * @brief Adds a word that was inserted after the index was built.
+     *
+     * @param w the word.
+     */
+    void insert(const std::string& w){
+        overlay.push_back(w);
+    }
+
+    /**
+     * @brief Is the edit distance between the two strings at most d? (a DP over the diagonal band of width 2d + 1)
+     */
+    static bool within(const std::string& a, const std::string& b, int d){
+        int n = a.size(), m = b.size();
+        if(std::abs(n - m) > d) return false;
+        const int INF = d + 1;
+        std::vector<int> prev(m + 1, INF), cur(m + 1, INF);
+        for(int j = 0; j <= std::min(m, d); ++j) prev[j] = j;
+        for(int i = 1; i <= n; ++i){
+            int lo = std::max(1, i - d), hi = std::min(m, i + d);
+            std::fill(cur.begin(), cur.end(), INF);
+            if(i <= d) cur[0] = i;
+            int best = cur[0];
+            for(int j = lo; j <= hi; ++j){
+                int v = prev[j - 1] + (a[i - 1] != b[j - 1]);
+                v = std::min(v, prev[j] + 1);
+                v = std::min(v, cur[j - 1] + 1);
+                cur[j] = std::min(v, INF);
+                best = std::min(best, cur[j]);
+            }
+            if(best > d) return false;
+            prev.swap(cur);
+        }
+        return prev[m] <= d;
+    }
+
+    /**
+     * @brief Returns the words within `d` edits of the query (in no particular order). The error must not be more
+     * than the largest error of the index.
+     *
+     * @param q the query.
+     * @param d the error.
+     * @param candidates if not NULL, set to the number of words that were checked.
+     * @return std::vector<std::string> the words.
+     */
+    std::vector<std::string> lookup(const std::string& q, uint32_t d, size_t* candidates = NULL) const {
+        std::vector<std::string> ret;
+        std::vector<uint32_t> ids;
+        if(!word_offsets.empty() && bucket_offsets.size() > 1){
+            std::vector<uint64_t> dels;
+            deletions(q, d, dels);
+            for(uint64_t h : dels){
+                size_t b = h & (bucket_offsets.size() - 2);
+                for(uint32_t p = bucket_offsets[b]; p < bucket_offsets[b + 1]; ++p) ids.push_back(postings[p]);
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        for(uint32_t id : ids){
+            std::string w(pool.begin() + word_offsets[id], pool.begin() + word_offsets[id + 1]);
+            if(within(w, q, d)) ret.push_back(w);
+        }
+        for(const std::string& w : overlay){
+            if(within(w, q, d)) ret.push_back(w);
+        }
+        if(candidates) *candidates = ids.size() + overlay.size();
+        return ret;
+    }
+
+    uint32_t get_max_error() const {
+        return this->max_error;
+    }
+
+    uint32_t get_prefix_length() const {
+        return this->prefix_length;
+    }
+
+    /**
+     * @brief The average number of words in a bucket (that a probe of a lookup checks).
+     */
+    double bucket_size() const {
+        return bucket_offsets.size() > 1 ? (double) postings.size() / (bucket_offsets.size() - 1) : 0;
+    }
+
+    size_t words() const {
+        return word_offsets.empty() ? 0 : word_offsets.size() - 1 + overlay.size();
+    }
+
+    /**
+     * @brief The bytes used by the index.
+     *
+     * @return size_t the bytes.
+     */
+    size_t memory() const {
+        size_t ret = pool.capacity() + (word_offsets.capacity() + bucket_offsets.capacity() + postings.capacity())
+            * sizeof(uint32_t);
+        for(const std::string& w : overlay) ret += sizeof(std::string) + w.capacity();
+        return ret;
+    }
+
+    /**
+     * @brief Writes the index (including the overlay) to the stream.
+     *
+     * @param os the stream.
+     */
+    void save(std::ostream& os) const {
+        uint32_t header[3] = {DELETION_INDEX_MAGIC, max_error, prefix_length};
+        os.write((char*) header, sizeof(header));
+        write_vector(os, pool);
+        write_vector(os, word_offsets);
+        write_vector(os, bucket_offsets);
+        write_vector(os, postings);
+        uint64_t n = overlay.size();
+        os.write((char*) &n, sizeof(n));
+        for(const std::string& w : overlay){
+            uint32_t len = w.size();
+            os.write((char*) &len, sizeof(len));
+            os.write(w.data(), len);
+        }
+    }
+
+    /**
+     * @brief Reads an index written by `save`.
+     *
+     * @param is the stream.
+     * @return true if the index was read.
+     * @return false if the stream does not hold an index.
+     */
+    bool load(std::istream& is){
+        uint32_t header[3];
+        if(!is.read((char*) header, sizeof(header)) || header[0] != DELETION_INDEX_MAGIC) return false;
+        max_error = header[1];
+        prefix_length = header[2];
+        if(!read_vector(is, pool) || !read_vector(is, word_offsets) || !read_vector(is, bucket_offsets)
+            || !read_vector(is, postings)) return false;
+        uint64_t n;
+        if(!is.read((char*) &n, sizeof(n))) return false;
+        overlay.assign(n, "");
+        for(std::string& w : overlay){
+            uint32_t len;
+            if(!is.read((char*) &len, sizeof(len))) return false;
+            w.resize(len);
+            if(!is.read(&w[0], len)) return false;
+        }
+        return true;
+    }
+};
@@ -1,41 +1,151 @@
 #pragma once
 
 #include "FA/NFA.hpp"
+#include "FA/alphabet_map.hpp"
 #include <string>
+#include <vector>
 
-class levenshtein_nfa : public NFA<std::pair<std::string, int>, char>{
+class levenshtein_nfa : public NFA<ll, char>{
+private:
+  int error;
 public:
+  /**
+   * @brief The state after `i` characters of the word with `e` errors.
+   */
+  ll state(size_t i, int e) const {
+    return (ll) i * (this->error + 1) + e;
+  }
+
+  /**
+   * @brief The number of characters of the word that the state has read.
+   */
+  size_t position(ll state) const {
+    return state / (this->error + 1);
+  }
+
+  /**
+   * @brief The number of errors of the state.
+   */
+  int errors(ll state) const {
+    return state % (this->error + 1);
+  }
+
   /**
    * @brief Construct a new levenshtein_nfa object
    * 
    * @param s the string we wish to search.
    * @param error the allowed deletes/insertions/substitutions.
    */
-  levenshtein_nfa(std::string s, int error){
-    std::string acc = "";
-    this->add_start({acc,0});
+  levenshtein_nfa(const std::string& s, int error) : error(error) {
+    size_t n = s.size();
+    this->add_start(state(0, 0));
     for(int i = 0; i < error; ++i){
-      acc = "";
-      for(char c : s){
-        this->add_transition({acc,i}, c, {acc + c,i});
-        this->add_transition({acc,i}, nfa_val<char>::EPSILON, {acc+c,i+1}); // delete
-        this->add_transition({acc,i}, nfa_val<char>::STAR, {acc,i+1}); // insertion
-        this->add_transition({acc,i}, nfa_val<char>::STAR, {acc+c,i+1}); // subst
-        acc += c;
+      for(size_t j = 0; j < n; ++j){
+        this->add_transition(state(j, i), s[j], state(j + 1, i));
+        this->add_transition(state(j, i), nfa_val<char>::EPSILON, state(j + 1, i + 1)); // delete
+        this->add_transition(state(j, i), nfa_val<char>::STAR, state(j, i + 1)); // insertion
+        this->add_transition(state(j, i), nfa_val<char>::STAR, state(j + 1, i + 1)); // subst
       }
-      this->add_transition({acc,i}, nfa_val<char>::STAR, {acc,i+1}); // insertion (at the end of the word)
+      this->add_transition(state(n, i), nfa_val<char>::STAR, state(n, i + 1)); // insertion (at the end of the word)
     }
-    acc = "";
-    for(char c : s){
-      this->add_transition({acc,error}, c, {acc + c,error});
-      acc += c;
+    for(size_t j = 0; j < n; ++j){
+      this->add_transition(state(j, error), s[j], state(j + 1, error));
     }
     for(int i = 0; i <= error; ++i){
-      this->add_final_state({s, i});
+      this->add_final_state(state(n, i));
     }
   }
 
-  NFA<std::pair<std::string, int>, char> operator()(){
+  NFA<ll, char> operator()(){
     return *this;
   }
-};
\ No newline at end of file
+};
+
+// The length of the UTF-8 sequence that starts with the byte (1 for a byte that cannot start a sequence).
+inline int utf8_length(unsigned char lead){
+  if(lead < 0xC0) return 1;
+  if(lead < 0xE0) return 2;
+  if(lead < 0xF0) return 3;
+  if(lead < 0xF8) return 4;
+  return 1;
+}
+
+// Splits the string into its UTF-8 code points. A byte that does not start a complete sequence is a code point of
+// its own, so every string splits (and the pieces join back into it).
+inline std::vector<std::string> utf8_code_points(const std::string& s){
+  std::vector<std::string> ret;
+  for(size_t i = 0; i < s.size();){
+    size_t len = utf8_length(s[i]);
+    for(size_t j = 1; j < len; ++j){
+      if(i + j >= s.size() || ((unsigned char) s[i + j] & 0xC0) != 0x80) {len = 1; break;}
+    }
+    ret.push_back(s.substr(i, len));
+    i += len;
+  }
+  return ret;
+}
+
+/**
+ * @brief A Levenshtein automaton over the bytes of UTF-8 text that counts its errors in code points (so a typo in an
+ * accented letter is one error, not two). The dictionaries stay byte-indexed: a match reads the bytes of the next
+ * code point of the word, and an insertion or a substitution reads any one code point, ie. a lead byte and then as
+ * many bytes as the lead byte announces.
+ *
+ * Any byte can also be read alone as an edit (so text that is not UTF-8 is searched as before). On UTF-8 text that
+ * never accepts more: it starts a misaligned run whose every byte is an error, while the whole code point costs one.
+ */
+class utf8_levenshtein_nfa : public NFA<ll, char>{
+private:
+  int error;
+
+  // The state after `i` code points of the word with `e` errors. Phase 0 is between code points, phases 1..3 wait for
+  // that many more bytes of an inserted or substituted code point, phases 4..6 have matched 1..3 bytes of code point i.
+  ll state(size_t i, int e, int phase) const {
+    return ((ll) i * (this->error + 1) + e) * 8 + phase;
+  }
+public:
+  /**
+   * @brief Construct a new utf8_levenshtein_nfa object
+   *
+   * @param s the (UTF-8) string we wish to search.
+   * @param error the allowed deletes/insertions/substitutions of code points.
+   * @param am the alphabet of the dictionary: the automaton reads its symbols (the identity map reads bytes).
+   */
+  utf8_levenshtein_nfa(const std::string& s, int error, const alphabet_map& am = alphabet_map()) : error(error) {
+    std::vector<std::string> word = utf8_code_points(s);
+    size_t n = word.size();
+    std::vector<std::pair<char, int> > leads; // the symbols of the lead bytes, and the bytes that follow each
+    for(int sym = 0; sym < am.size(); ++sym){
+      int len = utf8_length(am.decode((char) sym));
+      if(len > 1) leads.push_back({(char) sym, len - 1});
+    }
+    this->add_start(state(0, 0, 0));
+    for(size_t i = 0; i <= n; ++i){
+      for(int e = 0; e <= error; ++e){
+        ll at = state(i, e, 0);
+        if(i < n){ // match
+          ll from = at;
+          for(size_t j = 0; j + 1 < word[i].size(); ++j){
+            this->add_transition(from, am.encode(word[i][j]), state(i, e, 4 + j));
+            from = state(i, e, 4 + j);
+          }
+          this->add_transition(from, am.encode(word[i].back()), state(i + 1, e, 0));
+        }
+        if(e == error) continue;
+        if(i < n) this->add_transition(at, nfa_val<char>::EPSILON, state(i + 1, e + 1, 0)); // delete
+        // insert (stay at i) or substitute (move past i) a code point: its lead byte, then the rest of it
+        for(size_t to = i; to <= std::min(i + 1, n); ++to){
+          this->add_transition(at, nfa_val<char>::STAR, state(to, e + 1, 0));
+          if(leads.size()) this->add_transition(state(i, e, 1), nfa_val<char>::STAR, state(to, e + 1, 0));
+        }
+        for(const std::pair<char, int>& lead : leads) this->add_transition(at, lead.first, state(i, e, lead.second));
+        for(int phase = 3; phase > 1 && leads.size(); --phase){
+          this->add_transition(state(i, e, phase), nfa_val<char>::STAR, state(i, e, phase - 1));
+        }
+      }
+    }
+    for(int e = 0; e <= error; ++e){
+      this->add_final_state(state(n, e, 0));
+    }
+  }
+};
@@ -0,0 +1,274 @@
+#pragma once
+
+#include "levenshtein_nfa.hpp"
+#include "FA/alphabet_map.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+
+/**
+ * @brief A Levenshtein automaton compiled into a dense transition table for scanning raw text without an
+ * index. The forward automaton is the Levenshtein DFA of the pattern with a STAR self-loop on its start state,
+ * so it accepts at every position where a substring of the text ending there is within `error` edits of the
+ * pattern. Bytes are mapped to the symbols of the pattern (plus one "other" symbol), so each state only has
+ * (# of distinct pattern bytes + 1) entries.
+ *
+ * Accepting positions come in runs; a hit is the position of the run with the smallest distance (runs are cut
+ * after `window()` positions). The start of the hit is found by running the Levenshtein DFA of the reversed
+ * pattern backwards from the end of the hit.
+ */
+class levenshtein_scanner {
+public:
+    /**
+     * @brief The state of a scan (so that a text can be fed to the scanner in pieces).
+     */
+    typedef struct _scan_cursor_t_ {
+        int32_t state;
+        ll run_start{-1};  // the first position of the current run of accepting positions (-1 if none)
+        ll run_best{-1};   // the position with the smallest distance in the current run
+        int best_distance{0};
+    } cursor_t;
+
+private:
+    alphabet_map amap;
+    int width;                        // the number of symbols (including "other")
+    size_t max_len;                   // pattern length + error
+    std::vector<int32_t> table, rtable;
+    std::vector<int8_t> distance, rdistance;
+    int32_t start, rstart;
+
+    // Builds a dense table out of the (default transition) DFA of the given NFA. Returns the start state.
+    int32_t compile(levenshtein_nfa& nfa, const std::string& pattern, std::vector<int32_t>& tbl,
+        std::vector<int8_t>& dist){
+        std::vector<std::unordered_set<ll> > subsets;
+        DFA<ll, char> dfa = nfa.convert_to_compressed_dfa(&subsets); // the states are 0 .. subsets.size() - 1
+        tbl.assign(subsets.size() * width, -1);
+        dist.assign(subsets.size(), -1);
+        for(size_t st = 0; st < subsets.size(); ++st){
+            int32_t* row = &tbl[st * width];
+            if(dfa.has_default_transition(st)){
+                std::fill(row, row + width, (int32_t) dfa.default_state(st));
+            }
+            dfa.for_each_transition(st, [&](char c, ll next){
+                row[(unsigned char) c] = (int32_t) next;
+            });
+            for(ll nfa_state : subsets[st]){
+                int e = nfa.errors(nfa_state);
+                if(nfa.position(nfa_state) == pattern.size() && (dist[st] < 0 || e < dist[st])) dist[st] = e;
+            }
+        }
+        return (int32_t) dfa.get_start();
+    }
+
+    template <class F>
+    void end_run(cursor_t& c, F& emit) const {
+        emit(c.run_best, c.best_distance);
+        c.run_start = c.run_best = -1;
+    }
+
+    // Feeds [from, to), stopping after the first position where the automaton does not accept if `until_idle`.
+    // Returns the position after the last position fed.
+    template <bool until_idle, class F>
+    ll scan(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F& emit) const {
+        const int32_t* tbl = this->table.data();
+        const int8_t* dist = this->distance.data();
+        int32_t st = c.state;
+        const char* p = buf + (from - buf_offset);
+        ll pos = from;
+        for(; pos < to; ++pos, ++p){
+            st = tbl[st * width + (unsigned char) amap.encode(*p)];
+            int d = dist[st];
+            if(d >= 0){
+                if(c.run_start < 0){
+                    c.run_start = c.run_best = pos;
+                    c.best_distance = d;
+                }else if(d < c.best_distance){
+                    c.run_best = pos;
+                    c.best_distance = d;
+                }
+                if(pos - c.run_start + 1 >= (ll) max_len) end_run(c, emit);
+            }else{
+                if(c.run_start >= 0) end_run(c, emit);
+                if(until_idle){ ++pos; break; }
+            }
+        }
+        c.state = st;
+        return pos;
+    }
+public:
+    /**
+     * @brief Construct a new levenshtein scanner object
+     *
+     * @param pattern the pattern we wish to search for.
+     * @param error the allowed deletes/insertions/substitutions (at least 0 and smaller than the length of the
+     * pattern, so that every hit is a non-empty match; throws otherwise).
+     */
+    levenshtein_scanner(const std::string& pattern, int error) : amap(pattern) {
+        if(error < 0 || (size_t) error >= pattern.size()){ // (otherwise the empty string would match everywhere)
+            throw std::runtime_error("The error must be at least 0 and smaller than the length of the pattern!");
+        }
+        this->width = amap.size() + 1;
+        this->max_len = pattern.size() + error;
+        std::string symbols = amap.encode(pattern);
+
+        levenshtein_nfa forward(symbols, error);
+        forward.add_transition(forward.state(0, 0), nfa_val<char>::STAR, forward.state(0, 0));
+        this->start = compile(forward, symbols, table, distance);
+
+        std::string reversed(symbols.rbegin(), symbols.rend());
+        levenshtein_nfa backward(reversed, error);
+        this->rstart = compile(backward, reversed, rtable, rdistance);
+    }
+
+    /**
+     * @brief The longest possible match. The state of the forward automaton only depends on the last `window()`
+     * bytes of the text.
+     *
+     * @return size_t the pattern length + the error.
+     */
+    size_t window() const {
+        return this->max_len;
+    }
+
+    /**
+     * @brief The number of states in the forward automaton.
+     *
+     * @return size_t the number of states.
+     */
+    size_t size() const {
+        return this->distance.size();
+    }
+
+    /**
+     * @brief Returns a cursor at the start of a text.
+     *
+     * @return cursor_t the cursor.
+     */
+    cursor_t begin() const {
+        cursor_t c;
+        c.state = this->start;
+        return c;
+    }
+
+    /**
+     * @brief Feeds the text at the absolute positions [from, to) to the scanner. `emit(end, distance)` is called
+     * for every hit whose run has been completed.
+     *
+     * @tparam F a callable (ll, int).
+     * @param c the cursor.
+     * @param buf the buffer, where buf[0] is at the absolute position `buf_offset`.
+     * @param buf_offset the absolute position of the buffer.
+     * @param from the first position to feed.
+     * @param to the position after the last position to feed.
+     * @param emit the hit callback.
+     */
+    template <class F>
+    void feed(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F emit) const {
+        scan<false>(c, buf, buf_offset, from, to, emit);
+    }
+
+    /**
+     * @brief Feeds the text like `feed`, up to and including the first position where the automaton does not
+     * accept. There is no run after that position, so from there on the scan is the same wherever it began (as
+     * long as it began at least a `window()` before).
+     *
+     * @tparam F a callable (ll, int).
+     * @param c the cursor.
+     * @param buf the buffer, where buf[0] is at the absolute position `buf_offset`.
+     * @param buf_offset the absolute position of the buffer.
+     * @param from the first position to feed.
+     * @param to the position after the last position that may be fed.
+     * @param emit the hit callback.
+     * @return ll the position after the non-accepting position, or `to` if there is none.
+     */
+    template <class F>
+    ll feed_until_idle(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F emit) const {
+        return scan<true>(c, buf, buf_offset, from, to, emit);
+    }
+
+    /**
+     * @brief The first position of the current run (every hit that has not been emitted yet ends at or after it).
+     *
+     * @param c the cursor.
+     * @return ll the position, or -1 if there is no run.
+     */
+    ll run_start(const cursor_t& c) const {
+        return c.run_start;
+    }
+
+    /**
+     * @brief Ends the text (emits the current run, if any).
+     *
+     * @tparam F a callable (ll, int).
+     * @param c the cursor.
+     * @param emit the hit callback.
+     */
+    template <class F>
+    void finish(cursor_t& c, F emit) const {
+        if(c.run_start >= 0) end_run(c, emit);
+    }
+
+    /**
+     * @brief Finds the start of the hit that ends at the given position (the shortest non-empty match with the
+     * given distance). The buffer must hold the `window()` bytes up to and including `end`.
+     *
+     * @param buf the buffer, where buf[0] is at the absolute position `buf_offset`.
+     * @param buf_offset the absolute position of the buffer.
+     * @param end the absolute position of the last byte of the hit.
+     * @param d the distance of the hit.
+     * @return ll the absolute position of the first byte of the hit.
+     */
+    ll match_start(const char* buf, ll buf_offset, ll end, int d) const {
+        int32_t st = this->rstart;
+        ll lowest = std::max(buf_offset, end - (ll) max_len + 1);
+        for(ll pos = end; pos >= lowest; --pos){
+            st = rtable[st * width + (unsigned char) amap.encode(buf[pos - buf_offset])];
+            if(st < 0) break;
+            if(rdistance[st] >= 0 && rdistance[st] <= d) return pos;
+        }
+        return lowest;
+    }
+};
+
+// A hit callback that drops the hits.
+struct ignore_hits {
+    template <class... A>
+    void operator()(A...) const {}
+};
+
+/**
+ * @brief Scans the part [begin, end) of a text of `len` bytes, so that scanning the parts of a text one by one
+ * (eg. in parallel) gives the same hits as scanning the whole text. A run of accepting positions is cut every
+ * `window()` positions from where it started, so a scan that starts inside a run cuts it elsewhere. Instead, a
+ * part owns the hits after the first position at or after `begin` where the automaton does not accept (the first
+ * part owns them all), up to and including that position of the next part: the scan of a part warms up a window
+ * before `begin`, skips to its first idle position, and then runs until the idle position of the next part
+ * (which is past `end`, and may be the end of the text if the text accepts at every position until then).
+ *
+ * @tparam S a scanner (`levenshtein_scanner` or `multi_levenshtein_scanner`).
+ * @tparam F the hit callback of the scanner.
+ * @param scanner the scanner.
+ * @param buf the text.
+ * @param len the length of the text.
+ * @param begin the first position of the part.
+ * @param end the position after the last position of the part.
+ * @param emit the hit callback.
+ */
+template <class S, class F>
+void scan_part(S& scanner, const char* buf, ll len, ll begin, ll end, F emit){
+    typename S::cursor_t c = scanner.begin();
+    ll from = 0;
+    if(begin > 0){
+        ignore_hits skip;
+        scanner.feed(c, buf, 0, std::max(0ll, begin - (ll) scanner.window()), begin, skip);
+        from = scanner.feed_until_idle(c, buf, 0, begin, len, skip);
+        if(from > end || from == len) return; // the previous part owns every hit up to there
+    }
+    scanner.feed(c, buf, 0, from, end, emit);
+    if(end < len) end = scanner.feed_until_idle(c, buf, 0, end, len, emit);
+    if(end == len) scanner.finish(c, emit);
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+#include "FA/DFA.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+
+#define LOUDS_TRIE_MAGIC        0x3153444cu    // "LDS1"
+#define RANK_BLOCK_WORDS        8              // a rank sample every 512 bits
+
+/**
+ * @brief A bit vector with rank and select. The number of set bits before every block of 512 bits is sampled (6%
+ * more space), so a rank is a sample and at most 8 popcounts, and a select is a binary search over the samples
+ * followed by a scan of one block.
+ */
+class rank_select_bits {
+private:
+    std::vector<uint64_t> bits;
+    std::vector<uint32_t> block_ranks;  // the set bits before every block
+    size_t n{0};
+
+    static size_t select_in_word(uint64_t w, size_t k){ // the position of the k-th (from 1) set bit of the word
+        for(size_t i = 1; i < k; ++i) w &= w - 1;
+        return __builtin_ctzll(w);
+    }
+
+    // The position of the k-th (from 1) set bit (or, if `zero`, unset bit).
+    size_t select(size_t k, bool zero) const {
+        auto before = [&](size_t b){ // the matching bits before block b
+            return zero ? b * RANK_BLOCK_WORDS * 64 - block_ranks[b] : block_ranks[b];
+        };
+        size_t lo = 0, hi = block_ranks.size(); // the last block with fewer than k matching bits before it
+        while(hi - lo > 1){
+            size_t mid = (lo + hi) / 2;
+            (before(mid) < k ? lo : hi) = mid;
+        }
+        k -= before(lo);
+        for(size_t w = lo * RANK_BLOCK_WORDS; w < bits.size(); ++w){
+            uint64_t word = zero ? ~bits[w] : bits[w];
+            size_t c = __builtin_popcountll(word);
+            if(c >= k) return w * 64 + select_in_word(word, k);
+            k -= c;
+        }
+        throw std::runtime_error("Select out of range!");
+    }
+public:
+    void push_back(bool b){
+        if(n % 64 == 0) bits.push_back(0);
+        if(b) bits.back() |= 1ULL << (n % 64);
+        ++n;
+    }
+
+    /**
+     * @brief Samples the ranks (must be called after the last `push_back` and before any rank or select).
+     *
+     */
+    void build(){
+        block_ranks.clear();
+        uint32_t r = 0;
+        for(size_t w = 0; w < bits.size(); ++w){
+            if(w % RANK_BLOCK_WORDS == 0) block_ranks.push_back(r);
+            r += __builtin_popcountll(bits[w]);
+        }
+        if(block_ranks.empty()) block_ranks.push_back(0);
+    }
+
+    bool get(size_t i) const {
+        return (bits[i / 64] >> (i % 64)) & 1;
+    }
+
+    /**
+     * @brief The number of set bits in [0, i).
+     */
+    size_t rank1(size_t i) const {
+        size_t w = i / 64, r = block_ranks[w / RANK_BLOCK_WORDS];
+        for(size_t x = w / RANK_BLOCK_WORDS * RANK_BLOCK_WORDS; x < w; ++x) r += __builtin_popcountll(bits[x]);
+        if(i % 64) r += __builtin_popcountll(bits[w] & ((1ULL << (i % 64)) - 1));
+        return r;
+    }
+
+    size_t rank0(size_t i) const {
+        return i - rank1(i);
+    }
+
+    /**
+     * @brief The position of the k-th (counting from 1) set bit.
+     */
+    size_t select1(size_t k) const {
+        return this->select(k, false);
+    }
+
+    /**
+     * @brief The position of the k-th (counting from 1) unset bit.
+     */
+    size_t select0(size_t k) const {
+        return this->select(k, true);
+    }
+
+    size_t size() const {
+        return this->n;
+    }
+
+    size_t memory() const {
+        return bits.capacity() * sizeof(uint64_t) + block_ranks.capacity() * sizeof(uint32_t);
+    }
+
+    void save(std::ostream& os) const {
+        uint64_t header[2] = {n, bits.size()};
+        os.write((char*) header, sizeof(header));
+        os.write((char*) bits.data(), bits.size() * sizeof(uint64_t));
+    }
+
+    bool load(std::istream& is){
+        uint64_t header[2];
+        if(!is.read((char*) header, sizeof(header))) return false;
+        n = header[0];
+        bits.resize(header[1]);
+        if(!is.read((char*) bits.data(), bits.size() * sizeof(uint64_t))) return false;
+        this->build();
+        return true;
+    }
+};
+
+/**
+ * @brief A read-only trie in LOUDS (level-order unary degree sequence) form. The nodes are numbered in breadth
+ * first order (the root is 0), and every node writes its degree in unary (a 1 per child, then a 0), so the tree is
+ * 2 bits per node. The children of node v are the 1s between the v-th and the (v + 1)-th 0, and since v 0s come
+ * before them, the 1 at position p is the child p - v + 1 (whose label is labels[p - v]). Along with a label byte
+ * and an accept bit, a node takes about 11 bits, against the hundreds of bytes of a state of a DFA.
+ *
+ * The trie has the traversal interface of a DFA (`get_start`, `is_accept`, `for_each_transition`, ...) with
+ * `ll` states, so the searches of the dictionary can run on it.
+ */
+class louds_trie {
+private:
+    rank_select_bits tree;
+    std::vector<char> labels;   // the label of the edge into node i + 1
+    rank_select_bits accept;
+
+    // The positions [first, last) of the 1s of the children of the node.
+    void child_range(ll v, size_t& first, size_t& last) const {
+        first = v == 0 ? 0 : tree.select0(v) + 1;
+        last = tree.select0(v + 1);
+    }
+public:
+    louds_trie(){ // just the root
+        tree.push_back(false);
+        accept.push_back(false);
+        tree.build();
+        accept.build();
+    }
+
+    /**
+     * @brief Builds the trie of the words of the dictionary (the dictionary may share states, eg. a DAWG, which
+     * the trie unfolds).
+     *
+     * @param dict the dictionary.
+     */
+    louds_trie(DFA<ll, char>& dict){
+        std::deque<ll> q{dict.get_start()};
+        while(q.size()){
+            ll state = q.front(); q.pop_front();
+            accept.push_back(dict.is_accept(state));
+            dict.for_each_transition(state, [&](char c, ll next){ // in (unsigned) label order
+                tree.push_back(true);
+                labels.push_back(c);
+                q.push_back(next);
+            });
+            tree.push_back(false);
+        }
+        tree.build();
+        accept.build();
+    }
+
+    ll get_start() const {
+        return 0;
+    }
+
+    bool is_accept(ll v) const {
+        return accept.get(v);
+    }
+
+    /**
+     * @brief Calls f(label, child) for every child of the node, in (unsigned) label order.
+     */
+    template <class F>
+    void for_each_transition(ll v, F f) const {
+        size_t first, last;
+        this->child_range(v, first, last);
+        for(size_t p = first; p < last; ++p) f(labels[p - v], (ll) (p - v + 1));
+    }
+
+    /**
+     * @brief The child of the node with the given label (-1 if there is none).
+     */
+    ll child(ll v, char c) const {
+        size_t first, last;
+        this->child_range(v, first, last);
+        auto begin = labels.begin() + (first - v), end = labels.begin() + (last - v);
+        auto it = std::lower_bound(begin, end, c, [](char a, char b){
+            return (unsigned char) a < (unsigned char) b;
+        });
+        return it != end && *it == c ? (ll) (it - labels.begin() + 1) : -1;
+    }
+
+    bool has_transition(ll v, char c) const {
+        return this->child(v, c) >= 0;
+    }
+
+    ll next_state(ll v, char c) const {
+        ll next = this->child(v, c);
+        if(next < 0) throw std::runtime_error("The edge does not exist!");
+        return next;
+    }
+
+    bool contains(const std::string& s) const {
+        ll v = 0;
+        for(char c : s){
+            if((v = this->child(v, c)) < 0) return false;
+        }
+        return this->is_accept(v);
+    }
+
+    /**
+     * @brief Returns the words of the trie that the automaton accepts (eg. a Levenshtein automaton), by following
+     * the trie and the automaton together.
+     *
+     * @param automaton the automaton.
+     * @return std::vector<std::string> the words, in (unsigned) byte order.
+     */
+    std::vector<std::string> search(DFA<ll, char>& automaton) const {
+        std::vector<std::string> ret;
+        std::string prefix;
+        std::vector<std::pair<ll, ll> > path; // (trie node, automaton state) for every prefix
+        std::vector<std::pair<size_t, size_t> > ranges; // the children left at every depth
+        auto enter = [&](ll v, ll q){
+            if(this->is_accept(v) && automaton.is_accept(q)) ret.push_back(prefix);
+            size_t first, last;
+            this->child_range(v, first, last);
+            path.push_back({v, q});
+            ranges.push_back({first, last});
+        };
+        enter(0, automaton.get_start());
+        while(ranges.size()){
+            std::pair<size_t, size_t>& r = ranges.back();
+            if(r.first == r.second){
+                ranges.pop_back(); path.pop_back();
+                if(prefix.size()) prefix.pop_back();
+                continue;
+            }
+            ll v = path.back().first, q = path.back().second;
+            size_t p = r.first++;
+            char c = labels[p - v];
+            if(!automaton.has_transition(q, c)) continue;
+            prefix.push_back(c);
+            enter(p - v + 1, automaton.next_state(q, c));
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Calls f(word) for every word of the trie, in (unsigned) byte order.
+     */
+    template <class F>
+    void for_each_word(F f) const {
+        std::string prefix;
+        std::function<void(ll)> walk = [&](ll v){
+            if(this->is_accept(v)) f(prefix);
+            this->for_each_transition(v, [&](char c, ll next){
+                prefix.push_back(c);
+                walk(next);
+                prefix.pop_back();
+            });
+        };
+        walk(0);
+    }
+
+    /**
+     * @brief The number of nodes.
+     */
+    size_t size() const {
+        return this->accept.size();
+    }
+
+    /**
+     * @brief The bytes used by the trie.
+     *
+     * @return size_t the bytes.
+     */
+    size_t memory() const {
+        return tree.memory() + labels.capacity() + accept.memory();
+    }
+
+    /**
+     * @brief Writes the trie to the stream.
+     *
+     * @param os the stream.
+     */
+    void save(std::ostream& os) const {
+        uint32_t magic = LOUDS_TRIE_MAGIC;
+        os.write((char*) &magic, sizeof(magic));
+        tree.save(os);
+        accept.save(os);
+        uint64_t n = labels.size();
+        os.write((char*) &n, sizeof(n));
+        os.write(labels.data(), n);
+    }
+
+    /**
+     * @brief Reads a trie written by `save`.
+     *
+     * @param is the stream.
+     * @return true if the trie was read.
+     * @return false if the stream does not hold a trie.
+     */
+    bool load(std::istream& is){
+        uint32_t magic;
+        if(!is.read((char*) &magic, sizeof(magic)) || magic != LOUDS_TRIE_MAGIC) return false;
+        if(!tree.load(is) || !accept.load(is)) return false;
+        uint64_t n;
+        if(!is.read((char*) &n, sizeof(n))) return false;
+        labels.resize(n);
+        return (bool) is.read(labels.data(), n);
+    }
+};
@@ -0,0 +1,386 @@
+#pragma once
+
+#include "levenshtein_nfa.hpp"
+#include "FA/alphabet_map.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+
+/**
+ * @brief The union of the Levenshtein NFAs of many patterns, with a shared start state (that has a STAR self-loop
+ * and an EPSILON to the start of every pattern). States are numbered 0..n-1, where 0 is the shared start.
+ */
+class levenshtein_union_nfa : public NFA<ll, char> {
+public:
+    std::vector<std::pair<int, int> > accepting; // state -> (pattern, distance), or (-1, -1)
+
+    /**
+     * @brief Construct a new levenshtein union nfa object
+     *
+     * @param patterns the (symbol encoded) patterns.
+     * @param errors the allowed error of each pattern.
+     */
+    levenshtein_union_nfa(const std::vector<std::string>& patterns, const std::vector<int>& errors){
+        this->add_start(0);
+        this->add_transition(0, nfa_val<char>::STAR, 0);
+        accepting.push_back({-1, -1});
+        for(size_t p = 0; p < patterns.size(); ++p){
+            levenshtein_nfa lnfa(patterns[p], errors[p]);
+            std::unordered_map<ll, ll> ids;
+            auto id = [&](ll s){
+                auto it = ids.find(s);
+                if(it != ids.end()) return it->second;
+                ll i = accepting.size();
+                accepting.push_back({-1, -1});
+                this->create_dfa(i);
+                return ids[s] = i;
+            };
+            this->add_transition(0, nfa_val<char>::EPSILON, id(lnfa.get_start()));
+            for(auto st : lnfa.states()){
+                ll from = id(st);
+                for(auto e : lnfa.transitions(st)) this->add_transition(from, e.first, id(e.second));
+                if(lnfa.is_accept(st)) accepting[from] = {(int) p, lnfa.errors(st)};
+            }
+        }
+    }
+
+    fa_map<ll, fa_set<ll> > closures(){
+        return epsilon_closures(*this);
+    }
+
+    // The (label, target) pairs of the node. STAR labels are returned as -1.
+    std::vector<std::pair<int, int32_t> > moves(ll node, const fa_map<ll, fa_set<ll> >& cl){
+        std::vector<std::pair<int, int32_t> > ret;
+        auto it = this->edge_map.find(node);
+        if(it == this->edge_map.end()) return ret;
+        for(auto e : it->second){
+            if(e.first.nfa_flag == nfa_val<char>::EPSILON) continue;
+            int label = e.first.nfa_flag == nfa_val<char>::STAR ? -1 : (unsigned char) (char) e.first;
+            for(ll t : cl.at(e.second)) ret.push_back({label, (int32_t) t});
+        }
+        return ret;
+    }
+};
+
+/**
+ * @brief Scans a text for many patterns at once. The union of the Levenshtein NFAs of the patterns is determinized
+ * lazily while scanning: a DFA state (a sorted set of NFA states) and its transition on a symbol are only
+ * computed the first time they are needed, and are cached in a dense table afterwards. If the cache grows past
+ * `max_states` states, it is thrown away and rebuilt from the current state.
+ *
+ * Hits are reported per pattern, in the same way as `levenshtein_scanner` (the position of a run of accepting
+ * positions with the smallest distance), along with the index of the pattern.
+ */
+class multi_levenshtein_scanner {
+public:
+    typedef struct _run_t_ {
+        ll start{-1};             // the first position of the run (-1 if there is no run)
+        ll best{-1};              // the position with the smallest distance in the run
+        ll last{-1};              // the last accepting position of the run
+        int distance{0};
+    } run_t;
+
+    /**
+     * @brief The state of a scan.
+     */
+    typedef struct _multi_scan_cursor_t_ {
+        int32_t state;
+        std::vector<run_t> runs;  // one run per pattern
+        std::vector<int> active;  // the patterns with a run
+    } cursor_t;
+
+private:
+    struct set_hash {
+        size_t operator()(const std::vector<int32_t>& x) const {
+            size_t h = 14695981039346656037ULL;
+            for(int32_t a : x) h = (h ^ (size_t) a) * 1099511628211ULL;
+            return h;
+        }
+    };
+
+    alphabet_map amap;
+    int width;
+    std::vector<std::string> patterns;
+    std::vector<int> errors;
+    size_t max_len;
+    size_t max_states;
+
+    // The flattened union NFA.
+    std::vector<std::vector<std::pair<int, int32_t> > > moves;   // state -> (symbol or -1 for STAR, target)
+    std::vector<std::pair<int, int> > accepting;                 // state -> (pattern, distance)
+    std::vector<int32_t> start_set;
+
+    // The lazily built DFA.
+    std::unordered_map<std::vector<int32_t>, int32_t, set_hash> ids;
+    std::vector<std::vector<int32_t> > sets;
+    std::vector<int32_t> table;                                  // -1: not computed yet
+    std::vector<std::vector<std::pair<int, int> > > accepts;     // DFA state -> (pattern, min distance)
+
+    int32_t intern(std::vector<int32_t>& set){
+        auto it = ids.find(set);
+        if(it != ids.end()) return it->second;
+        int32_t id = sets.size();
+        std::unordered_map<int, int> best;
+        for(int32_t q : set){
+            std::pair<int, int> acc = accepting[q];
+            if(acc.first < 0) continue;
+            auto b = best.find(acc.first);
+            if(b == best.end() || acc.second < b->second) best[acc.first] = acc.second;
+        }
+        accepts.push_back(std::vector<std::pair<int, int> >(best.begin(), best.end()));
+        sets.push_back(set);
+        table.resize(table.size() + width, -1);
+        ids[set] = id;
+        return id;
+    }
+
+    void reset_cache(){
+        ids.clear(); sets.clear(); table.clear(); accepts.clear();
+    }
+
+    int32_t next(int32_t st, int sym){
+        int32_t t = table[st * width + sym];
+        if(t >= 0) return t;
+        std::vector<int32_t> out;
+        for(int32_t q : sets[st]){
+            for(auto& mv : moves[q]){
+                if(mv.first == sym || mv.first == -1) out.push_back(mv.second);
+            }
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        if(sets.size() >= max_states){ // the cache is full, keep only the state we are in
+            std::vector<int32_t> cur = sets[st];
+            reset_cache();
+            st = intern(cur);
+        }
+        t = intern(out);
+        table[st * width + sym] = t;
+        return t;
+    }
+
+    ll end_run(run_t& r){
+        ll best = r.best;
+        r.start = r.best = r.last = -1;
+        return best;
+    }
+public:
+    /**
+     * @brief Construct a new multi levenshtein scanner object
+     *
+     * @param patterns the patterns we wish to search for.
+     * @param errors the allowed deletes/insertions/substitutions of each pattern (at least 0 and smaller than the
+     * length of the pattern, so that every hit is a non-empty match; throws otherwise).
+     * @param max_states the largest number of DFA states that are cached.
+     */
+    multi_levenshtein_scanner(const std::vector<std::string>& patterns, const std::vector<int>& errors,
+        size_t max_states = 1 << 14) : amap(std::string()), patterns(patterns), errors(errors), max_len(0),
+        max_states(max_states) {
+        std::string all;
+        for(size_t p = 0; p < patterns.size(); ++p){
+            if(errors[p] < 0 || (size_t) errors[p] >= patterns[p].size()){
+                throw std::runtime_error("The error must be at least 0 and smaller than the length of the pattern!");
+            }
+            all += patterns[p];
+            max_len = std::max(max_len, patterns[p].size() + errors[p]);
+        }
+        this->amap = alphabet_map(all);
+        this->width = amap.size() + 1;
+        std::vector<std::string> symbols;
+        for(const std::string& p : patterns) symbols.push_back(amap.encode(p));
+
+        levenshtein_union_nfa nfa(symbols, errors);
+        fa_map<ll, fa_set<ll> > cl = nfa.closures();
+        for(size_t q = 0; q < nfa.accepting.size(); ++q) moves.push_back(nfa.moves(q, cl));
+        this->accepting = nfa.accepting;
+        for(ll q : cl[0]) start_set.push_back((int32_t) q);
+        std::sort(start_set.begin(), start_set.end());
+    }
+
+    multi_levenshtein_scanner(const multi_levenshtein_scanner& other) = default;
+
+    /**
+     * @brief The longest possible match of any pattern.
+     *
+     * @return size_t the largest pattern length + error.
+     */
+    size_t window() const {
+        return this->max_len;
+    }
+
+    /**
+     * @brief The number of DFA states that are currently cached.
+     *
+     * @return size_t the number of states.
+     */
+    size_t size() const {
+        return this->sets.size();
+    }
+
+    size_t pattern_count() const {
+        return this->patterns.size();
+    }
+
+    const std::string& pattern(int p) const {
+        return this->patterns[p];
+    }
+
+    /**
+     * @brief Returns a cursor at the start of a text (the cache may be rebuilt).
+     *
+     * @return cursor_t the cursor.
+     */
+    cursor_t begin(){
+        cursor_t c;
+        if(sets.size() >= max_states) reset_cache();
+        c.state = intern(start_set);
+        c.runs.resize(patterns.size());
+        return c;
+    }
+
+    /**
+     * @brief Feeds the text at the absolute positions [from, to) to the scanner. `emit(end, distance, pattern)` is
+     * called for every hit whose run has been completed.
+     *
+     * @tparam F a callable (ll, int, int).
+     * @param c the cursor.
+     * @param buf the buffer, where buf[0] is at the absolute position `buf_offset`.
+     * @param buf_offset the absolute position of the buffer.
+     * @param from the first position to feed.
+     * @param to the position after the last position to feed.
+     * @param emit the hit callback.
+     */
+    template <class F>
+    void feed(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F emit){
+        scan<false>(c, buf, buf_offset, from, to, emit);
+    }
+
+    /**
+     * @brief Feeds the text like `feed`, up to and including the first position where no pattern accepts. There
+     * is no run after that position, so from there on the scan is the same wherever it began (as long as it began
+     * at least a `window()` before).
+     *
+     * @tparam F a callable (ll, int, int).
+     * @param c the cursor.
+     * @param buf the buffer, where buf[0] is at the absolute position `buf_offset`.
+     * @param buf_offset the absolute position of the buffer.
+     * @param from the first position to feed.
+     * @param to the position after the last position that may be fed.
+     * @param emit the hit callback.
+     * @return ll the position after the non-accepting position, or `to` if there is none.
+     */
+    template <class F>
+    ll feed_until_idle(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F emit){
+        return scan<true>(c, buf, buf_offset, from, to, emit);
+    }
+
+private:
+    // Feeds [from, to), stopping after the first position where no pattern accepts if `until_idle`. Returns the
+    // position after the last position fed.
+    template <bool until_idle, class F>
+    ll scan(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F& emit){
+        int32_t st = c.state;
+        const char* p = buf + (from - buf_offset);
+        ll pos = from;
+        for(; pos < to; ++pos, ++p){
+            st = next(st, (unsigned char) amap.encode(*p));
+            const std::vector<std::pair<int, int> >& acc = accepts[st];
+            if(acc.empty() && c.active.empty()){
+                if(until_idle){ ++pos; break; }
+                continue;
+            }
+            for(auto& a : acc){
+                run_t& r = c.runs[a.first];
+                if(r.start < 0){
+                    r.start = r.best = pos;
+                    r.distance = a.second;
+                    c.active.push_back(a.first);
+                }else if(a.second < r.distance){
+                    r.best = pos;
+                    r.distance = a.second;
+                }
+                r.last = pos;
+            }
+            for(size_t i = 0; i < c.active.size(); ){
+                int pt = c.active[i];
+                run_t& r = c.runs[pt];
+                bool done = r.last != pos || pos - r.start + 1 >= (ll) (patterns[pt].size() + errors[pt]);
+                if(done){
+                    int d = r.distance;
+                    c.active[i] = c.active.back(); c.active.pop_back();
+                    emit(end_run(r), d, pt);
+                }else{
+                    ++i;
+                }
+            }
+            if(until_idle && acc.empty()){ ++pos; break; }
+        }
+        c.state = st;
+        return pos;
+    }
+public:
+
+    /**
+     * @brief The first position of the earliest current run (every hit that has not been emitted yet ends at or
+     * after it).
+     *
+     * @param c the cursor.
+     * @return ll the position, or -1 if there is no run.
+     */
+    ll run_start(const cursor_t& c) const {
+        ll ret = -1;
+        for(int pt : c.active){
+            if(ret < 0 || c.runs[pt].start < ret) ret = c.runs[pt].start;
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Ends the text (emits every current run).
+     *
+     * @tparam F a callable (ll, int, int).
+     * @param c the cursor.
+     * @param emit the hit callback.
+     */
+    template <class F>
+    void finish(cursor_t& c, F emit){
+        for(int pt : c.active){
+            int d = c.runs[pt].distance;
+            emit(end_run(c.runs[pt]), d, pt);
+        }
+        c.active.clear();
+    }
+
+    /**
+     * @brief Finds the start of the hit of the given pattern that ends at the given position (the shortest match
+     * with at most the given distance). The buffer must hold the `window()` bytes up to and including `end`.
+     *
+     * @param buf the buffer, where buf[0] is at the absolute position `buf_offset`.
+     * @param buf_offset the absolute position of the buffer.
+     * @param end the absolute position of the last byte of the hit.
+     * @param d the distance of the hit.
+     * @param pt the pattern of the hit.
+     * @return ll the absolute position of the first byte of the hit.
+     */
+    ll match_start(const char* buf, ll buf_offset, ll end, int d, int pt) const {
+        const std::string& pat = patterns[pt];
+        int m = pat.size();
+        // dist[j] is the distance between the last j bytes of the pattern and the text in (pos, end].
+        std::vector<int> dist(m + 1), prev(m + 1);
+        for(int j = 0; j <= m; ++j) dist[j] = j;
+        ll lowest = std::max(buf_offset, end - (ll) (m + errors[pt]) + 1);
+        for(ll pos = end; pos >= lowest; --pos){
+            char c = buf[pos - buf_offset];
+            prev.swap(dist);
+            dist[0] = prev[0] + 1;
+            for(int j = 1; j <= m; ++j){
+                dist[j] = std::min(std::min(prev[j] + 1, dist[j - 1] + 1), prev[j - 1] + (pat[m - j] != c));
+            }
+            if(dist[m] <= d) return pos;
+        }
+        return lowest;
+    }
+};
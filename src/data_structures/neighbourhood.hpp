@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * @file neighbourhood.hpp
+ * @brief The neighbourhood of a word: every string within k edits of it. For a short word and a small k it is small
+ * enough to look every string up in the dictionary (a few hundred exact lookups for k = 1), which is cheaper than
+ * building a Levenshtein automaton and walking the dictionary with it.
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+
+// Adds every string within `error` edits of the word (over the symbols 0..sigma-1) to the set.
+inline void edit_neighbourhood(std::string& word, int error, int sigma, std::unordered_set<std::string>& out){
+    out.insert(word);
+    if(error <= 0) return;
+    for(size_t i = 0; i <= word.size(); ++i){
+        for(int c = 0; c < sigma; ++c){ // insert c before word[i]
+            word.insert(word.begin() + i, (char) c);
+            edit_neighbourhood(word, error - 1, sigma, out);
+            word.erase(i, 1);
+        }
+        if(i == word.size()) break;
+        char old = word[i];
+        word.erase(i, 1); // delete word[i]
+        edit_neighbourhood(word, error - 1, sigma, out);
+        word.insert(word.begin() + i, old);
+        for(int c = 0; c < sigma; ++c){ // substitute word[i]
+            if((char) c == old) continue;
+            word[i] = (char) c;
+            edit_neighbourhood(word, error - 1, sigma, out);
+        }
+        word[i] = old;
+    }
+}
+
+/**
+ * @brief The strings of the dictionary within `error` edits of the word, in (unsigned) label order, found by looking
+ * up every string of its neighbourhood.
+ *
+ * @tparam F bool(const std::string&), whether the dictionary has the string.
+ * @param word the (encoded) word.
+ * @param error the allowed deletes/insertions/substitutions.
+ * @param sigma the size of the alphabet (the symbols are 0..sigma-1).
+ * @param contains the lookup.
+ * @param looked_up if not NULL, set to the number of strings that were looked up.
+ * @return std::vector<std::string> the strings of the dictionary.
+ */
+template <class F>
+std::vector<std::string> neighbourhood_matches(const std::string& word, int error, int sigma, F contains,
+    size_t* looked_up = NULL){
+    std::unordered_set<std::string> strings;
+    std::string w = word;
+    edit_neighbourhood(w, error, sigma, strings);
+    std::vector<std::string> ret;
+    for(const std::string& s : strings){
+        if(contains(s)) ret.push_back(s);
+    }
+    std::sort(ret.begin(), ret.end());
+    if(looked_up) *looked_up = strings.size();
+    return ret;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "FA/DFA.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdint.h>
+
+#define QGRAM_BUCKETS   (1 << 20)
+
+typedef struct qgram_match_t {
+    ll start;       // the match is text[start, end)
+    ll end;
+    int distance;
+} qgram_match;
+
+/**
+ * @brief A q-gram inverted index over a document, for approximate searches of long patterns. By the q-gram lemma,
+ * a substring within k edits of a pattern of length m shares at least m + 1 - (k + 1)q of the pattern's q-grams,
+ * and (as every edit shifts the alignment by at most one diagonal) those hits lie on k + 1 consecutive diagonals.
+ * A search counts the hits of the pattern's q-grams per band of k + 1 diagonals, and only the windows of the bands
+ * that reach the threshold are verified with an edit distance.
+ *
+ * The postings are kept in one array indexed by the hash of the q-gram (q-grams that share a bucket only add
+ * hits, so the filter never loses a match).
+ */
+class qgram_index {
+private:
+    std::string text;
+    int q{4};
+    std::vector<uint32_t> bucket_offsets;   // bucket b lists positions[bucket_offsets[b], bucket_offsets[b + 1])
+    std::vector<uint32_t> positions;        // the start of every q-gram in the text
+    std::vector<ll> line_starts;            // the offset of the first character of every line
+
+    static uint32_t bucket(const char* s, int q){
+        uint32_t h = 2166136261u;
+        for(int i = 0; i < q; ++i) h = (h ^ (unsigned char) s[i]) * 16777619u;
+        return h & (QGRAM_BUCKETS - 1);
+    }
+
+    // Semi-global edit distance of the pattern against text[lo, hi) (a match may start and end anywhere), with
+    // Ukkonen's cutoff: only the rows up to the last one within k are computed. Calls found(end, d) for every end
+    // where the whole pattern is within k.
+    template <class F>
+    void verify(const std::string& p, int k, ll lo, ll hi, F found) const {
+        int m = p.size();
+        std::vector<int> col(m + 1);
+        for(int i = 0; i <= m; ++i) col[i] = std::min(i, k + 1); // distances above k are all stored as k + 1
+        int last = std::min(m, k);
+        for(ll j = lo; j < hi; ++j){
+            char c = text[j];
+            int diag = 0, top = std::min(m, last + 1);
+            for(int i = 1; i <= top; ++i){
+                int up = col[i];
+                col[i] = std::min(std::min(std::min(up + 1, col[i - 1] + 1), diag + (p[i - 1] != c)), k + 1);
+                diag = up;
+            }
+            last = top;
+            while(last > 0 && col[last] > k) --last;
+            if(last == m) found(j + 1, col[m]);
+        }
+    }
+
+    // The largest start of a substring that ends at `end` and is within d edits of the pattern.
+    ll match_start(const std::string& p, ll end, int d) const {
+        int m = p.size();
+        std::vector<int> col(m + 1);
+        for(int i = 0; i <= m; ++i) col[i] = i;     // col[i] = ed(p[m - i, m), text[s, end))
+        if(col[m] <= d) return end;
+        for(ll s = end - 1; s >= 0 && s >= end - m - d; --s){
+            int diag = col[0];
+            col[0] = end - s;
+            for(int i = 1; i <= m; ++i){
+                int up = col[i];
+                col[i] = std::min(std::min(col[i] + 1, col[i - 1] + 1), diag + (p[m - i] != text[s]));
+                diag = up;
+            }
+            if(col[m] <= d) return s;
+        }
+        return std::max((ll) 0, end - m - d);
+    }
+public:
+    qgram_index(){}
+
+    /**
+     * @brief Builds the q-gram index of the text.
+     *
+     * @param text the document.
+     * @param q the length of the q-grams.
+     */
+    qgram_index(const std::string& text, int q = 4) : text(text), q(q) {
+        bucket_offsets.assign(QGRAM_BUCKETS + 1, 0);
+        ll n = text.size();
+        for(ll i = 0; i + q <= n; ++i) ++bucket_offsets[bucket(text.data() + i, q) + 1];
+        for(size_t b = 0; b < QGRAM_BUCKETS; ++b) bucket_offsets[b + 1] += bucket_offsets[b];
+        positions.resize(bucket_offsets.back());
+        std::vector<uint32_t> fill(bucket_offsets.begin(), bucket_offsets.end() - 1);
+        for(ll i = 0; i + q <= n; ++i) positions[fill[bucket(text.data() + i, q)]++] = i;
+        line_starts.push_back(0);
+        for(ll i = 0; i < n; ++i){
+            if(text[i] == '\n') line_starts.push_back(i + 1);
+        }
+    }
+
+    /**
+     * @brief The number of q-grams of the pattern that a match within k edits must share with the text.
+     *
+     * @return ll the threshold (a match can share no q-grams if it is not positive).
+     */
+    static ll threshold(ll m, int k, int q){
+        return m + 1 - (ll) (k + 1) * q;
+    }
+
+    /**
+     * @brief Finds the substrings of the text within k edits of the pattern. Overlapping substrings within the
+     * error are reported once, by the end with the smallest distance (and the shortest start for that end).
+     *
+     * @param p the pattern.
+     * @param k the error.
+     * @param verified if not NULL, set to the number of characters of the text that were verified.
+     * @return std::vector<qgram_match> the matches, ordered by their end.
+     */
+    std::vector<qgram_match> search(const std::string& p, int k, ll* verified = NULL) const {
+        ll m = p.size(), n = text.size();
+        std::vector<std::pair<ll, ll> > windows;
+        ll t = threshold(m, k, q);
+        if(t <= 0){
+            windows.push_back({0, n}); // the filter cannot rule anything out
+        }else{
+            ll width = k + 1;
+            std::unordered_map<ll, ll> hits; // band -> the hits on its diagonals
+            for(ll i = 0; i + q <= m; ++i){
+                uint32_t b = bucket(p.data() + i, q);
+                for(uint32_t x = bucket_offsets[b]; x < bucket_offsets[b + 1]; ++x){
+                    ll diagonal = (ll) positions[x] - i + m; // shifted so that it is not negative
+                    ++hits[diagonal / width];
+                }
+            }
+            for(auto h : hits){
+                auto next = hits.find(h.first + 1);
+                if(h.second + (next == hits.end() ? 0 : next->second) < t) continue;
+                ll start = h.first * width - m; // the first diagonal of the band (ie. the start of the alignment)
+                windows.push_back({std::max((ll) 0, start - k), std::min(n, start + 2 * width + m + k)});
+            }
+            std::sort(windows.begin(), windows.end());
+            std::vector<std::pair<ll, ll> > merged;
+            for(auto w : windows){
+                if(merged.size() && w.first <= merged.back().second){
+                    merged.back().second = std::max(merged.back().second, w.second);
+                }else{
+                    merged.push_back(w);
+                }
+            }
+            windows.swap(merged);
+        }
+
+        std::vector<qgram_match> ret;
+        ll total = 0;
+        for(auto w : windows){
+            total += w.second - w.first;
+            ll run_end = -1, best_end = -1; int best = 0;
+            auto flush = [&](){
+                if(best_end >= 0) ret.push_back({match_start(p, best_end, best), best_end, best});
+                best_end = -1;
+            };
+            verify(p, k, w.first, w.second, [&](ll end, int d){
+                if(end != run_end + 1) flush(); // a new run of ends
+                if(best_end < 0 || d < best){ best_end = end; best = d; }
+                run_end = end;
+            });
+            flush();
+        }
+        if(verified) *verified = total;
+        return ret;
+    }
+
+    /**
+     * @brief The line and the column (both starting at 1) of an offset of the text.
+     *
+     * @param pos the offset.
+     * @return std::pair<ll, ll> the line and the column.
+     */
+    std::pair<ll, ll> line_col(ll pos) const {
+        ll line = std::upper_bound(line_starts.begin(), line_starts.end(), pos) - line_starts.begin();
+        return {line, pos - line_starts[line - 1] + 1};
+    }
+
+    /**
+     * @brief The text of a match.
+     */
+    std::string substr(const qgram_match& match) const {
+        return text.substr(match.start, match.end - match.start);
+    }
+
+    const std::string& get_text() const {
+        return this->text;
+    }
+
+    int get_q() const {
+        return this->q;
+    }
+
+    size_t memory() const {
+        return text.capacity() + (bucket_offsets.capacity() + positions.capacity()) * sizeof(uint32_t)
+            + line_starts.capacity() * sizeof(ll);
+    }
+};
@@ -0,0 +1,357 @@
+#pragma once
+
+/**
+ * @file query_planner.hpp
+ * @brief Chooses how a query is answered. Every search engine of the repo answers the same question (the words, or
+ * the chunks of a document, within k edits of a query), but their costs grow with different things: a neighbourhood
+ * with the alphabet and k, the automaton walk with the fan-out of the dictionary, the pigeonhole partition with the
+ * number of occurrences of the pieces. The planner keeps a few statistics of the dictionary, estimates the cost of
+ * every strategy that can answer the query, and picks the cheapest.
+ */
+
+#include "FA/DFA.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <algorithm>
+#include <stdint.h>
+#include <stddef.h>
+
+#define PLAN_HASH_COST          8.0     // a hash probe (in steps of a walk)
+#define PLAN_BUILD_COST         24.0    // a state of the Levenshtein DFA (interned while it is determinized)
+#define PLAN_NEIGHBOUR_COST     4.0     // a string of the neighbourhood (it is made, hashed and deduplicated)
+
+enum class search_strategy {
+    exact,              // follow the word (k = 0)
+    neighbourhood,      // look up every string within k edits of the word
+    deletion_index,     // the symmetric delete index (see deletion_index.hpp)
+    partition,          // split the word into k + 1 pieces, one of which matches exactly (pigeonhole)
+    automaton           // walk the dictionary together with the Levenshtein automaton (see match_iterator.hpp)
+};
+
+#define STRATEGIES      5
+
+inline const char* strategy_name(search_strategy s){
+    static const char* names[STRATEGIES] = {"exact", "neighbourhood", "deletion index", "partition", "automaton"};
+    return names[(int) s];
+}
+
+/**
+ * @brief The shape of an acyclic dictionary: the number of distinct prefixes of every length (the nodes per depth of
+ * the trie of its words, so the fan-out of a depth is the ratio of two of them) and the number of words of every
+ * length. A DAWG shares its states between prefixes, so the states are weighed by the number of paths that reach
+ * them, one depth at a time.
+ */
+class index_stats {
+private:
+    std::vector<double> nodes;      // nodes[d]: the prefixes of length d
+    std::vector<double> lengths;    // lengths[d]: the words of length d
+    double total{0};
+    size_t sigma{0};
+public:
+    /**
+     * @brief Empty statistics (the planner then assumes that every prefix exists).
+     *
+     * @param alphabet the size of the alphabet.
+     */
+    index_stats(size_t alphabet = 0) : sigma(alphabet) {}
+
+    /**
+     * @brief The statistics of a dictionary.
+     *
+     * @tparam D the dictionary (`get_start`, `is_accept` and `for_each_transition`, eg. a DFA<ll, char>).
+     * @param dict the dictionary (it must be acyclic).
+     * @param alphabet the size of the alphabet.
+     * @param max_depth the deepest prefixes that are counted.
+     */
+    template <class D>
+    index_stats(D& dict, size_t alphabet, size_t max_depth = SIZE_MAX) : sigma(alphabet) {
+        std::unordered_map<ll, double> frontier{{dict.get_start(), 1}}, next;
+        for(size_t d = 0; frontier.size() && d <= max_depth; ++d){
+            double prefixes = 0, words = 0;
+            next.clear();
+            for(const std::pair<const ll, double>& s : frontier){
+                prefixes += s.second;
+                if(dict.is_accept(s.first)) words += s.second;
+                dict.for_each_transition(s.first, [&](char, ll child){ next[child] += s.second; });
+            }
+            nodes.push_back(prefixes);
+            lengths.push_back(words);
+            total += words;
+            frontier.swap(next);
+        }
+    }
+
+    /**
+     * @brief The statistics of a sorted list of words (eg. the chunks of a document, which are far cheaper to sort
+     * than to count in a suffix tree of a million states). The prefixes of length d that are new are those of the
+     * words that share less than d characters with the word before them.
+     *
+     * @tparam F std::string(size_t), the word i (in sorted order, repeats allowed).
+     * @param n the number of words.
+     * @param word the words.
+     * @param alphabet the size of the alphabet.
+     */
+    template <class F>
+    index_stats(size_t n, F word, size_t alphabet) : sigma(alphabet) {
+        std::string prev;
+        for(size_t i = 0; i < n; ++i){
+            std::string w = word(i);
+            size_t common = 0;
+            while(i && common < std::min(w.size(), prev.size()) && w[common] == prev[common]) ++common;
+            if(nodes.size() <= w.size()){
+                nodes.resize(w.size() + 1, 0);
+                lengths.resize(w.size() + 1, 0);
+            }
+            if(i && common == w.size() && prev.size() == w.size()) continue; // a repeat
+            for(size_t d = i ? common + 1 : 0; d <= w.size(); ++d) ++nodes[d];
+            ++lengths[w.size()];
+            ++total;
+            prev.swap(w);
+        }
+    }
+
+    /**
+     * @brief The number of distinct prefixes of length d (0 past the longest word).
+     */
+    double nodes_at(size_t d) const {
+        return d < nodes.size() ? nodes[d] : 0;
+    }
+
+    /**
+     * @brief The average number of children of a prefix of length d.
+     */
+    double fanout(size_t d) const {
+        return this->nodes_at(d) > 0 ? this->nodes_at(d + 1) / this->nodes_at(d) : 0;
+    }
+
+    /**
+     * @brief The number of words of length d.
+     */
+    double words_of_length(size_t d) const {
+        return d < lengths.size() ? lengths[d] : 0;
+    }
+
+    double words() const {
+        return this->total;
+    }
+
+    /**
+     * @brief The length of the longest prefix (0 if there are no statistics).
+     */
+    size_t depth() const {
+        return nodes.empty() ? 0 : nodes.size() - 1;
+    }
+
+    size_t alphabet() const {
+        return this->sigma;
+    }
+
+    bool empty() const {
+        return nodes.empty();
+    }
+};
+
+typedef struct query_plan_t {
+    search_strategy strategy{search_strategy::automaton};
+    double cost{0};
+    std::vector<std::pair<search_strategy, double> > costs;    // every strategy that could answer the query
+} query_plan;
+
+/**
+ * @brief Estimates the cost (in steps of a walk over the dictionary) of every strategy that can answer a query, and
+ * picks the cheapest. The automaton and the exact match can answer every query; the other strategies are used only
+ * if they are enabled (the deletion index must be loaded, a partition needs a document).
+ */
+class query_planner {
+private:
+    const index_stats& stats;
+    bool prefixes{false};               // the matches are prefixes of the words (the chunks of a suffix tree)
+    uint32_t index_error{0};            // the largest error of the deletion index (0: not loaded)
+    uint32_t index_prefix{0};
+    double index_bucket{0};
+    size_t chunk{0};                    // the length of the chunks a partition verifies (0: no partition)
+    double positions{0};                // the positions of the chunks
+    bool code_points{false};            // the errors are counted in UTF-8 code points
+
+    static double choose(double n, double r){
+        double ret = 1;
+        for(double i = 0; i < r; ++i) ret = ret * (n - i) / (i + 1);
+        return std::max(ret, 0.0);
+    }
+
+    // The prefixes of length d (every string of the alphabet if there are no statistics).
+    double prefixes_at(size_t d) const {
+        if(!stats.empty()) return stats.nodes_at(d);
+        double ret = 1;
+        for(size_t i = 0; i < d && ret < 1e18; ++i) ret *= stats.alphabet();
+        return ret;
+    }
+
+    // The prefixes of length d within k edits of a prefix of the word (and so entered by the walk): the strings of
+    // length d within k edits, times the share of the strings of length d that are prefixes.
+    double live_at(size_t d, int k) const {
+        double within = 0, power = 1, strings = 1;
+        for(int i = 0; i <= k; ++i, power *= stats.alphabet()) within += choose(d, i) * power;
+        for(size_t i = 0; i < d; ++i) strings *= std::max((size_t) 1, stats.alphabet());
+        return this->prefixes_at(d) * std::min(1.0, within / strings);
+    }
+public:
+    query_planner(const index_stats& stats) : stats(stats) {}
+
+    /**
+     * @brief The matches are the prefixes of the words that start with something within the error (eg. the chunks
+     * of a suffix tree), so a walk goes on below the end of the query, and no exact lookup or neighbourhood applies.
+     */
+    void match_prefixes(){
+        this->prefixes = true;
+    }
+
+    /**
+     * @brief The errors are counted in UTF-8 code points (see utf8_levenshtein_nfa), which only the automaton does: the
+     * neighbourhood, the deletion index and the partition edit and verify bytes, so they only answer exact queries.
+     */
+    void count_code_points(){
+        this->code_points = true;
+    }
+
+    /**
+     * @brief Enables the deletion index.
+     *
+     * @param max_error the largest error of the index.
+     * @param prefix_length the prefix of the words whose deletions are indexed.
+     * @param bucket_size the average number of words in a bucket.
+     */
+    void use_deletion_index(uint32_t max_error, uint32_t prefix_length, double bucket_size){
+        this->index_error = max_error;
+        this->index_prefix = prefix_length;
+        this->index_bucket = bucket_size;
+    }
+
+    /**
+     * @brief Enables the pigeonhole partition.
+     *
+     * @param chunk_size the length of the chunks that are verified.
+     * @param positions the number of positions of the chunks (the length of the document).
+     */
+    void use_partition(size_t chunk_size, double positions){
+        this->chunk = chunk_size;
+        this->positions = positions;
+    }
+
+    double exact_cost(size_t m) const {
+        return m + 1;
+    }
+
+    /**
+     * @brief The strings within k edits of the word (the substitutions, deletions and insertions of every edit,
+     * counted with their repeats) and a lookup of each.
+     */
+    double neighbourhood_cost(size_t m, int k) const {
+        double n = 1, sigma = stats.alphabet();
+        for(int i = 0; i < k; ++i) n = n * (1 + (m + i) * sigma + (m + i + 1) * sigma) / (i + 1);
+        return n * (PLAN_NEIGHBOUR_COST + m + k);
+    }
+
+    /**
+     * @brief The deletions of the prefix of the word (a probe each), the words of their buckets and their check. The
+     * buckets of short deletions are shared by every word below them, so a probe finds at least the words below a
+     * prefix of the length of the shortest deletion.
+     */
+    double deletion_index_cost(size_t m, int k) const {
+        double p = std::min((size_t) index_prefix, m), probes = 0;
+        for(int i = 0; i <= k; ++i) probes += choose(p, i);
+        size_t shortest = p > k ? p - k : 0;
+        double bucket = std::max(index_bucket, stats.words() / std::max(1.0, this->prefixes_at(shortest)));
+        return probes * (p + PLAN_HASH_COST) + probes * bucket * ((2 * k + 1) * m + m + PLAN_HASH_COST);
+    }
+
+    /**
+     * @brief The Levenshtein DFA, then the prefixes of the dictionary the walk enters (and their children). The walk
+     * of the chunks goes on to their end below every prefix that matched.
+     */
+    double automaton_cost(size_t m, int k) const {
+        double ret = PLAN_BUILD_COST * (m + 1) * (2 * k + 1) * (k + 1);
+        size_t end = m + k, depth = stats.empty() ? end : std::min(end, stats.depth());
+        for(size_t d = 0; d <= depth; ++d) ret += this->live_at(d, k) * (1 + stats.fanout(d));
+        if(!prefixes || stats.empty() || end >= stats.depth()) return ret;
+        double matched = this->live_at(end, k) / std::max(1.0, stats.nodes_at(end));
+        for(size_t d = end + 1; d <= stats.depth(); ++d) ret += matched * stats.nodes_at(d);
+        return ret;
+    }
+
+    /**
+     * @brief The occurrences of the k + 1 pieces (the positions are spread evenly over the distinct prefixes of the
+     * length of a piece), then the verification of the 2k + 1 starts around each.
+     */
+    double partition_cost(size_t m, int k) const {
+        double pieces = k + 1, length = m / (k + 1);
+        double occurrences = positions / std::max(1.0, this->prefixes_at(length));
+        double candidates = pieces * occurrences * (2 * k + 1);
+        return pieces * (length + occurrences * (chunk - length + 1)) + candidates * (chunk * m + PLAN_HASH_COST);
+    }
+
+    /**
+     * @brief Plans a query.
+     *
+     * @param m the length of the query.
+     * @param k the error.
+     * @return query_plan the cheapest strategy, and the cost of every strategy that was considered.
+     */
+    query_plan plan(size_t m, int k) const {
+        query_plan ret;
+        if(k == 0 && !prefixes) ret.costs.push_back({search_strategy::exact, this->exact_cost(m)});
+        bool bytes = !code_points || k == 0;
+        if(k > 0 && !prefixes && bytes){
+            ret.costs.push_back({search_strategy::neighbourhood, this->neighbourhood_cost(m, k)});
+        }
+        if(k > 0 && (uint32_t) k <= index_error && !prefixes && bytes){
+            ret.costs.push_back({search_strategy::deletion_index, this->deletion_index_cost(m, k)});
+        }
+        if(chunk && k >= 0 && m >= (size_t) k + 1 && bytes){
+            ret.costs.push_back({search_strategy::partition, this->partition_cost(m, k)});
+        }
+        ret.costs.push_back({search_strategy::automaton, this->automaton_cost(m, k)});
+        ret.strategy = ret.costs[0].first;
+        ret.cost = ret.costs[0].second;
+        for(const std::pair<search_strategy, double>& c : ret.costs){
+            if(c.second < ret.cost){
+                ret.strategy = c.first;
+                ret.cost = c.second;
+            }
+        }
+        return ret;
+    }
+};
+
+/**
+ * @brief Counts the strategies that were chosen (from any thread), for the statistics of a batch.
+ */
+class plan_tally {
+private:
+    std::atomic<size_t> counts[STRATEGIES];
+public:
+    plan_tally(){
+        for(std::atomic<size_t>& c : counts) c = 0;
+    }
+
+    void add(search_strategy s){
+        ++counts[(int) s];
+    }
+
+    size_t count(search_strategy s) const {
+        return counts[(int) s];
+    }
+
+    // eg. "12 exact, 80 neighbourhood, 108 automaton" (the strategies that were never chosen are left out)
+    std::string summary() const {
+        std::string ret;
+        for(int i = 0; i < STRATEGIES; ++i){
+            if(counts[i] == 0) continue;
+            if(ret.size()) ret += ", ";
+            ret += std::to_string(counts[i]) + " " + strategy_name((search_strategy) i);
+        }
+        return ret.size() ? ret : "none";
+    }
+};
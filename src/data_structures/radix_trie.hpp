@@ -0,0 +1,301 @@
+#pragma once
+
+#include "FA/DFA.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+
+#define RADIX_TRIE_MAGIC        0x31584452u    // "RDX1"
+#define RADIX_MAX_NODES         0xffffffffu    // the node ids must fit in the low 32 bits of a state
+
+/**
+ * @brief A read-only, path-compressed (radix) trie. Every chain of states with a single child and no accept state
+ * is folded into one edge whose label is a string, so the trie has a node per branch (or word end) rather than
+ * per character. The labels are kept in a single byte pool (equal labels are stored once), and the edges of a
+ * node are contiguous and ordered by their first byte, so walking an edge is a scan of the pool.
+ *
+ * The trie also has the traversal interface of a DFA (`get_start`, `is_accept`, `for_each_transition`, ...) with
+ * `ll` states: a node is its id, and a position inside the label of edge e after d characters is
+ * ((e + 1) << 32) | d. The per-character interface is for the searches that need it (eg. typeahead); `search`
+ * consumes a whole label per step.
+ */
+class radix_trie {
+private:
+    typedef struct _radix_edge_t_ {
+        uint32_t label;     // the offset of the label in the pool
+        uint32_t length;    // the length of the label
+        uint32_t child;
+    } edge_t;
+
+    std::vector<uint32_t> first_edge;   // the edges of node v are [first_edge[v], first_edge[v + 1])
+    std::vector<edge_t> edges;
+    std::vector<char> accept;
+    std::string pool;
+    std::vector<ll> origins;            // the state of the dictionary of every node (of a trie that was not loaded)
+
+    static bool is_node(ll s){
+        return (s >> 32) == 0;
+    }
+
+    // The state after the first d characters of the label of edge e.
+    ll step(uint32_t e, uint32_t d) const {
+        return d == edges[e].length ? (ll) edges[e].child : ((ll) (e + 1) << 32) | d;
+    }
+
+    // The state after c (-1 if there is none).
+    ll child(ll s, char c) const {
+        if(!is_node(s)){
+            uint32_t e = (s >> 32) - 1, d = s & 0xffffffff;
+            return pool[edges[e].label + d] == c ? this->step(e, d + 1) : -1;
+        }
+        auto begin = edges.begin() + first_edge[s], end = edges.begin() + first_edge[s + 1];
+        auto it = std::lower_bound(begin, end, c, [this](const edge_t& a, char b){
+            return (unsigned char) pool[a.label] < (unsigned char) b;
+        });
+        return it != end && pool[it->label] == c ? this->step(it - edges.begin(), 1) : -1;
+    }
+public:
+    radix_trie() : first_edge{0, 0}, accept{0} {} // just the root
+
+    /**
+     * @brief Builds the radix trie of the words of the dictionary (the dictionary may share states, eg. a DAWG,
+     * which the trie unfolds).
+     *
+     * @param dict the dictionary.
+     */
+    radix_trie(DFA<ll, char>& dict) : origins{dict.get_start()} {
+        std::unordered_map<std::string, uint32_t> pooled; // the offset of every label in the pool
+        std::deque<ll> q{dict.get_start()};
+        size_t nodes = 1;
+        while(q.size()){
+            ll state = q.front(); q.pop_front();
+            first_edge.push_back(edges.size());
+            accept.push_back(dict.is_accept(state));
+            dict.for_each_transition(state, [&](char c, ll next){ // in (unsigned) label order
+                std::string label(1, c);
+                while(!dict.is_accept(next)){ // fold the chain while it has a single child
+                    size_t out = 0; char only = 0; ll after = next;
+                    dict.for_each_transition(next, [&](char c2, ll n2){ ++out; only = c2; after = n2; });
+                    if(out != 1) break;
+                    label.push_back(only);
+                    next = after;
+                }
+                auto it = pooled.find(label);
+                if(it == pooled.end()){
+                    if(pool.size() + label.size() > RADIX_MAX_NODES) throw std::runtime_error("The trie is too large!");
+                    it = pooled.insert({label, (uint32_t) pool.size()}).first;
+                    pool += label;
+                }
+                if(nodes >= RADIX_MAX_NODES) throw std::runtime_error("The trie is too large!");
+                edges.push_back({it->second, (uint32_t) label.size(), (uint32_t) nodes++});
+                origins.push_back(next);
+                q.push_back(next);
+            });
+        }
+        first_edge.push_back(edges.size());
+        pool.shrink_to_fit();
+    }
+
+    ll get_start() const {
+        return 0;
+    }
+
+    bool is_accept(ll s) const {
+        return is_node(s) && accept[s];
+    }
+
+    /**
+     * @brief Calls f(label, next) for every character that leaves the state, in (unsigned) label order.
+     */
+    template <class F>
+    void for_each_transition(ll s, F f) const {
+        if(!is_node(s)){
+            uint32_t e = (s >> 32) - 1, d = s & 0xffffffff;
+            f(pool[edges[e].label + d], this->step(e, d + 1));
+            return;
+        }
+        for(uint32_t e = first_edge[s]; e < first_edge[s + 1]; ++e) f(pool[edges[e].label], this->step(e, 1));
+    }
+
+    bool has_transition(ll s, char c) const {
+        return this->child(s, c) >= 0;
+    }
+
+    ll next_state(ll s, char c) const {
+        ll next = this->child(s, c);
+        if(next < 0) throw std::runtime_error("The edge does not exist!");
+        return next;
+    }
+
+    /**
+     * @brief The state of the dictionary the trie was built from that a node stands for (a trie read by `load` does
+     * not keep them).
+     *
+     * @param v the node.
+     * @return ll the state of the dictionary.
+     */
+    ll origin(uint32_t v) const {
+        if(v >= origins.size()) throw std::runtime_error("The trie does not keep the states of its dictionary!");
+        return origins[v];
+    }
+
+    bool contains(const std::string& s) const {
+        ll v = 0;
+        for(char c : s){
+            if((v = this->child(v, c)) < 0) return false;
+        }
+        return this->is_accept(v);
+    }
+
+    /**
+     * @brief Calls emit(word, node) for the words of the trie that the automaton accepts (eg. a Levenshtein
+     * automaton), in (unsigned) byte order, by following the trie and the automaton together. The automaton runs
+     * over the whole label of an edge at once, and the edge is dropped as soon as it has no transition. The search
+     * stops after `limit` words if it is not 0.
+     *
+     * @tparam F void(const std::string&, uint32_t), where the node is where the word ends.
+     * @param automaton the automaton.
+     * @param emit the callback.
+     * @param limit the largest number of words (0 for all of them).
+     * @param followed if not NULL, set to the number of edges that were followed to the end.
+     */
+    template <class F>
+    void for_each_match(DFA<ll, char>& automaton, F emit, size_t limit = 0, size_t* followed = NULL) const {
+        std::string prefix;
+        struct frame_t {
+            uint32_t node, next;    // the node, and its next edge
+            ll state;               // the state of the automaton at the node
+            size_t depth;           // the length of the path to the node
+        };
+        std::vector<frame_t> path;
+        size_t count = 0, found = 0;
+        auto enter = [&](uint32_t v, ll q){
+            if(accept[v] && automaton.is_accept(q)){
+                emit(prefix, v);
+                ++found;
+            }
+            path.push_back({v, first_edge[v], q, prefix.size()});
+        };
+        enter(0, automaton.get_start());
+        while(path.size() && (!limit || found < limit)){
+            frame_t& f = path.back();
+            if(f.next == first_edge[f.node + 1]){
+                path.pop_back();
+                continue;
+            }
+            const edge_t& e = edges[f.next++];
+            ll q = f.state;
+            size_t depth = f.depth;
+            const char* label = pool.data() + e.label;
+            uint32_t d = 0;
+            for(; d < e.length && automaton.has_transition(q, label[d]); ++d) q = automaton.next_state(q, label[d]);
+            if(d < e.length) continue;
+            ++count;
+            prefix.resize(depth);
+            prefix.append(label, e.length);
+            enter(e.child, q);
+        }
+        if(followed) *followed = count;
+    }
+
+    /**
+     * @brief Returns the words of the trie that the automaton accepts (see `for_each_match`).
+     *
+     * @param automaton the automaton.
+     * @param followed if not NULL, set to the number of edges that were followed to the end.
+     * @param limit the largest number of words (0 for all of them).
+     * @return std::vector<std::string> the words, in (unsigned) byte order.
+     */
+    std::vector<std::string> search(DFA<ll, char>& automaton, size_t* followed = NULL, size_t limit = 0) const {
+        std::vector<std::string> ret;
+        this->for_each_match(automaton, [&ret](const std::string& w, uint32_t){ ret.push_back(w); }, limit, followed);
+        return ret;
+    }
+
+    /**
+     * @brief Calls f(word) for every word of the trie, in (unsigned) byte order.
+     */
+    template <class F>
+    void for_each_word(F f) const {
+        std::string prefix;
+        std::function<void(uint32_t)> walk = [&](uint32_t v){
+            if(accept[v]) f(prefix);
+            for(uint32_t e = first_edge[v]; e < first_edge[v + 1]; ++e){
+                size_t depth = prefix.size();
+                prefix.append(pool, edges[e].label, edges[e].length);
+                walk(edges[e].child);
+                prefix.resize(depth);
+            }
+        };
+        walk(0);
+    }
+
+    /**
+     * @brief The number of nodes.
+     */
+    size_t size() const {
+        return this->accept.size();
+    }
+
+    /**
+     * @brief The number of bytes in the label pool.
+     */
+    size_t pool_size() const {
+        return this->pool.size();
+    }
+
+    /**
+     * @brief The bytes used by the trie.
+     *
+     * @return size_t the bytes.
+     */
+    size_t memory() const {
+        return first_edge.capacity() * sizeof(uint32_t) + edges.capacity() * sizeof(edge_t) + accept.capacity()
+            + pool.capacity() + origins.capacity() * sizeof(ll);
+    }
+
+    /**
+     * @brief Writes the trie to the stream.
+     *
+     * @param os the stream.
+     */
+    void save(std::ostream& os) const {
+        uint32_t magic = RADIX_TRIE_MAGIC;
+        uint64_t header[3] = {accept.size(), edges.size(), pool.size()};
+        os.write((char*) &magic, sizeof(magic));
+        os.write((char*) header, sizeof(header));
+        os.write((char*) first_edge.data(), first_edge.size() * sizeof(uint32_t));
+        os.write((char*) edges.data(), edges.size() * sizeof(edge_t));
+        os.write(accept.data(), accept.size());
+        os.write(pool.data(), pool.size());
+    }
+
+    /**
+     * @brief Reads a trie written by `save`.
+     *
+     * @param is the stream.
+     * @return true if the trie was read.
+     * @return false if the stream does not hold a trie.
+     */
+    bool load(std::istream& is){
+        uint32_t magic;
+        uint64_t header[3];
+        if(!is.read((char*) &magic, sizeof(magic)) || magic != RADIX_TRIE_MAGIC) return false;
+        if(!is.read((char*) header, sizeof(header))) return false;
+        first_edge.resize(header[0] + 1);
+        edges.resize(header[1]);
+        accept.resize(header[0]);
+        pool.resize(header[2]);
+        origins.clear();
+        return is.read((char*) first_edge.data(), first_edge.size() * sizeof(uint32_t))
+            && is.read((char*) edges.data(), edges.size() * sizeof(edge_t))
+            && is.read(accept.data(), accept.size())
+            && is.read(&pool[0], pool.size());
+    }
+};
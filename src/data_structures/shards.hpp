@@ -0,0 +1,124 @@
+#pragma once
+
+/**
+ * @file shards.hpp
+ * @brief A dictionary can be split into shards by the hash of its words. A query is answered by every shard, and the
+ * answers are merged so that they are the same as the answer of the whole dictionary: every shard answers in the
+ * same order as the whole dictionary (see `first_words`) and returns its first `limit` words, so the first `limit`
+ * words of the merge are the first `limit` words of the dictionary.
+ */
+
+#include "FA/DFA.hpp"
+#include "FA/alphabet_map.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+// The shard of a word (FNV-1a of the word).
+inline size_t shard_of(const std::string& word, size_t shards){
+    uint64_t h = 1469598103934665603ull;
+    for(char c : word) h = (h ^ (unsigned char) c) * 1099511628211ull;
+    return h % shards;
+}
+
+// Shorter words first, then in (unsigned) byte order.
+inline bool shorter_word(const std::string& a, const std::string& b){
+    return a.size() != b.size() ? a.size() < b.size() : a < b;
+}
+
+/**
+ * @brief The first `limit` (decoded) words of a shard in byte order. A shard finds its words in the order of its
+ * symbols, which is byte order until a byte is added to its alphabet (see `alphabet_map::byte_ordered`); from then on
+ * all of its words are found, decoded and sorted before the first `limit` are kept.
+ *
+ * @tparam F std::vector<std::string>(size_t n): the first n (decoded) words in the order of the symbols (0: all).
+ * @param amap the alphabet map of the shard.
+ * @param limit the number of words to keep (0: every word).
+ * @param search the search of the shard.
+ * @return std::vector<std::string> the words.
+ */
+template <class F>
+std::vector<std::string> first_words(const alphabet_map& amap, size_t limit, F search){
+    if(amap.byte_ordered()) return search(limit);
+    std::vector<std::string> ret = search(0);
+    std::sort(ret.begin(), ret.end());
+    if(limit && ret.size() > limit) ret.resize(limit);
+    return ret;
+}
+
+/**
+ * @brief The first k answers of a shard (decoded), for `merge_ranked` and `merge_closest`. The answers are ordered by
+ * their score, then shorter words first, then in the order of the symbols; when the symbols are not in byte order,
+ * more answers are asked for until every answer that ties with the k-th on its score and length is among them (any
+ * of those may come first in byte order).
+ *
+ * @tparam F std::vector<std::pair<std::string, T> >(size_t n): the first n (encoded) answers and their scores.
+ * @param amap the alphabet map of the shard.
+ * @param k the number of answers needed.
+ * @param query the query of the shard.
+ * @return the answers (at least the first k of them).
+ */
+template <class F>
+auto first_answers(const alphabet_map& amap, size_t k, F query) -> decltype(query(k)){
+    decltype(query(k)) ret = query(k);
+    for(size_t n = k; k && ret.size() == n && !amap.byte_ordered(); ret = query(n *= 2)){
+        if(ret.back().second != ret[k - 1].second || ret.back().first.size() != ret[k - 1].first.size()) break;
+    }
+    for(auto& a : ret) a.first = amap.decode(a.first);
+    return ret;
+}
+
+/**
+ * @brief Merges the words of the shards (see `first_words`) into byte order.
+ *
+ * @param found the words of every shard.
+ * @param limit the number of words to keep (0: every word).
+ * @return std::vector<std::string> the words.
+ */
+inline std::vector<std::string> merge_words(const std::vector<std::vector<std::string> >& found, size_t limit = 0){
+    std::vector<std::string> ret;
+    for(auto& f : found) ret.insert(ret.end(), f.begin(), f.end());
+    std::sort(ret.begin(), ret.end());
+    if(limit && ret.size() > limit) ret.resize(limit);
+    return ret;
+}
+
+/**
+ * @brief Merges the heaviest words of the shards (see `dawg::top_k`): heaviest first, then shorter words first,
+ * then in byte order.
+ *
+ * @param found the words and the weights of every shard.
+ * @param k the number of words to keep.
+ * @return std::vector<std::pair<std::string, ll> > the words and their weights.
+ */
+inline std::vector<std::pair<std::string, ll> > merge_ranked(
+    const std::vector<std::vector<std::pair<std::string, ll> > >& found, size_t k){
+    std::vector<std::pair<std::string, ll> > ret;
+    for(auto& f : found) ret.insert(ret.end(), f.begin(), f.end());
+    std::sort(ret.begin(), ret.end(), [](const std::pair<std::string, ll>& a, const std::pair<std::string, ll>& b){
+        return a.second != b.second ? a.second > b.second : shorter_word(a.first, b.first);
+    });
+    if(ret.size() > k) ret.resize(k);
+    return ret;
+}
+
+/**
+ * @brief Merges the closest words of the shards (see `typeahead_session::matches`): by distance, then shorter words
+ * first, then in byte order.
+ *
+ * @param found the words and the distances of every shard.
+ * @param k the number of words to keep.
+ * @return std::vector<std::pair<std::string, int> > the words and their distances.
+ */
+inline std::vector<std::pair<std::string, int> > merge_closest(
+    const std::vector<std::vector<std::pair<std::string, int> > >& found, size_t k){
+    std::vector<std::pair<std::string, int> > ret;
+    for(auto& f : found) ret.insert(ret.end(), f.begin(), f.end());
+    std::sort(ret.begin(), ret.end(), [](const std::pair<std::string, int>& a, const std::pair<std::string, int>& b){
+        return a.second != b.second ? a.second < b.second : shorter_word(a.first, b.first);
+    });
+    if(ret.size() > k) ret.resize(k);
+    return ret;
+}
@@ -20,6 +20,13 @@ std::ostream& serialize_doc_position(std::ostream& os, doc_position_t& pos) {
   return os;
 }
 
+// The same, into an encode_buffer (see `serialize_suffix_tree`).
+void serialize_doc_position(encode_buffer& out, doc_position_t& pos) {
+  out.put(pos.index);
+  // out.put(pos.line);
+  // out.put(pos.column);
+}
+
 std::istream& deserialize_doc_position(std::istream& is, doc_position_t& pos) {
   is.read((char*) &pos.index, sizeof(ll));
   // is.read((char*) &pos.line, sizeof(ll));
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include "suffix_tree.hpp"
+#include "../FA/encoding_util.hpp"
+#include "../FA/alphabet_map.hpp"
+
+/**
+ * @brief Builds the serialized compressed suffix tree of a document (in the format of `serialize_suffix_tree`,
+ * with a dense alphabet) without holding the tree in memory, for documents that do not fit in it.
+ *
+ * The document is read in runs of at most `memory_budget / 5` chunks (a run keeps its text and a 4 byte offset
+ * per chunk). The chunks of a run are sorted and spilled to a file `tmp_prefix + ".runN"`, and the runs are then
+ * k-way merged. The merged chunks come out in order, so the tree is written depth first: a state is written as
+ * soon as the merge leaves its subtree, which only keeps the states on the path of the current chunk. The
+ * positions are spilled to `tmp_prefix + ".pos"` during the merge and appended after the states. Every
+ * temporary file is removed once the index is written, or once the build fails: a temporary file that cannot be
+ * written or read back (eg. on a full disk), or a stream `os` that fails, throws a `std::runtime_error` instead of
+ * leaving a truncated index.
+ *
+ * @param os the stream the index is written to.
+ * @param path the document.
+ * @param chunk_size the length of the chunks (see `suffix_tree::load_file`).
+ * @param memory_budget the bytes a run may use.
+ * @param tmp_prefix the prefix of the temporary files.
+ * @param runs if not NULL, set to the number of runs that were spilled.
+ * @return std::ostream& the stream.
+ */
+std::ostream& build_suffix_tree_external(std::ostream& os, const std::string& path, ll chunk_size,
+    size_t memory_budget, const std::string& tmp_prefix, size_t* runs = NULL){
+    if(chunk_size < 1) throw std::runtime_error("The chunk size must be positive!");
+    // The document and the temporary files, which are closed and removed however the build ends.
+    struct files_t {
+        FILE* document{NULL};
+        std::vector<std::string> paths;
+        std::vector<std::ifstream*> inputs;
+
+        ~files_t(){
+            if(document) fclose(document);
+            for(std::ifstream* in : inputs) delete in;
+            for(const std::string& p : paths) remove(p.c_str());
+        }
+    } files;
+    FILE* f = files.document = fopen(path.c_str(), "r");
+    if(f == NULL) throw std::runtime_error("Cannot open file!");
+    typedef std::pair<std::string, ll> record_t; // (chunk, index of the last character of the chunk)
+    const size_t chunk = chunk_size, record_size = chunk + sizeof(ll);
+    const size_t per_run = std::min((size_t) 1 << 31, std::max((size_t) 1, memory_budget / (1 + sizeof(uint32_t))));
+
+    // Spill the sorted runs. Like `load_file`, the document is followed by the EOF byte.
+    bool seen[256] = {false};
+    std::vector<std::string> run_paths;
+    std::string window;         // the document from the first chunk of the run on
+    ll base = 0;                // the offset of the window
+    bool at_end = false;
+    char block[1 << 16];
+    while(true){
+        while(!at_end && window.size() < per_run + chunk - 1){
+            size_t want = std::min(sizeof(block), per_run + chunk - 1 - window.size());
+            size_t got = fread(block, 1, want, f);
+            if(got < want && ferror(f)) throw std::runtime_error("Cannot read file!");
+            window.append(block, got);
+            if(got < want){ window += (char) EOF; at_end = true; }
+        }
+        if(window.size() < chunk) break;
+        size_t count = std::min(per_run, window.size() - chunk + 1);
+        std::vector<uint32_t> offsets(count);
+        for(size_t i = 0; i < count; ++i) offsets[i] = i;
+        const char* text = window.data();
+        std::sort(offsets.begin(), offsets.end(), [text, chunk](uint32_t a, uint32_t b){
+            int c = memcmp(text + a, text + b, chunk);
+            return c < 0 || (c == 0 && a < b);
+        });
+        run_paths.push_back(tmp_prefix + ".run" + std::to_string(run_paths.size()));
+        files.paths.push_back(run_paths.back());
+        std::ofstream run(run_paths.back().c_str(), std::ofstream::binary);
+        for(uint32_t o : offsets){
+            ll index = base + o + chunk_size - 1;
+            run.write(text + o, chunk);
+            run.write((char*) &index, sizeof(ll));
+        }
+        run.close();
+        if(!run) throw std::runtime_error("Cannot write the run " + run_paths.back() + "!");
+        for(size_t i = 0; i < count + chunk - 1; ++i) seen[(unsigned char) window[i]] = true;
+        window.erase(0, count);
+        base += count;
+    }
+    fclose(f);
+    files.document = NULL;
+    if(runs) *runs = run_paths.size();
+
+    std::vector<char> bytes;
+    for(int c = 0; c < 256; ++c){
+        if(seen[c]) bytes.push_back((char) c);
+    }
+    alphabet_map am(bytes);
+    os.put(ENCODING_VERSION::V1_1 | ENCODING_VERSION::REMAPPED);
+    serialize_alphabet(os, am);
+
+    // Merge the runs.
+    std::vector<std::ifstream*>& inputs = files.inputs;
+    for(const std::string& p : run_paths){
+        inputs.push_back(new std::ifstream(p.c_str(), std::ifstream::binary));
+        if(!*inputs.back()) throw std::runtime_error("Cannot open the run " + p + "!");
+    }
+    std::vector<char> buf(record_size);
+    auto next_record = [&](size_t i, record_t& r){
+        if(!inputs[i]->read(buf.data(), record_size)){ // (the end of the run, unless a record was cut short)
+            if(!inputs[i]->eof() || inputs[i]->gcount()) throw std::runtime_error("Cannot read the run " +
+                run_paths[i] + "!");
+            return false;
+        }
+        r.first.assign(buf.data(), chunk);
+        memcpy(&r.second, buf.data() + chunk, sizeof(ll));
+        return true;
+    };
+    typedef std::pair<record_t, size_t> head_t; // the next record of a run
+    auto later = [](const head_t& a, const head_t& b){
+        int c = memcmp(a.first.first.data(), b.first.first.data(), a.first.first.size());
+        return c > 0 || (c == 0 && a.first.second > b.first.second);
+    };
+    std::priority_queue<head_t, std::vector<head_t>, decltype(later)> heads(later);
+    for(size_t i = 0; i < inputs.size(); ++i){
+        record_t r;
+        if(next_record(i, r)) heads.push({r, i});
+    }
+
+    std::string pos_path = tmp_prefix + ".pos";
+    files.paths.push_back(pos_path);
+    std::ofstream positions(pos_path.c_str(), std::ofstream::binary);
+    if(!positions) throw std::runtime_error("Cannot write the positions " + pos_path + "!");
+    struct open_state_t {
+        ll id;
+        std::vector<std::pair<char, ll> > edges;
+    };
+    std::vector<open_state_t> open{{0, {}}};   // the states on the path of the last chunk (the root is 0)
+    ll states = 1, spilled_positions = 0;
+    auto write_state = [&](const open_state_t& s, size_t depth){
+        os.put((depth == 0 ? STATE_TYPE::start : 0)
+            + (depth == chunk ? STATE_TYPE::accept : STATE_TYPE::reject));
+        os.write((char*) &s.id, sizeof(ll));
+        for(auto& edge : s.edges){
+            os.write((char*) &edge.second, sizeof(ll));
+            os.write((char*) &edge.first, sizeof(char));
+        }
+        os.write((char*) &eos, sizeof(ll));
+    };
+    std::string last;
+    while(heads.size()){
+        head_t h = heads.top(); heads.pop();
+        size_t common = 0;
+        while(common < last.size() && h.first.first[common] == last[common]) ++common;
+        while(open.size() > common + 1){ // leave the subtrees the chunk is not in
+            write_state(open.back(), open.size() - 1);
+            open.pop_back();
+        }
+        for(size_t d = common; d < chunk; ++d){
+            open.back().edges.push_back({am.encode(h.first.first[d]), states});
+            open.push_back({states++, {}});
+        }
+        positions.write((char*) &open.back().id, sizeof(ll));
+        positions.write((char*) &h.first.second, sizeof(ll));
+        ++spilled_positions;
+        last = h.first.first;
+        record_t r;
+        if(next_record(h.second, r)) heads.push({r, h.second});
+    }
+    while(open.size()){
+        write_state(open.back(), open.size() - 1);
+        open.pop_back();
+    }
+    os.put(STATE_TYPE::end_read);
+    positions.close();
+    if(!positions) throw std::runtime_error("Cannot write the positions " + pos_path + "!");
+    for(size_t i = 0; i < inputs.size(); ++i){
+        delete inputs[i];
+        inputs[i] = NULL;
+        remove(run_paths[i].c_str());
+    }
+
+    std::ifstream spilled(pos_path.c_str(), std::ifstream::binary);
+    if(!spilled) throw std::runtime_error("Cannot open the positions " + pos_path + "!");
+    if(spilled_positions) os << spilled.rdbuf();
+    os.write((char*) &eos, sizeof(ll));
+    if(!os) throw std::runtime_error("Cannot write the index!");
+    if(spilled.peek() != EOF) throw std::runtime_error("Cannot read the positions " + pos_path + "!");
+    spilled.close();
+    return os;
+}
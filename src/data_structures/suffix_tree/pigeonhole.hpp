@@ -0,0 +1,90 @@
+#pragma once
+
+/**
+ * @file pigeonhole.hpp
+ * @brief Finds the chunks of a document (in its suffix tree) that start with something within the error of a word,
+ * without intersecting the tree with a Levenshtein automaton: if the word is split into error + 1 pieces, one of them
+ * must appear exactly, so the exact occurrences of the pieces give the candidates, which are verified against the
+ * document.
+ */
+
+#include "suffix_tree.hpp"
+#include "../FA/alphabet_map.hpp"
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+
+// A chunk that matched a query: the (encoded) chunk and the state of the suffix tree at its end.
+typedef std::pair<std::string, ll> needle_t;
+
+// The text of the document at the given offset (the suffix tree reads the EOF marker into the last chunk as well).
+inline std::string document_at(const std::string& text, ll start, ll length){
+    std::string ret = text.substr(std::min(start, (ll) text.size()), length);
+    if((ll) ret.size() < length && start + length > (ll) text.size()) ret += (char) EOF;
+    return ret;
+}
+
+// Does a prefix of the chunk lie within the error of the word?
+inline bool prefix_within(const std::string& word, const std::string& chunk, int error){
+    std::vector<int> col(word.size() + 1);
+    for(size_t i = 0; i <= word.size(); ++i) col[i] = i;
+    int best = col.back();
+    for(char c : chunk){
+        int diag = col[0]++;
+        for(size_t i = 1; i <= word.size(); ++i){
+            int up = col[i];
+            col[i] = std::min(std::min(col[i] + 1, col[i - 1] + 1), diag + (word[i - 1] != c));
+            diag = up;
+        }
+        best = std::min(best, col.back());
+    }
+    return best <= error;
+}
+
+/**
+ * @brief Finds the (encoded) chunks that start with something within the error of the word, by the pigeonhole
+ * principle (see above).
+ *
+ * @param tree the suffix tree of the chunks of the document.
+ * @param amap the alphabet map of the tree.
+ * @param text the document (without the EOF marker).
+ * @param chunk_size the size of the chunks of the tree.
+ * @param word the (decoded) word.
+ * @param error the error.
+ * @param needles set to the matching chunks (sorted) and the states of the tree at their ends.
+ * @param checked if not NULL, set to the number of candidates that were verified.
+ * @return true if the chunks were found.
+ * @return false if the word is too short to be split into error + 1 pieces.
+ */
+inline bool pigeonhole_matches(compressed_suffix_tree& tree, const alphabet_map& amap, const std::string& text,
+    ll chunk_size, const std::string& word, int error, std::vector<needle_t>& needles, size_t* checked = NULL){
+    ll m = word.size(), pieces = error + 1;
+    if(error < 0 || m < pieces) return false;
+    ll length = text.size() + 1;            // including the EOF marker
+    ll last_start = length - chunk_size;    // the start of the last chunk
+    std::set<ll> candidates;
+    auto add = [&](ll start){ // where the word would start if nothing before the piece moved
+        for(ll p = std::max((ll) 0, start - error); p <= std::min(last_start, start + error); ++p) candidates.insert(p);
+    };
+    for(ll i = 0; i < pieces; ++i){
+        ll from = m * i / pieces, to = m * (i + 1) / pieces;
+        std::string piece = word.substr(from, to - from);
+        for(const doc_position_t& pos : tree.get_prefix_positions(amap.encode(piece))){
+            add(pos.index - chunk_size + 1 - from);
+        }
+        // The occurrences after the start of the last chunk are not the prefix of any chunk.
+        for(ll q = std::max((ll) 0, last_start + 1); q + (ll) piece.size() <= length; ++q){
+            if(document_at(text, q, piece.size()) == piece) add(q - from);
+        }
+    }
+    std::set<std::string> found;
+    for(ll p : candidates){
+        std::string chunk = document_at(text, p, chunk_size);
+        if(prefix_within(word, chunk, error)) found.insert(amap.encode(chunk));
+    }
+    if(checked) *checked = candidates.size();
+    needles.resize(0);
+    for(const std::string& chunk : found) needles.push_back({chunk, tree.follow(chunk)});
+    return true;
+}
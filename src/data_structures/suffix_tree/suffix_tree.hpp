@@ -1,13 +1,13 @@
 #pragma once
 
 #include "../trie.hpp"
+#include "../FA/alphabet_map.hpp"
 #include <string>
 #include <list>
+#include <vector>
 #include <unordered_map>
 #include <stdio.h>
 
-#define min(x, y)       x < y ? x : y
-
 typedef struct _position_t_ {
     ll index;
     ll line;
@@ -42,8 +42,18 @@ public:
     }
 
     std::unordered_set<ll> get_indices(std::string s){
-        ll ind = this->follow(s);
-        auto range = this->position_map.equal_range(ind);
+        return this->get_indices_at(this->follow(s));
+    }
+
+    /**
+     * @brief Returns the indices of the chunk that ends at the given state (eg. a state found by a match_iterator,
+     * which saves following the chunk from the root).
+     *
+     * @param state the state.
+     * @return std::unordered_set<ll> the indices.
+     */
+    std::unordered_set<ll> get_indices_at(ll state){
+        auto range = this->position_map.equal_range(state);
         std::unordered_set<ll> ret;
         for(auto it = range.first; it != range.second; ++it){
             ret.insert(it->second.index);
@@ -51,9 +61,42 @@ public:
         return ret;
     }
 
+    /**
+     * @brief Returns the positions of every chunk that starts with the given string (ie. of the chunks in the
+     * subtree of the string). Note that the index of a position is the index of the last character of its chunk.
+     *
+     * @param s the (encoded) prefix.
+     * @return std::vector<doc_position_t> the positions (empty if no chunk starts with the string).
+     */
+    std::vector<doc_position_t> get_prefix_positions(const std::string& s){
+        std::vector<doc_position_t> ret;
+        ll node = this->get_start();
+        for(char c : s){
+            if(!this->has_transition(node, c)) return ret;
+            node = this->next_state(node, c);
+        }
+        std::vector<ll> stk{node};
+        while(stk.size()){
+            ll cur = stk.back(); stk.pop_back();
+            auto range = this->position_map.equal_range(cur);
+            for(auto it = range.first; it != range.second; ++it) ret.push_back(it->second);
+            this->for_each_transition(cur, [&stk](char c, ll next){ stk.push_back(next); });
+        }
+        return ret;
+    }
+
     std::unordered_set<std::pair<ll,ll> > get_lc(std::string s){
-        ll ind = this->follow(s);
-        auto range = this->position_map.equal_range(ind);
+        return this->get_lc_at(this->follow(s));
+    }
+
+    /**
+     * @brief Returns the lines and the columns of the chunk that ends at the given state (see `get_indices_at`).
+     *
+     * @param state the state.
+     * @return std::unordered_set<std::pair<ll,ll> > the (line, column) pairs.
+     */
+    std::unordered_set<std::pair<ll,ll> > get_lc_at(ll state){
+        auto range = this->position_map.equal_range(state);
         std::unordered_set<std::pair<ll,ll> > ret;
         for(auto it = range.first; it != range.second; ++it){
             ret.insert({it->second.line, it->second.column});
@@ -61,8 +104,41 @@ public:
         return ret;
     }
 
-    friend std::ostream& serialize_suffix_tree(std::ostream& os, compressed_suffix_tree& dt);
-    friend std::istream& deserialize_suffix_tree(std::istream& is, compressed_suffix_tree& dt);
+    /**
+     * @brief Sets the line and the column of every position (they are not serialized) from the start of its chunk.
+     *
+     * @param chunk_size the length of the chunks.
+     * @param line_col maps an offset of the document to its line and column.
+     */
+    template <class F>
+    void set_line_columns(ll chunk_size, F line_col){
+        for(auto& p : this->position_map){
+            std::pair<ll, ll> lc = line_col(p.second.index - chunk_size + 1);
+            p.second.line = lc.first;
+            p.second.column = lc.second;
+        }
+    }
+
+    /**
+     * @brief The number of positions (chunks of the document) kept by the suffix tree.
+     */
+    size_t positions() const {
+        return this->position_map.size();
+    }
+
+    /**
+     * @brief The estimated heap used by the suffix tree (see `DFA::memory_usage`), with the positions of the chunks.
+     *
+     * @return memory_usage_t the bytes.
+     */
+    memory_usage_t memory_usage() const {
+        memory_usage_t ret = DFA<ll, char>::memory_usage();
+        ret.positions = hash_table_bytes(this->position_map);
+        return ret;
+    }
+
+    friend std::ostream& serialize_suffix_tree(std::ostream& os, compressed_suffix_tree& dt, const alphabet_map* am);
+    friend std::istream& deserialize_suffix_tree(std::istream& is, compressed_suffix_tree& dt, alphabet_map* am);
 };
 
 
@@ -126,6 +202,18 @@ public:
         return ret;
     }
 
+    /**
+     * @brief The estimated heap used by the (uncompressed) suffix tree, with the positions of the chunks.
+     *
+     * @return memory_usage_t the bytes.
+     */
+    memory_usage_t memory_usage() const {
+        memory_usage_t ret = trie::memory_usage();
+        ret.positions = hash_table_bytes(this->position_map);
+        for(auto& p : this->position_map) ret.positions += heap_bytes(p.first);
+        return ret;
+    }
+
     compressed_suffix_tree compress_dfa(){
         return this->compress_dfa(*this);
     }
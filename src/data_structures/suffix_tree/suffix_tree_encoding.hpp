@@ -13,23 +13,25 @@
 #include "../FA/encoding_util.hpp"
 
 std::ostream& serialize_doc_position(std::ostream& os, doc_position_t& pos);
+void serialize_doc_position(encode_buffer& out, doc_position_t& pos);
 std::istream& deserialize_doc_position(std::istream& is, doc_position_t& pos);
 
 // Serialize and deserialize for compressed DFAs
-std::ostream& serialize_suffix_tree(std::ostream& os, compressed_suffix_tree& dt){
-  serialize<char>(os, dt);
-  for(auto p : dt.position_map) {
-    os.write((char*) &p.first, sizeof(ll));
-    serialize_doc_position(os, p.second);
+std::ostream& serialize_suffix_tree(std::ostream& os, compressed_suffix_tree& dt, const alphabet_map* am = NULL){
+  serialize<char>(os, dt, am);
+  encode_buffer out(os);
+  for(auto& p : dt.position_map) {
+    out.put(p.first);
+    serialize_doc_position(out, p.second);
   }
-  printf("FINISHED!\n");
-  os.write((char*) &eos, sizeof(ll));
+  out.put(eos);
+  out.flush();
   return os;
 }
 
 // Deserialize using the above convention.
-std::istream& deserialize_suffix_tree(std::istream& is, compressed_suffix_tree& dt){
-  deserialize<char>(is, dt);
+std::istream& deserialize_suffix_tree(std::istream& is, compressed_suffix_tree& dt, alphabet_map* am = NULL){
+  deserialize<char>(is, dt, am);
   ll state_num; doc_position_t pos;
   while(is.good() && is.read((char*) &state_num, sizeof(ll)) && state_num != eos) {
     deserialize_doc_position(is, pos);
@@ -0,0 +1,101 @@
+#pragma once
+
+/**
+ * @file text_normalizer.hpp
+ * @brief Folds a text before it is indexed (and every query the same way), so that differences that should not count
+ * as errors (eg. "Lorem" and "lorem") match exactly. The normalized text is shorter than the text when whitespace is
+ * collapsed or punctuation is stripped, so the offset in the text of every normalized byte is kept, which maps the
+ * positions of the index back to the text.
+ */
+
+#include "FA/DFA.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @brief A pipeline of (byte-wise, ASCII) normalization steps: case folding, whitespace collapsing and punctuation
+ * stripping. The bytes of multi-byte UTF-8 code points are never changed or removed.
+ */
+class text_normalizer {
+private:
+    bool fold_case{false};      // A-Z become a-z
+    bool collapse_space{false}; // every run of whitespace becomes a single space
+    bool strip_punct{false};    // ASCII punctuation is removed
+
+    static bool is_space(char c){
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    static bool is_punct(char c){
+        return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+    }
+public:
+    text_normalizer(){}
+
+    /**
+     * @brief Enables a step of the pipeline by its name: `case`, `space` or `punct`.
+     *
+     * @param step the name of the step.
+     * @return true if the step exists.
+     * @return false otherwise (nothing is enabled).
+     */
+    bool enable(const std::string& step){
+        if(step == "case") this->fold_case = true;
+        else if(step == "space") this->collapse_space = true;
+        else if(step == "punct") this->strip_punct = true;
+        else return false;
+        return true;
+    }
+
+    /**
+     * @brief Does the pipeline leave every text as it is?
+     */
+    bool identity() const {
+        return !this->fold_case && !this->collapse_space && !this->strip_punct;
+    }
+
+    /**
+     * @brief The steps of the pipeline as a file name suffix (eg. ".case-space"), empty if there are none. An index
+     * of a normalized text is only valid for the same steps.
+     */
+    std::string suffix() const {
+        std::string ret;
+        if(this->fold_case) ret += "-case";
+        if(this->collapse_space) ret += "-space";
+        if(this->strip_punct) ret += "-punct";
+        if(ret.size()) ret[0] = '.';
+        return ret;
+    }
+
+    /**
+     * @brief Normalizes the text.
+     *
+     * @param text the text.
+     * @param origins if not NULL, set to the offset in the text of every byte of the normalized text (a collapsed
+     * run of whitespace comes from its first byte), followed by the length of the text (the end maps to the end).
+     * @return std::string the normalized text.
+     */
+    std::string apply(const std::string& text, std::vector<ll>* origins = NULL) const {
+        std::string ret;
+        ret.reserve(text.size());
+        if(origins){
+            origins->resize(0);
+            origins->reserve(text.size() + 1);
+        }
+        bool in_space = false;  // the last byte written is a collapsed run of whitespace
+        for(size_t i = 0; i < text.size(); ++i){
+            char c = text[i];
+            if(this->strip_punct && is_punct(c)) continue;
+            if(this->collapse_space && is_space(c)){
+                if(in_space) continue;
+                c = ' ';
+            }
+            in_space = this->collapse_space && c == ' ';
+            if(this->fold_case && c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+            ret += c;
+            if(origins) origins->push_back(i);
+        }
+        if(origins) origins->push_back(text.size());
+        return ret;
+    }
+};
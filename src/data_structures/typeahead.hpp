@@ -0,0 +1,217 @@
+#pragma once
+
+#include "FA/DFA.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+/**
+ * @brief An incremental fuzzy-prefix search over a dictionary automaton (eg. for typeahead). The session keeps the
+ * frontier of (dictionary state, query state) pairs for the current query: every path of the dictionary that
+ * aligns with the whole query within `max_error` edits, along with the fewest edits it takes (ie. the errors of
+ * the Levenshtein automaton state it is paired with). Typing a character extends the previous frontier by one
+ * query position, so the cost of a keystroke is proportional to the frontier rather than the dictionary.
+ * Frontiers of the earlier prefixes are kept, so a backspace is free.
+ *
+ * @tparam N the type of the dictionary states.
+ * @tparam D the type of the dictionary (a DFA, or anything with the same traversal interface, eg. a louds_trie).
+ */
+template <typename N, class D = DFA<N, char> >
+class typeahead_session {
+public:
+    typedef struct _typeahead_entry_t_ {
+        N state;
+        int errors;
+        std::string prefix;     // the path of the dictionary that leads to the state
+    } entry_t;
+
+private:
+    D* dict;
+    int max_error;
+    std::string query;
+    std::vector<std::vector<entry_t> > frontiers; // frontiers[i] is the frontier of the first i query characters
+
+    // Adds the entry (or lowers the errors of the entry with the same prefix). Returns the index of the entry if
+    // it changed, or -1.
+    static long relax(std::vector<entry_t>& frontier, std::unordered_map<std::string, size_t>& index,
+        const N& state, int errors, const std::string& prefix){
+        auto it = index.find(prefix);
+        if(it == index.end()){
+            index[prefix] = frontier.size();
+            frontier.push_back({state, errors, prefix});
+            return frontier.size() - 1;
+        }
+        if(errors >= frontier[it->second].errors) return -1;
+        frontier[it->second].errors = errors;
+        return it->second;
+    }
+
+    // Inserting dictionary characters: follow every edge out of the entries while the errors allow it (entries
+    // whose errors are lowered are followed again).
+    void close(std::vector<entry_t>& frontier, std::unordered_map<std::string, size_t>& index){
+        std::vector<size_t> work;
+        for(size_t i = frontier.size(); i > 0; --i) work.push_back(i - 1);
+        while(work.size()){
+            entry_t en = frontier[work.back()];
+            work.pop_back();
+            if(en.errors >= max_error) continue;
+            dict->for_each_transition(en.state, [&](char c, const N& next){
+                long changed = relax(frontier, index, next, en.errors + 1, en.prefix + c);
+                if(changed >= 0) work.push_back(changed);
+            });
+        }
+    }
+
+    // Is a proper prefix of the entry in the frontier with at most as many errors (so every word below the
+    // entry has already been matched through that prefix)?
+    bool dominated(const entry_t& en, const std::unordered_map<std::string, int>& errors) const {
+        for(size_t len = 0; len < en.prefix.size(); ++len){
+            auto it = errors.find(en.prefix.substr(0, len));
+            if(it != errors.end() && it->second <= en.errors) return true;
+        }
+        return false;
+    }
+public:
+    /**
+     * @brief Construct a new typeahead session object (with an empty query).
+     *
+     * @param dict the dictionary (it must not change while the session is in use).
+     * @param max_error the allowed deletes/insertions/substitutions.
+     */
+    typeahead_session(D& dict, int max_error) : dict(&dict), max_error(max_error) {
+        this->reset();
+    }
+
+    /**
+     * @brief Clears the query.
+     *
+     */
+    void reset(){
+        std::vector<entry_t> frontier;
+        std::unordered_map<std::string, size_t> index;
+        relax(frontier, index, dict->get_start(), 0, "");
+        close(frontier, index);
+        this->query.clear();
+        this->frontiers.assign(1, frontier);
+    }
+
+    /**
+     * @brief Appends a character to the query.
+     *
+     * @param c the character.
+     */
+    void push(char c){
+        const std::vector<entry_t>& prev = frontiers.back();
+        std::vector<entry_t> frontier;
+        std::unordered_map<std::string, size_t> index;
+        for(const entry_t& en : prev){
+            dict->for_each_transition(en.state, [&](char label, const N& next){
+                int errors = en.errors + (label != c); // match or substitute
+                if(errors <= max_error) relax(frontier, index, next, errors, en.prefix + label);
+            });
+            if(en.errors < max_error) relax(frontier, index, en.state, en.errors + 1, en.prefix); // delete c
+        }
+        close(frontier, index);
+        this->query += c;
+        this->frontiers.push_back(frontier);
+    }
+
+    /**
+     * @brief Removes the last character of the query.
+     *
+     * @return true if a character was removed.
+     * @return false if the query was empty.
+     */
+    bool pop(){
+        if(this->query.empty()) return false;
+        this->query.pop_back();
+        this->frontiers.pop_back();
+        return true;
+    }
+
+    /**
+     * @brief Changes the query to the given string, reusing the frontiers of the common prefix.
+     *
+     * @param s the new query.
+     */
+    void set_query(const std::string& s){
+        size_t common = 0;
+        while(common < s.size() && common < query.size() && s[common] == query[common]) ++common;
+        while(query.size() > common) this->pop();
+        for(size_t i = common; i < s.size(); ++i) this->push(s[i]);
+    }
+
+    const std::string& get_query() const {
+        return this->query;
+    }
+
+    int get_max_error() const {
+        return this->max_error;
+    }
+
+    /**
+     * @brief The current frontier.
+     *
+     * @return const std::vector<entry_t>& the (dictionary state, errors, prefix) entries.
+     */
+    const std::vector<entry_t>& frontier() const {
+        return this->frontiers.back();
+    }
+
+    /**
+     * @brief Returns the words of the dictionary that start with a prefix that is within `max_error` edits of the
+     * query, ordered by their distance, then by their length, then in byte order.
+     *
+     * @param limit the largest number of words returned (0 for all of them).
+     * @return std::vector<std::pair<std::string, int> > the words and their distances.
+     */
+    std::vector<std::pair<std::string, int> > matches(size_t limit = 0){
+        std::vector<std::pair<std::string, int> > ret;
+        std::unordered_set<std::string> seen;
+        const std::vector<entry_t>& frontier = frontiers.back();
+        std::unordered_map<std::string, int> errors;
+        for(const entry_t& en : frontier) errors[en.prefix] = en.errors;
+        std::vector<const entry_t*> roots;
+        for(const entry_t& en : frontier){
+            if(!dominated(en, errors)) roots.push_back(&en);
+        }
+        for(int e = 0; e <= max_error; ++e){
+            // Breadth first from every entry with e errors (entries join when the search reaches their depth), so
+            // that shorter words come first.
+            std::vector<const entry_t*> seeds;
+            for(const entry_t* en : roots){
+                if(en->errors == e) seeds.push_back(en);
+            }
+            std::sort(seeds.begin(), seeds.end(), [](const entry_t* a, const entry_t* b){
+                return a->prefix.size() > b->prefix.size();
+            });
+            std::vector<std::pair<N, std::string> > level;
+            for(size_t depth = 0; level.size() || seeds.size(); ++depth){
+                while(seeds.size() && seeds.back()->prefix.size() == depth){
+                    level.push_back({seeds.back()->state, seeds.back()->prefix});
+                    seeds.pop_back();
+                }
+                std::vector<std::pair<N, std::string> > next_level;
+                std::vector<std::string> words; // (the words of a depth come out in byte order)
+                for(auto& p : level){
+                    if(dict->is_accept(p.first) && !seen.count(p.second)) words.push_back(p.second);
+                }
+                std::sort(words.begin(), words.end());
+                for(const std::string& w : words){
+                    if(!seen.insert(w).second) continue;
+                    ret.push_back({w, e});
+                    if(limit && ret.size() == limit) return ret;
+                }
+                for(auto& p : level){
+                    dict->for_each_transition(p.first, [&](char c, const N& next){
+                        next_level.push_back({next, p.second + c});
+                    });
+                }
+                level.swap(next_level);
+            }
+        }
+        return ret;
+    }
+};
@@ -4,14 +4,28 @@
 #include "data_structures/suffix_tree/suffix_tree.hpp"
 #include "data_structures/suffix_tree/suffix_tree_encoding.hpp"
 #include "data_structures/suffix_tree/doc_position_serialize.hpp"
+#include "data_structures/suffix_tree/external_build.hpp"
+#include "data_structures/suffix_tree/pigeonhole.hpp"
+#include "data_structures/FA/alphabet_map.hpp"
+#include "data_structures/qgram_index.hpp"
+#include "data_structures/radix_trie.hpp"
+#include "data_structures/FA/match_iterator.hpp"
+#include "data_structures/query_planner.hpp"
+#include "data_structures/text_normalizer.hpp"
 #include "util/trim.cpp"
+#include "util/batch.cpp"
+#include "util/background_writer.cpp"
+#include "util/alloc_counter.cpp"
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <unordered_map>
+#include <set>
 #include <functional>
+#include <thread>
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 #include <algorithm> 
 #include <cctype>
@@ -57,76 +71,304 @@ typedef struct env_t {
   char* file_path{NULL};
   bool debug{false};
   bool save_trie{false};
+  bool use_arena{false};      // bump-allocate the automata of each query
   bool cli{true};             // Assume that we want to use the CLI display by default. 
   bool skip_newline{true};
   int  chunk_size{15};
   bool lc_mode{true};
+  char* batch_path{NULL};     // answer the queries in this file (`-` for stdin) as JSON lines
+  int  threads{0};            // the number of threads used in batch mode (0: one per core)
+  size_t memory_budget{0};    // build the suffix tree on disk with runs of at most this many bytes (0: in memory)
+  bool use_radix{false};      // search a path-compressed copy of the suffix tree instead of intersecting it
+  bool utf8{false};           // count the errors in UTF-8 code points instead of bytes
 } env;
 
 std::string dir_path;
 std::string sfx_path;
+std::string norm_path;      // the normalized copy of the document that is indexed (see -f)
 compressed_suffix_tree compressed_dict;
+alphabet_map amap;
+background_writer writer;   // saves the `.sfx` caches (the destructor waits for them)
+qgram_index qgrams; // answers the queries that are longer than the chunk size
+radix_trie radix;   // the suffix tree with its single child chains folded (see -r)
+index_stats stats;  // the shape of the suffix tree, for the query planner
+plan_tally plans;   // the strategies the planner chose
+text_normalizer normalizer;   // folds the document and the queries (see -f)
+std::vector<ll> origins;      // the offset in the document of every offset of its normalized copy (see -f)
+std::vector<ll> line_starts;  // the offsets where the lines of the document start (if it is normalized)
+
+// The offset in the document of an offset of the indexed text.
+ll original_offset(ll pos){
+  if(origins.empty()) return pos;
+  return origins[std::max((ll) 0, std::min(pos, (ll) origins.size() - 1))];
+}
 
-void computation(env& e, compressed_suffix_tree& compressed_dict, std::unordered_set<char>& alphabet, char* word, int& error){
-  dprintf("READ: %s, %d\n", word, error);
-  if(strlen(word) == 0) {printf("\n"); return;};
-  if(strlen(word) > e.chunk_size) {printf("'%s' is longer than the chunk size [%i]\n", word, e.chunk_size); return;}
+// The line and the column in the document of an offset of the indexed text.
+std::pair<ll, ll> line_col(ll pos){
+  if(origins.empty()) return qgrams.line_col(pos);
+  pos = original_offset(pos);
+  ll line = std::upper_bound(line_starts.begin(), line_starts.end(), pos) - line_starts.begin();
+  return {line, pos - line_starts[line - 1] + 1};
+}
 
-  auto lnfa = levenshtein_nfa(word, error);
+// Answers a query that is longer than the chunk size with the q-gram index: prints every match (with its error).
+void long_computation(env& e, const std::string& word, int error, size_t limit = 0){
+  ll verified;
+  std::vector<qgram_match> matches;
+  df_tmp(milliseconds);
+  auto execution_time = time(milliseconds, matches = qgrams.search(word, error, &verified));
+  dprintf("Q-gram threshold: %lli shared %i-grams\n", qgram_index::threshold(word.size(), error, qgrams.get_q()),
+    qgrams.get_q());
+  dprintf("Q-gram verified text: %lli characters\n", verified);
+  dprintf("Q-gram search execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+  if(limit && matches.size() > limit) matches.resize(limit);
+  for(const qgram_match& m : matches){
+    std::string print_str;
+    for(char c : qgrams.substr(m)){
+      ifn(c == '\n' || c == '\r') {print_str += '\\'; continue;}
+      if(isalnum(c) || isblank(c) || ispunct(c)) print_str += c;
+      else print_str += '?';
+    }
+    printf("%-*s", e.chunk_size + 5, print_str.c_str());
+    if(e.lc_mode){
+      std::pair<ll, ll> lc = line_col(m.start);
+      printf(" [line %lli, col %lli]", lc.first, lc.second);
+    }else{
+      printf(" [%lli]", original_offset(m.start));
+    }
+    printf(" [error %d]\n", m.distance);
+  }
+}
+
+// Appends the results of a query that is longer than the chunk size to a batch result.
+void long_batch_computation(env& e, const batch_query& q, std::string& out){
+  bool first = true;
+  std::vector<qgram_match> matches = qgrams.search(q.query, q.error);
+  if(q.limit && matches.size() > q.limit) matches.resize(q.limit);
+  for(const qgram_match& m : matches){
+    out += first ? "{\"match\":" : ",{\"match\":";
+    first = false;
+    json_string(out, qgrams.substr(m));
+    out += ",\"error\":" + std::to_string(m.distance) + ",\"positions\":[";
+    if(e.lc_mode){
+      std::pair<ll, ll> lc = line_col(m.start);
+      out += "[" + std::to_string(lc.first) + "," + std::to_string(lc.second) + "]";
+    }else{
+      out += std::to_string(original_offset(m.start));
+    }
+    out += "]}";
+  }
+}
+
+// The DFA of the chunks that start with something the Levenshtein automaton accepts (once the end of the word is
+// reached, the rest of the chunk is read by a loop).
+template <class L>
+DFA<ll, char> chunk_dfa(L lnfa){
   for(auto acc : lnfa.accept_states()){ // if we are able to get to the end of the search query, then we always accept.
     lnfa.add_transition(acc, nfa_val<char>::STAR, acc);
   }
-  auto lnfa_dfa = lnfa.convert_to_dfa(alphabet).compress_dfa();
-  DFA<ll , char> intersection;
-  // time(milliseconds, DFA<ll CM char> intersection = compressed_dict.intersection(lnfa).compress_dfa())
+  return lnfa.convert_to_compressed_dfa();
+}
+
+// The allocations of a query (the difference of the counters taken before and after it).
+void print_allocations(env& e, const alloc_stats_t& before, const alloc_stats_t& after){
+  dprintf("Allocations [%s]: %zu heap (%zu by the automata), %zu arena (%zu bytes in %zu blocks)\n",
+    e.use_arena ? "arena" : "heap", after.heap_calls - before.heap_calls,
+    after.heap_allocations - before.heap_allocations, after.arena_allocations - before.arena_allocations,
+    after.arena_bytes - before.arena_bytes, after.arena_blocks - before.arena_blocks);
+}
+
+// Calls emit(chunk, state) for the (encoded) chunks that start with something within the error of the word (at most
+// `limit` of them if it is not 0), where state is the state of the suffix tree at the end of the chunk. The suffix
+// tree is walked together with the Levenshtein automaton of the word (see match_iterator.hpp), and every chunk is
+// emitted as soon as it is found.
+template <class F>
+void automaton_matches(env& e, compressed_suffix_tree& compressed_dict, const std::string& word, int error,
+  size_t limit, F emit){
+  arena query_arena;
+  arena_scope scope(e.use_arena ? &query_arena : NULL);
+  alloc_stats_t before = alloc_stats();
+
+  DFA<ll, char> lnfa_dfa = e.utf8 ? chunk_dfa(utf8_levenshtein_nfa(word, error, amap))
+    : chunk_dfa(levenshtein_nfa(amap.encode(word), error));
   df_tmp(milliseconds);
-  auto execution_time = time(milliseconds, intersection = compressed_dict.intersection(lnfa_dfa).compress_dfa());
-  dprintf("Levenschtein DFA size: %lu states\n", lnfa.states().size());
-  dprintf("Intersection [dict ^ lnfa] DFA size: %lu states\n", intersection.states().size());
-  dprintf("Intersection [dict ^ lnfa] DFA execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+  if(e.use_radix){ // (the nodes of the radix trie know their states in the suffix tree)
+    size_t followed = 0;
+    auto execution_time = time(milliseconds, radix.for_each_match(lnfa_dfa, [&](const std::string& needle,
+      uint32_t node){ emit(needle, radix.origin(node)); }, limit, &followed));
+    alloc_stats_t after = alloc_stats();
+    dprintf("Levenschtein DFA size: %lu states\n", lnfa_dfa.states().size());
+    dprintf("Radix trie [%lu nodes] search: %lu edges followed\n", radix.size(), followed);
+    dprintf("Radix trie search execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+    print_allocations(e, before, after);
+    return;
+  }
+  std::chrono::microseconds start = get_time(microseconds), first{0};
+  match_iterator<compressed_suffix_tree> matches(compressed_dict, lnfa_dfa, limit);
+  std::string needle;
+  ll state;
+  while(matches.next(needle, state)){
+    if(matches.count() == 1) first = get_time(microseconds) - start;
+    emit(needle, state);
+  }
+  std::chrono::microseconds execution_time = get_time(microseconds) - start;
+  alloc_stats_t after = alloc_stats();
+  dprintf("Levenschtein DFA size: %lu states\n", lnfa_dfa.states().size());
+  dprintf("Match iterator [dict ^ lnfa]: %lu results, %lu states visited\n", matches.count(),
+    matches.states_visited());
+  dprintf("Match iterator first result: %llu us, execution time: %llu us\n", FORCE(unsigned long long, first),
+    FORCE(unsigned long long, execution_time));
+  print_allocations(e, before, after);
+}
+
+// The text of the document at the given offset (see pigeonhole.hpp).
+std::string document_at(ll start, ll length){
+  return document_at(qgrams.get_text(), start, length);
+}
+
+// The statistics of the planner, from the chunks of the document in sorted order.
+index_stats chunk_stats(env& e){
+  std::vector<ll> starts;
+  for(ll p = 0; p + e.chunk_size <= (ll) qgrams.get_text().size() + 1; ++p) starts.push_back(p);
+  std::sort(starts.begin(), starts.end(), [&](ll a, ll b){
+    return document_at(a, e.chunk_size) < document_at(b, e.chunk_size);
+  });
+  return index_stats(starts.size(), [&](size_t i){ return document_at(starts[i], e.chunk_size); }, amap.size());
+}
+
+// Plans a query that is not longer than the chunk size (see query_planner.hpp): the pigeonhole partition or the
+// automaton. Reports the plan in the debug output.
+query_plan plan_query(env& e, const std::string& word, int error){
+  query_planner planner(stats);
+  planner.match_prefixes();
+  planner.use_partition(e.chunk_size, qgrams.get_text().size() + 1);
+  if(e.utf8) planner.count_code_points();
+  query_plan plan = planner.plan(word.size(), error);
+  plans.add(plan.strategy);
   ifd {
-    DFA<ll, char> intersection2;
-    execution_time = time(milliseconds, intersection2 = lnfa_dfa.intersection(compressed_dict).compress_dfa());
-    dprintf("Intersection [lnfa ^ dict] DFA size: %lu states\n", intersection2.states().size());
-    dprintf("Intersection [lnfa ^ dict] DFA execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+    std::string costs;
+    for(const std::pair<search_strategy, double>& c : plan.costs){
+      costs += (costs.size() ? ", " : "") + std::string(strategy_name(c.first)) + " " + std::to_string((ll) c.second);
+    }
+    dprintf("Query plan: %s (estimated costs: %s)\n", strategy_name(plan.strategy), costs.c_str());
+  }
+  return plan;
+}
+
+// Prints a matching chunk and its positions.
+void print_needle(env& e, compressed_suffix_tree& compressed_dict, const std::string& needle, ll state){
+  std::string print_str;
+  for(char c : needle){
+    c = amap.decode(c);
+    ifn(c == '\n' || c == '\r') {print_str += '\\'; continue;} // if the character is a newline mark it as a line skip
+    if(isalnum(c) || isblank(c) || ispunct(c)) print_str += c;
+    else print_str += '?';
+  }
+  int padding = e.chunk_size + 5;
+  char pstr[5];
+  char buf[30] = "%-";
+  sprintf(pstr, "%d", padding);
+  strcat(buf, pstr);
+  strcat(buf, "s");
+  printf(buf, print_str.c_str());
+
+  ifn(true){
+    if(e.lc_mode){
+      std::unordered_set<std::pair<ll,ll> > ind = compressed_dict.get_lc_at(state);
+      for(auto i : ind){
+        sprintf(buf, " [line %lli, col %lli]", i.first, i.second);
+        printf("%s", buf);
+      }
+    }else{
+      std::unordered_set<ll> ind = compressed_dict.get_indices_at(state);
+      for(auto i : ind){
+        sprintf(buf, " [%lli]", original_offset(i));
+        printf("%s", buf);
+      }
+    }
+    printf("\n");
+  }
+}
+
+void computation(env& e, compressed_suffix_tree& compressed_dict, char* read, int& error, size_t limit = 0){
+  dprintf("READ: %s, %d\n", read, error);
+  std::string word = normalizer.apply(read); // (folded like the document)
+  if(word.size() == 0) {printf("\n"); return;};
+  if(word.size() > e.chunk_size){ // no chunk is long enough to hold a match
+    dprintf("Query plan: q-gram index (longer than the chunk size)\n");
+    long_computation(e, word, error, limit);
+    return;
+  }
+
+  std::vector<needle_t> needles;
+  df_tmp(milliseconds);
+  size_t checked = 0;
+  auto print = [&](const std::string& needle, ll state){ print_needle(e, compressed_dict, needle, state); };
+  auto pigeonhole = [&](){ // (with its debug output)
+    auto execution_time = time(milliseconds, pigeonhole_matches(compressed_dict, amap, qgrams.get_text(),
+      e.chunk_size, word, error, needles, &checked));
+    dprintf("Pigeonhole [%d pieces] candidates: %lu, matches: %lu\n", error + 1, checked, needles.size());
+    dprintf("Pigeonhole execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+  };
+  query_plan plan = plan_query(e, word, error);
+  if(plan.strategy == search_strategy::partition){
+    pigeonhole();
+    ifd automaton_matches(e, compressed_dict, word, error, limit, [](const std::string&, ll){}); // for comparison
+    if(limit && needles.size() > limit) needles.resize(limit);
+    for(const needle_t& needle : needles) print(needle.first, needle.second);
+  }else{
+    automaton_matches(e, compressed_dict, word, error, limit, print); // printed as they are found
+    ifd if(error >= 0 && (ll) word.size() > error) pigeonhole(); // for comparison
   }
-  // std::cout << intersection;
+}
+
+// Answers a batch query with a JSON line: {"query": ..., "error": N, "results": [{"match": ..., "positions": [...]}]}
+void batch_computation(env& e, compressed_suffix_tree& compressed_dict, const batch_query& read, std::string& out){
+  json_query(out, read);
+  batch_query q = read;
+  q.query = normalizer.apply(read.query); // (folded like the document)
+  if(q.query.size() > e.chunk_size){
+    out += ",\"results\":[";
+    long_batch_computation(e, q, out);
+    out += "]}\n";
+    return;
+  }
+  std::vector<needle_t> needles;
+  env quiet = e;
+  quiet.debug = false;
+  if(plan_query(quiet, q.query, q.error).strategy == search_strategy::partition){
+    pigeonhole_matches(compressed_dict, amap, qgrams.get_text(), e.chunk_size, q.query, q.error, needles);
+    if(q.limit && needles.size() > q.limit) needles.resize(q.limit);
+  }else{
+    automaton_matches(quiet, compressed_dict, q.query, q.error, q.limit, [&](const std::string& needle, ll state){
+      needles.push_back({needle, state});
+    });
+  }
+  out += ",\"results\":[";
   bool first = true;
-  for(std::vector<char> result : intersection.accept_paths()){
+  for(const needle_t& needle : needles){
+    if(!first) out += ',';
     first = false;
-    std::string needle;
-    std::string print_str;
-    for(char c : result){
-      needle += c;
-      ifn(c == '\n' || c == '\r') {print_str += '\\'; continue;} // if the character is a newline mark it as a line skip
-      if(isalnum(c) || isblank(c) || ispunct(c)) print_str += c;
-      else print_str += '?';
-    }
-    int padding = e.chunk_size + 5;
-    char pstr[5];
-    char buf[30] = "%-";
-    sprintf(pstr, "%d", padding);
-    strcat(buf, pstr);
-    strcat(buf, "s");
-    printf(buf, print_str.c_str());
-
-    ifn(true){
-      if(e.lc_mode){
-        std::unordered_set<std::pair<ll,ll> > ind = compressed_dict.get_lc(needle);
-        for(auto i : ind){
-          sprintf(buf, " [line %lli, col %lli]", i.first, i.second);
-          printf("%s", buf);
-        }
-      }else{
-        std::unordered_set<ll> ind = compressed_dict.get_indices(needle);
-        for(auto i : ind){
-          sprintf(buf, " [%lli]", i);
-          printf("%s", buf);
-        }
+    out += "{\"match\":";
+    json_string(out, amap.decode(needle.first));
+    out += ",\"positions\":[";
+    bool first_position = true;
+    if(e.lc_mode){
+      for(auto i : compressed_dict.get_lc_at(needle.second)){
+        out += first_position ? "[" : ",[";
+        out += std::to_string(i.first) + "," + std::to_string(i.second) + "]";
+        first_position = false;
+      }
+    }else{
+      for(auto i : compressed_dict.get_indices_at(needle.second)){
+        if(!first_position) out += ',';
+        out += std::to_string(original_offset(i));
+        first_position = false;
       }
-      printf("\n");
     }
+    out += "]}";
   }
+  out += "]}\n";
 }
 
 bool file_exists(char* fp){
@@ -151,22 +393,55 @@ void save_file(env& e){
     mkdir(dir_path.c_str(), 0700);
   }
 
-  // Save all information to that file.
-  std::ofstream of; of.open(sfx_path.c_str(), std::ofstream::binary);
-  serialize_suffix_tree(of, compressed_dict); // add the entire dict.
-  of.close();
+  // Encode the entire dict in memory, and write it in the background (the prompt comes back right away).
+  std::ostringstream os;
+  serialize_suffix_tree(os, compressed_dict, &amap);
+  dprintf("Saving %lu bytes to %s in the background\n", (unsigned long) os.tellp(), sfx_path.c_str());
+  writer.save(sfx_path, os.str());
+}
+
+// Relabels the loaded suffix tree with a dense alphabet (see alphabet_map.hpp).
+void remap_alphabet(){
+  amap = alphabet_map(compressed_dict.get_alphabet());
+  amap.apply(compressed_dict);
 }
 
 void initialize_paths(env& e, char* fp){
   // Path string constructions:
   sfx_path = fp;
   sfx_path.insert(sfx_path.rfind('/'), std::string("/.cache"));
-  std::string suf = ".sfx" + std::to_string(e.chunk_size);
+  std::string suf = normalizer.suffix() + ".sfx" + std::to_string(e.chunk_size);
   sfx_path = sfx_path.replace(sfx_path.begin() + sfx_path.rfind('.'), sfx_path.end(), suf);
+  norm_path = sfx_path.substr(0, sfx_path.rfind('.')) + ".txt";
   std::string tmp = sfx_path;
   dir_path = tmp.replace(tmp.begin() + tmp.rfind('/'), tmp.end(), "");
 }
 
+// Reads the document into the text that is indexed, and sets `indexed` to the file the suffix tree is built from.
+// When the document is normalized (-f), that is its normalized copy, which is written next to the cache, and the
+// offsets of the copy are mapped back to the document.
+std::string read_document(env& e, FILE* fs, std::string& indexed){
+  std::string text;
+  char block[1 << 16];
+  size_t got;
+  while((got = fread(block, 1, sizeof(block), fs)) > 0) text.append(block, got);
+  indexed = e.file_path;
+  if(normalizer.identity()) return text;
+  line_starts.assign(1, 0);
+  for(size_t i = 0; i < text.size(); ++i){
+    if(text[i] == '\n') line_starts.push_back(i + 1);
+  }
+  text = normalizer.apply(text, &origins);
+  struct stat st{0};
+  if(stat(dir_path.c_str(), &st) == -1) {
+    mkdir(dir_path.c_str(), 0700);
+  }
+  std::ofstream of(norm_path.c_str(), std::ofstream::binary);
+  of.write(text.data(), text.size());
+  indexed = norm_path;
+  return text;
+}
+
 void wait_for_file_load(env& e){
   printf("Use `load FILE_PATH` to load a file\n");
   printf("Use `save FILE_PATH` to save a file to the local '.cache' directory.\n");
@@ -204,8 +479,13 @@ void wait_for_file_load(env& e){
       e.file_path = fp;
       suffix_tree doc;
       initialize_paths(e, fp);
-      doc.load_file(e.file_path, e.chunk_size);
+      std::string indexed;
+      FILE* fs = fopen(e.file_path, "r");
+      read_document(e, fs, indexed);
+      fclose(fs);
+      doc.load_file(indexed, e.chunk_size);
       compressed_dict = doc.compress_dfa();
+      remap_alphabet();
       save_file(e);
       strcpy(e.file_path, "");
     }
@@ -219,7 +499,6 @@ void begin_search_loop(env& e){
   size_t len = 0;
   ssize_t read;
 
-  std::unordered_set<char> alphabet;
   suffix_tree doc;
 
   if(!strcmp(e.file_path, "")){
@@ -233,47 +512,100 @@ void begin_search_loop(env& e){
   }
 
   initialize_paths(e, e.file_path);
+  writer.wait(); // the cache of this file may still be being saved
 
-  if(e.save_trie || fopen(sfx_path.c_str(), "r") == NULL){ // if we want to resave the file, then force a complete file read.
-    printf("[No cache found] Loading ..."); fflush(stdout);
-    doc.load_file(e.file_path, e.chunk_size);
-    alphabet = doc.get_alphabet();
-    compressed_dict = doc.compress_dfa();
-    if(e.save_trie){  // If we want to save the trie.
-      // Create the '.cache' folder if not already there
-      struct stat st{0};
-      if(stat(dir_path.c_str(), &st) == -1) {
-        mkdir(dir_path.c_str(), 0700);
-      }
+  std::string indexed;
+  qgrams = qgram_index(read_document(e, fs, indexed));
 
-      // Save all information to that file.
-      std::ofstream of; of.open(sfx_path.c_str(), std::ofstream::binary);
-      serialize_suffix_tree(of, compressed_dict); // add the entire dict.
+  bool cached = !e.save_trie && fopen(sfx_path.c_str(), "r") != NULL;
+  if(!cached && e.memory_budget){ // build the cache on disk, then load it
+    cprintf("[No cache found] Loading ..."); fflush(stdout);
+    struct stat st{0};
+    if(stat(dir_path.c_str(), &st) == -1) {
+      mkdir(dir_path.c_str(), 0700);
+    }
+    size_t runs = 0;
+    std::string tmp_path = sfx_path + ".tmp"; // (renamed once it is complete, like the saves of the writer)
+    std::ofstream of; of.open(tmp_path.c_str(), std::ofstream::binary);
+    try{
+      build_suffix_tree_external(of, indexed, e.chunk_size, e.memory_budget, sfx_path, &runs);
+      of.close();
+      if(!of) throw std::runtime_error("Cannot write the index!");
+    }catch(const std::runtime_error& err){ // (a truncated index must not be cached)
       of.close();
+      remove(tmp_path.c_str());
+      fprintf(stderr, "\nERROR: The index could not be built on disk: %s\n", err.what());
+      exit(1);
     }
+    rename(tmp_path.c_str(), sfx_path.c_str());
+    dprintf(" [%lu runs of at most %lu bytes]", runs, e.memory_budget);
+    cached = true;
+  }else if(!cached){ // if we want to resave the file, then force a complete file read.
+    cprintf("[No cache found] Loading ..."); fflush(stdout);
+    doc.load_file(indexed, e.chunk_size);
+    compressed_dict = doc.compress_dfa();
+    remap_alphabet();
+    if(e.save_trie) save_file(e);  // If we want to save the trie.
   }else{
-    printf("[Cache found] Loading ..."); fflush(stdout);
+    cprintf("[Cache found] Loading ..."); fflush(stdout);
+  }
+  if(cached){
     std::ifstream ifs(sfx_path, std::ifstream::binary);
-    deserialize_suffix_tree(ifs, compressed_dict);
-    alphabet = compressed_dict.get_alphabet();
+    deserialize_suffix_tree(ifs, compressed_dict, &amap);
     ifs.close();
   }
-  printf(" Done!\n"); 
+  if(cached || !normalizer.identity()){
+    // the cache only keeps the indices of the positions, and the lines of a normalized copy are not the document's
+    compressed_dict.set_line_columns(e.chunk_size, [](ll pos){ return line_col(pos); });
+  }
+  if(e.use_radix){
+    df_tmp(milliseconds);
+    auto execution_time = time(milliseconds, radix = radix_trie(compressed_dict));
+    dprintf("Radix trie: %lu nodes (the suffix tree has %lu), %lu label bytes, %lu bytes, built in %llu ms\n",
+      radix.size(), compressed_dict.states().size(), radix.pool_size(), radix.memory(),
+      FORCE(unsigned long long, execution_time));
+  }
+  dprintf("Suffix tree: %lu positions, %lu bytes\n", compressed_dict.positions(), compressed_dict.memory_usage().total());
+  dprintf("Q-gram index: %lu bytes\n", qgrams.memory());
+  {
+    df_tmp(milliseconds);
+    auto execution_time = time(milliseconds, stats = chunk_stats(e));
+    dprintf("Planner statistics: %lu depths, %.0f chunks, gathered in %llu ms\n", stats.depth() + 1,
+      stats.nodes_at(e.chunk_size), FORCE(unsigned long long, execution_time));
+  }
+  cprintf(" Done!\n");
   cprintf("> "); fflush(stdout);
   fclose(fs);
 
+  if(e.batch_path){
+    FILE* in = strcmp(e.batch_path, "-") ? fopen(e.batch_path, "r") : stdin;
+    if(in == NULL){
+      fprintf(stderr, "ERROR: File error! Check if the batch file exists and if reads are allowed.\n");
+      exit(1);
+    }
+    buffered_writer out(stdout);
+    df_tmp(milliseconds);
+    ll answered;
+    auto execution_time = time(milliseconds, answered = run_batch(in, out, e.threads,
+      [&](const batch_query& q, std::string& result){ batch_computation(e, compressed_dict, q, result); }));
+    if(e.debug) fprintf(stderr, "Answered %lli queries in %llu ms\n", answered, FORCE(unsigned long long, execution_time));
+    if(e.debug) fprintf(stderr, "Query plans: %s\n", plans.summary().c_str());
+    if(in != stdin) fclose(in);
+    return;
+  }
+
   // Alphabet construction:
 
   while(getline(&line, &len, stdin) != -1){ // while lines can be read:
-    char word[MAX_WORD] = ""; int error = 0;
+    char word[MAX_WORD] = ""; int error = 0, limit = 0; // `... N LIMIT M` asks for the first M results
     
     if(line[0] == '\'' && e.cli){
       int i = 1;
       while(i < strlen(line) && line[i] != '\'') ++i; // find the last i
       if(i != strlen(line)){
-        sscanf(line+i+1, " %d", &error);
+        sscanf(line+i+1, " %d LIMIT %d", &error, &limit);
         line[i] = '\0';
-        computation(e, compressed_dict, alphabet, line+1, error);
+        computation(e, compressed_dict, line+1, error, std::max(limit, 0));
       }else{
         printf("Error: A WORD message must end with a '!\n");
       }
@@ -281,21 +613,21 @@ void begin_search_loop(env& e){
       int i = 1;
       while(i < strlen(line) && line[i] != '"') ++i; // find the last i
       if(i != strlen(line)){
-        sscanf(line+i+1, " %d", &error);
+        sscanf(line+i+1, " %d LIMIT %d", &error, &limit);
         line[i] = '\0';
         char buf[MAX_STRING];
         strcpy(buf, line+1);
         char* tok = strtok(buf, " ");
         while(tok){
-          computation(e, compressed_dict, alphabet, tok, error);
+          computation(e, compressed_dict, tok, error, std::max(limit, 0));
           tok = strtok(NULL, " ");
         }
       }else{
         printf("Error: A STRING message must end with a \"!\n");
       }
     }else{
-      sscanf(line, "%25s %d", word, &error);
-      computation(e, compressed_dict, alphabet, word, error);
+      sscanf(line, "%25s %d LIMIT %d", word, &error, &limit);
+      computation(e, compressed_dict, word, error, std::max(limit, 0));
     }
 
     // for next line:
@@ -311,6 +643,10 @@ void save_trie(env& _env_, int& flag_pos, char* argv[]){
   _env_.save_trie = true;
 }
 
+void arena_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.use_arena = true;
+}
+
 void command_line_interface(env& _env_, int& flag_pos, char* argv[]){
   _env_.cli = true;
 }
@@ -324,6 +660,52 @@ void change_chunk_size(env& _env_, int& flag_pos, char* argv[]){
   _env_.chunk_size = atoi(argv[++flag_pos]);
 }
 
+void batch_mode(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "A file (or `-` for stdin) must be specified after the -b or --batch flag!\n");
+    exit(1);
+  }
+  _env_.batch_path = argv[++flag_pos];
+  _env_.cli = false;
+}
+
+void change_threads(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "The number of threads must be specified after the -t or --threads flag!\n");
+    exit(1);
+  }
+  _env_.threads = atoi(argv[++flag_pos]);
+}
+
+void memory_budget(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs || atoi(argv[flag_pos + 1]) <= 0){
+    fprintf(stderr, "A positive number of megabytes must be specified after the -m or --memory flag!\n");
+    exit(1);
+  }
+  _env_.memory_budget = (size_t) atoi(argv[++flag_pos]) << 20;
+}
+
+void radix_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.use_radix = true;
+}
+
+void utf8_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.utf8 = true;
+}
+void fold_steps(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "A list of steps must be specified after the -f or --fold flag!\n");
+    exit(1);
+  }
+  std::stringstream steps(argv[++flag_pos]);
+  std::string step;
+  while(std::getline(steps, step, ',')){
+    if(!normalizer.enable(step)){
+      fprintf(stderr, "Unknown step \"%s\" (expected case, space or punct)!\n", step.c_str());
+      exit(1);
+    }
+  }
+}
 void index_mode(env& _env_, int& flag_pos, char* argv[]) {
   _env_.lc_mode = false;
 }
@@ -331,16 +713,42 @@ void index_mode(env& _env_, int& flag_pos, char* argv[]) {
 void help(env& _env_, int& flag_pos, char* argv[]){
   printf(
     "usage: document_search [-d | --debug] [-s | --save] [-c | --chunk N]\n"\
-    "                       [-h | --help]  [-i | --index] [FILE_NAME]\n\n"\
+    "                       [-h | --help]  [-i | --index] [-a | --arena]\n"\
+    "                       [-b | --batch FILE] [-t | --threads N]\n"\
+    "                       [-m | --memory MB] [-r | --radix] [-u | --utf8]\n"\
+    "                       [-f | --fold STEPS] [FILE_NAME]\n\n"\
     "Builds a suffix tree out of the given document (if provided). If no file\n"\
     "name is provided, then file mode is activated and the user can load and\n"\
     "save files via the `load` and `save` commands. Then, it allows the user to\n"\
     "search for strings in the document with the given levenschtein error.\n\n"\
     "  d : print debug information [for developer use only]\n"\
+    "  a : allocate the automata of each query from a single arena that is\n"\
+    "      released at the end of the query\n"\
     "  s : forces a file read and saves the trie in a `.cache` directory\n"\
     "  c : the size of the chunks used in the suffix tree (a larger chunk\n"\
     "      size results in more preprocessing time and memory consumption)\n"\
     "  i : show index rather than line/column values\n"\
+    "  b : batch mode, answers every query in FILE (`-` for stdin) without\n"\
+    "      prompts; each line is either `WORD<TAB>N` (or just `WORD`) or\n"\
+    "      {\"query\": \"WORD\", \"error\": N} (with an optional \"limit\": M), and\n"\
+    "      each query is answered with a JSON line {\"query\": ..., \"error\": N,\n"\
+    "      \"results\": [{\"match\": ...,\n"\
+    "      \"positions\": [[LINE, COL], ...]}, ...]}\n"\
+    "  t : the number of threads used in batch mode (one per core by default)\n"\
+    "  m : builds the suffix tree on disk (in the `.cache` directory) using at\n"\
+    "      most MB megabytes for each sorted run of chunks, for documents that\n"\
+    "      do not fit in memory\n"\
+    "  r : searches a path-compressed (radix) copy of the suffix tree, whose\n"\
+    "      single child chains are folded into edges labeled with strings,\n"\
+    "      instead of intersecting the suffix tree with the query automaton\n"\
+    "  u : counts the errors in UTF-8 code points instead of bytes (so an\n"\
+    "      accented letter is one error); the chunks are still bytes, and the\n"\
+    "      queries that are longer than the chunk size still count bytes\n"\
+    "  f : normalizes the document before it is indexed, and every query the\n"\
+    "      same way; STEPS is a comma separated list of `case` (lowercases\n"\
+    "      A-Z), `space` (collapses every run of whitespace into one space) and\n"\
+    "      `punct` (removes punctuation); the positions are still those of the\n"\
+    "      document, and each set of steps is cached on its own\n"\
     "  h : print this help message\n\n"\
     "There are three ways to search in the provided file via the command line\n"\
     "interface:\n\n"\
@@ -348,7 +756,10 @@ void help(env& _env_, int& flag_pos, char* argv[]){
     "  > WORD N                    : searches for the word in the document with N errors\n"\
     "  > \"WORD_1 WORD_2 ...\" N     : searches for each of the words with N errors\n"\
     "  > 'WORD' N                  : searches for the word (without escaping spaces)\n"\
-    "                                with N errors\n" 
+    "                                with N errors\n"\
+    "  > WORD N LIMIT M            : prints the first M matches (and stops searching)\n\n"\
+    "Queries that are longer than the chunk size (eg. whole sentences) are answered\n"\
+    "with a q-gram index of the document, and each match also prints its error.\n"
     );
   exit(0);
 }
@@ -365,10 +776,24 @@ int main(int argc, char* argv[]){
   commands["--save"] = save_trie;
   commands["-c"] = change_chunk_size;
   commands["--chunk"] = change_chunk_size;
+  commands["-a"] = arena_mode;
+  commands["--arena"] = arena_mode;
   commands["-h"] = help;
   commands["--help"] = help;
   commands["-i"] = index_mode;
+  commands["-b"] = batch_mode;
+  commands["--batch"] = batch_mode;
+  commands["-t"] = change_threads;
+  commands["--threads"] = change_threads;
   commands["--index"] = index_mode;
+  commands["-m"] = memory_budget;
+  commands["--memory"] = memory_budget;
+  commands["-r"] = radix_mode;
+  commands["--radix"] = radix_mode;
+  commands["-u"] = utf8_mode;
+  commands["--utf8"] = utf8_mode;
+  commands["-f"] = fold_steps;
+  commands["--fold"] = fold_steps;
   int st = 1;
   int pos = 0;
   while(st < argc){
@@ -389,5 +814,7 @@ int main(int argc, char* argv[]){
     ++st;
   }
 
+  if(main_env.threads <= 0) main_env.threads = std::max(1u, std::thread::hardware_concurrency());
+
   begin_search_loop(main_env);
 }
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "data_structures/dawg.hpp"
+#include "data_structures/suffix_tree/suffix_tree.hpp"
+#include "data_structures/suffix_tree/suffix_tree_encoding.hpp"
+#include "data_structures/suffix_tree/doc_position_serialize.hpp"
+#include "data_structures/FA/alphabet_map.hpp"
+#include "data_structures/FA/memory_usage.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Macros:
+#define dprintf(...)    if(e.debug) printf(__VA_ARGS__)
+#define get_time(typ)   std::chrono::duration_cast<std::chrono::typ>(std::chrono::system_clock::now().time_since_epoch())
+#define df_tmp(typ)     std::chrono::typ tmp
+#define time(typ, op)   (tmp = get_time(typ), op, get_time(typ) - tmp)
+#define FORCE(typ, v)   (*((typ*) &(v)))
+
+// The environment template
+typedef struct env_t {
+  char* file_path{NULL};
+  char* type{NULL};           // "trie" or "sfx" (from the extension of the file by default)
+  bool debug{false};
+} env;
+
+// The counts of a structure that are printed.
+typedef struct inspection_t {
+  size_t states{0};
+  size_t accepts{0};
+  size_t edges{0};
+  size_t defaults{0};
+  size_t positions{0};
+  std::map<size_t, size_t> fanout;  // out edges -> states
+  std::map<size_t, size_t> depth;   // the length of the shortest path from the start -> states
+  memory_usage_t memory;
+} inspection;
+
+int nargs;
+
+// The accepted, out and default edges of every state, and the depth of every state (by a BFS from the start).
+template <class D>
+void inspect(D& dfa, inspection& in){
+  std::unordered_map<ll, size_t> depth;
+  std::list<ll> q{dfa.get_start()};
+  depth[dfa.get_start()] = 0;
+  while(q.size()){
+    ll cur = q.front(); q.pop_front();
+    size_t out = 0, d = depth[cur];
+    auto visit = [&](ll next){
+      if(depth.count(next)) return;
+      depth[next] = d + 1;
+      q.push_back(next);
+    };
+    dfa.for_each_transition(cur, [&](char, ll next){ ++out; visit(next); });
+    if(dfa.has_default_transition(cur)){
+      ++in.defaults;
+      visit(dfa.default_state(cur));
+    }
+    in.edges += out;
+    in.fanout[out]++;
+    in.depth[d]++;
+    if(dfa.is_accept(cur)) ++in.accepts;
+  }
+  in.states = depth.size();
+  in.memory = dfa.memory_usage();
+}
+
+void inspect_trie(env& e, inspection& in){
+  std::ifstream ifs(e.file_path, std::ifstream::binary);
+  DFA<ll, char> cached;
+  alphabet_map amap;
+  deserialize<char>(ifs, cached, &amap);
+  // the weights are kept next to the trie (see word_search.cpp)
+  std::string wpath = e.file_path;
+  wpath = wpath.substr(0, wpath.rfind('.')) + ".weights";
+  std::unordered_map<ll, ll> weights;
+  std::ifstream wf(wpath.c_str(), std::ios::binary);
+  ll state, w;
+  while(wf.read((char*) &state, sizeof(ll)) && wf.read((char*) &w, sizeof(ll))) weights[state] = w;
+  dprintf("[%lu weights]\n", weights.size());
+  dawg dict;
+  dict.build(cached, &weights);
+  inspect(dict, in);
+  in.memory.alphabet += sizeof(amap);
+}
+
+void inspect_suffix_tree(env& e, inspection& in){
+  std::ifstream ifs(e.file_path, std::ifstream::binary);
+  compressed_suffix_tree tree;
+  alphabet_map amap;
+  deserialize_suffix_tree(ifs, tree, &amap);
+  inspect(tree, in);
+  in.memory.alphabet += sizeof(amap);
+  in.positions = tree.positions();
+}
+
+void print_row(const char* name, size_t value, size_t total){
+  printf("  %-10s %12lu  (%5.1f%%)\n", name, value, total ? 100.0 * value / total : 0.0);
+}
+
+void print_histogram(const char* title, const std::map<size_t, size_t>& h, size_t total){
+  printf("\n%s\n", title);
+  for(auto& row : h) print_row(std::to_string(row.first).c_str(), row.second, total);
+}
+
+void print_inspection(env& e, const std::string& type, size_t file_bytes, inspection& in){
+  memory_usage_t& m = in.memory;
+  printf("File:      %s (%lu bytes)\n", e.file_path, file_bytes);
+  printf("Structure: %s\n", type == "sfx" ? "compressed suffix tree" : "DAWG");
+  printf("States:    %lu (%lu accept)\n", in.states, in.accepts);
+  printf("Edges:     %lu (%lu default)\n", in.edges, in.defaults);
+  if(type == "sfx") printf("Positions: %lu\n", in.positions);
+  print_histogram("Fan-out (out edges: states)", in.fanout, in.states);
+  print_histogram("Depth (shortest path from the start: states)", in.depth, in.states);
+  size_t total = m.total();
+  printf("\nMemory (estimated heap, bytes)\n");
+  print_row("states", m.states, total);
+  print_row("accept", m.accept, total);
+  print_row("edges", m.edges, total);
+  print_row("defaults", m.defaults, total);
+  print_row("alphabet", m.alphabet, total);
+  if(type == "sfx") print_row("positions", m.positions, total);
+  else print_row("register", m.other, total);
+  printf("  %-10s %12lu  (%.1f bytes per state, %.1f per edge)\n", "total", total,
+    in.states ? (double) total / in.states : 0.0, in.edges ? (double) total / in.edges : 0.0);
+}
+
+void begin_inspection(env& e){
+  struct stat st;
+  if(stat(e.file_path, &st) == -1){
+    fprintf(stderr, "ERROR: File error! Check if the file exists and if reads are allowed.\n");
+    exit(1);
+  }
+  std::string type = e.type ? e.type : (strstr(e.file_path, ".sfx") ? "sfx" : "trie");
+  if(type != "sfx" && type != "trie"){
+    fprintf(stderr, "ERROR: Unknown type \"%s\" (expected \"trie\" or \"sfx\").\n", type.c_str());
+    exit(1);
+  }
+  inspection in;
+  df_tmp(milliseconds);
+  auto load_time = time(milliseconds, type == "sfx" ? inspect_suffix_tree(e, in) : inspect_trie(e, in));
+  dprintf("[Inspected in %llu ms]\n", FORCE(unsigned long long, load_time));
+  print_inspection(e, type, st.st_size, in);
+}
+
+void debug_switch(env& _env_, int& flag_pos, char* argv[]){
+  _env_.debug = true;
+}
+
+void change_type(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "A type must be specified after the -t or --type flag!\n");
+    exit(1);
+  }
+  _env_.type = argv[++flag_pos];
+}
+
+void help(env& _env_, int& flag_pos, char* argv[]){
+  printf(
+    "usage: fss_inspect [-d | --debug] [-t | --type trie|sfx] [-h | --help]\n"\
+    "                   CACHE_FILE\n\n"\
+    "Loads a cached dictionary (`.trie`, see word_search) or document (`.sfxN`,\n"\
+    "see document_search) and prints its state and edge counts, a histogram of\n"\
+    "the fan-out of the states, the depth distribution of the states, and the\n"\
+    "estimated bytes of every component of the loaded structure.\n\n"\
+    "  d : print debug information [for developer use only]\n"\
+    "  t : the type of the cache (from the file extension by default)\n"\
+    "  h : print this help message\n"
+    );
+  exit(0);
+}
+
+int main(int argc, char* argv[]){
+  env main_env{};
+  nargs = argc;
+  std::unordered_map<std::string, std::function<void(env&,int&,char**)> > commands;
+  commands["-d"] = debug_switch;
+  commands["--debug"] = debug_switch;
+  commands["-t"] = change_type;
+  commands["--type"] = change_type;
+  commands["-h"] = help;
+  commands["--help"] = help;
+  std::vector<char*> positional;
+  int st = 1;
+  while(st < argc){
+    if(commands.count(argv[st])){ // if the flag is found
+      commands[argv[st]](main_env,st,argv);
+    }else{
+      positional.push_back(argv[st]);
+    }
+    ++st;
+  }
+  if(positional.size() != 1){
+    fprintf(stderr, "ERROR: Invalid # of position arguments provided. Use \"--help\""\
+      " to display correct usage.\n");
+    exit(1);
+  }
+  main_env.file_path = positional[0];
+  begin_inspection(main_env);
+}
@@ -0,0 +1,422 @@
+#include "data_structures/levenshtein_scanner.hpp"
+#include "data_structures/multi_levenshtein_scanner.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <climits>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cctype>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Macros:
+#define dprintf(...)    if(e.debug) printf(__VA_ARGS__)
+#define ifd             if(e.debug)
+#define get_time(typ)   std::chrono::duration_cast<std::chrono::typ>(std::chrono::system_clock::now().time_since_epoch())
+#define df_tmp(typ)     std::chrono::typ tmp
+#define time(typ, op)   (tmp = get_time(typ), op, get_time(typ) - tmp)
+#define FORCE(typ, v)   (*((typ*) &(v)))
+#define BLOCK_SIZE      (1 << 20)
+#define MIN_CHUNK       (1 << 20)
+
+// The environment template
+typedef struct env_t {
+  char* file_path{NULL};
+  char* pattern{NULL};
+  char* patterns_path{NULL};  // a file of patterns (one per line, optionally followed by a tab and an error)
+  bool debug{false};
+  int  error{0};
+  int  threads{0};            // 0: one thread per core
+} env;
+
+typedef struct scan_hit_t {
+  ll start;                   // the offset of the first byte of the match
+  ll end;                     // the offset of the last byte of the match
+  int distance;
+  int pattern;                // the index of the pattern that matched
+  ll line;
+  ll column;
+} scan_hit;
+
+bool operator<(const scan_hit& a, const scan_hit& b){
+  return a.start < b.start || (a.start == b.start && a.end < b.end);
+}
+
+// Counts newlines up to a (non-decreasing) offset, so that offsets can be turned into [line, col] pairs.
+typedef struct line_tracker_t {
+  ll pos;                     // every byte before pos has been counted
+  ll lines;                   // the number of newlines before pos
+  ll last_nl;                 // the offset of the last newline before pos (-1 if there is none)
+
+  // buf[0] is at the offset buf_offset, and must hold every byte from pos up to `to`.
+  void seek(const char* buf, ll buf_offset, ll to){
+    while(pos < to){
+      const char* nl = (const char*) memchr(buf + (pos - buf_offset), '\n', to - pos);
+      if(nl == NULL){ pos = to; break; }
+      last_nl = buf_offset + (nl - buf);
+      lines++;
+      pos = last_nl + 1;
+    }
+  }
+
+  void resolve(const char* buf, ll buf_offset, scan_hit& h){
+    seek(buf, buf_offset, h.start);
+    h.line = lines + 1;
+    h.column = h.start - last_nl;
+  }
+} line_tracker;
+
+std::vector<std::string> pattern_names;
+int padding;
+
+// Gives the single pattern scanner the interface of the multi-pattern scanner (every hit is of pattern 0).
+class single_scanner : public levenshtein_scanner {
+public:
+  single_scanner(const std::string& pattern, int error) : levenshtein_scanner(pattern, error) {}
+
+  template <class F>
+  void feed(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F emit) const {
+    levenshtein_scanner::feed(c, buf, buf_offset, from, to, [&emit](ll end, int d){ emit(end, d, 0); });
+  }
+
+  template <class F>
+  ll feed_until_idle(cursor_t& c, const char* buf, ll buf_offset, ll from, ll to, F emit) const {
+    return levenshtein_scanner::feed_until_idle(c, buf, buf_offset, from, to,
+      [&emit](ll end, int d){ emit(end, d, 0); });
+  }
+
+  template <class F>
+  void finish(cursor_t& c, F emit) const {
+    levenshtein_scanner::finish(c, [&emit](ll end, int d){ emit(end, d, 0); });
+  }
+
+  ll match_start(const char* buf, ll buf_offset, ll end, int d, int pattern) const {
+    return levenshtein_scanner::match_start(buf, buf_offset, end, d);
+  }
+};
+
+void print_hit(env& e, const char* buf, ll buf_offset, scan_hit& h){
+  std::string print_str;
+  for(ll i = h.start; i <= h.end; ++i){
+    char c = buf[i - buf_offset];
+    if(c == '\n' || c == '\r') print_str += '\\'; // mark line skips
+    else if(isalnum(c) || isblank(c) || ispunct(c)) print_str += c;
+    else print_str += '?';
+  }
+  printf("%-*s [line %lli, col %lli] [%lli] [error %d]", padding, print_str.c_str(), h.line, h.column, h.start,
+    h.distance);
+  if(e.patterns_path) printf(" [pattern %s]", pattern_names[h.pattern].c_str());
+  printf("\n");
+}
+
+// A part of a mapped file that is scanned by a single thread.
+typedef struct chunk_t {
+  ll begin, end;              // the bytes of the chunk (see scan_part for the hits that belong to it)
+  ll newlines;                // the number of newlines in [begin, end)
+  ll last_nl;                 // the offset of the last newline in [begin, end)
+  std::vector<scan_hit> hits;
+} chunk;
+
+/**
+ * @brief Scans the chunk. The chunks split the runs of accepting positions at the same places as a scan of the
+ * whole file (see scan_part), so the hits do not depend on the number of threads.
+ */
+template <class S>
+void scan_chunk(const S& shared, const char* buf, ll len, chunk& ch){
+  S scanner = shared;         // every thread determinizes into its own cache
+  scan_part(scanner, buf, len, ch.begin, ch.end, [&](ll end, int d, int p){
+    ch.hits.push_back({scanner.match_start(buf, 0, end, d, p), end, d, p});
+  });
+
+  line_tracker lt{ch.begin, 0, -1};
+  lt.seek(buf, 0, ch.end);
+  ch.newlines = lt.lines;
+  ch.last_nl = lt.last_nl;
+}
+
+void resolve_chunk(const char* buf, line_tracker lt, std::vector<scan_hit>& hits){
+  for(scan_hit& h : hits) lt.resolve(buf, 0, h);
+}
+
+template <class S>
+void scan_file(env& e, const S& scanner, int fd, ll len){
+  const char* buf = (const char*) mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if(buf == MAP_FAILED){
+    fprintf(stderr, "ERROR: Could not map the file into memory.\n");
+    exit(1);
+  }
+  madvise((void*) buf, len, MADV_SEQUENTIAL);
+
+  ll chunk_size = std::max((ll) MIN_CHUNK, 4 * (ll) scanner.window());
+  ll n = std::max(1ll, std::min((ll) e.threads, len / chunk_size));
+  std::vector<chunk> chunks(n);
+  for(ll i = 0; i < n; ++i){
+    chunks[i].begin = len / n * i;
+    chunks[i].end = i + 1 == n ? len : len / n * (i + 1);
+  }
+  std::vector<std::thread> workers;
+  for(ll i = 0; i < n; ++i) workers.push_back(std::thread(scan_chunk<S>, std::cref(scanner), buf, len, std::ref(chunks[i])));
+  for(auto& t : workers) t.join();
+  workers.clear();
+
+  // Give every hit to the chunk that its start is in, and turn offsets into [line, col] pairs (in parallel).
+  std::vector<scan_hit> hits;
+  for(auto& ch : chunks) hits.insert(hits.end(), ch.hits.begin(), ch.hits.end());
+  std::sort(hits.begin(), hits.end());
+  std::vector<std::vector<scan_hit> > parts(n);
+  ll i = 0;
+  for(scan_hit& h : hits){
+    while(h.start >= chunks[i].end && i + 1 < n) ++i;
+    parts[i].push_back(h);
+  }
+  line_tracker lt{0, 0, -1};
+  for(ll i = 0; i < n; ++i){
+    workers.push_back(std::thread(resolve_chunk, buf, lt, std::ref(parts[i])));
+    lt = {chunks[i].end, lt.lines + chunks[i].newlines, chunks[i].newlines ? chunks[i].last_nl : lt.last_nl};
+  }
+  for(auto& t : workers) t.join();
+
+  for(auto& part : parts){
+    for(scan_hit& h : part) print_hit(e, buf, 0, h);
+  }
+  dprintf("Scanned %lli bytes in %lli chunks, %zu hits\n", len, n, hits.size());
+  munmap((void*) buf, len);
+}
+
+/**
+ * @brief Scans a stream (eg. stdin) block by block, keeping the bytes that a future hit can still start at.
+ * Hits are printed once no future hit can start before them.
+ */
+template <class S>
+void scan_stream(env& e, S& scanner, FILE* fs){
+  ll w = scanner.window();
+  std::vector<char> buf;
+  ll buf_offset = 0;          // buf[0] is at this offset
+  typename S::cursor_t c = scanner.begin();
+  line_tracker lt{0, 0, -1};
+  std::vector<scan_hit> pending;
+  ll total = 0;
+  while(true){
+    size_t old = buf.size();
+    buf.resize(old + BLOCK_SIZE);
+    size_t n = fread(buf.data() + old, 1, BLOCK_SIZE, fs);
+    buf.resize(old + n);
+    total += n;
+
+    auto emit = [&](ll end, int d, int p){
+      pending.push_back({scanner.match_start(buf.data(), buf_offset, end, d, p), end, d, p});
+    };
+    ll to = buf_offset + buf.size();
+    scanner.feed(c, buf.data(), buf_offset, buf_offset + old, to, emit);
+    if(n == 0) scanner.finish(c, emit);
+
+    // A hit that has not been emitted yet ends after the start of the current run (or the end of the input).
+    ll open = scanner.run_start(c);
+    ll bound = n == 0 ? LLONG_MAX : (open >= 0 ? open : to) - w + 1;
+    std::sort(pending.begin(), pending.end());
+    size_t done = 0;
+    while(done < pending.size() && pending[done].start < bound){
+      lt.resolve(buf.data(), buf_offset, pending[done]);
+      print_hit(e, buf.data(), buf_offset, pending[done]);
+      ++done;
+    }
+    pending.erase(pending.begin(), pending.begin() + done);
+    if(n == 0) break;
+
+    ll keep = std::max(buf_offset, bound);
+    lt.seek(buf.data(), buf_offset, keep);
+    buf.erase(buf.begin(), buf.begin() + (keep - buf_offset));
+    buf_offset = keep;
+  }
+  dprintf("Scanned %lli bytes from a stream\n", total);
+}
+
+template <class S>
+void run_scan(env& e, S& scanner){
+  df_tmp(milliseconds);
+  std::chrono::milliseconds execution_time;
+  if(e.file_path == NULL || !strcmp(e.file_path, "-")){
+    execution_time = time(milliseconds, scan_stream(e, scanner, stdin));
+  }else{
+    int fd = open(e.file_path, O_RDONLY);
+    struct stat s;
+    if(fd < 0 || fstat(fd, &s) < 0 || !S_ISREG(s.st_mode)){
+      fprintf(stderr, "ERROR: File error! Check if the file exists and if reads are allowed.\n");
+      exit(1);
+    }
+    if(s.st_size > 0){
+      execution_time = time(milliseconds, scan_file(e, scanner, fd, s.st_size));
+    }else{
+      execution_time = std::chrono::milliseconds(0);
+    }
+    close(fd);
+  }
+  dprintf("Scan execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+}
+
+// Exits unless the error of the pattern is at least 0 and smaller than the length of the pattern (otherwise the empty
+// string, and so every position of the text, would match).
+void check_error(const std::string& pattern, int error){
+  if(error < 0){
+    fprintf(stderr, "ERROR: The error of the pattern %s must not be negative.\n", pattern.c_str());
+    exit(1);
+  }
+  if((size_t) error >= pattern.size()){
+    fprintf(stderr, "ERROR: The error of the pattern %s must be smaller than its length (%zu).\n", pattern.c_str(),
+      pattern.size());
+    exit(1);
+  }
+}
+
+// Reads the patterns file: one pattern per line, optionally followed by a tab and the error of that pattern.
+void read_patterns(env& e, std::vector<std::string>& patterns, std::vector<int>& errors){
+  std::ifstream ifs(e.patterns_path);
+  if(!ifs){
+    fprintf(stderr, "ERROR: File error! Check if the patterns file exists and if reads are allowed.\n");
+    exit(1);
+  }
+  std::string line;
+  while(std::getline(ifs, line)){
+    if(line.size() && line.back() == '\r') line.pop_back();
+    size_t tab = line.rfind('\t');
+    int error = e.error;
+    if(tab != std::string::npos){
+      error = atoi(line.c_str() + tab + 1);
+      line.erase(tab);
+    }
+    if(line.empty()) continue;
+    check_error(line, error);
+    patterns.push_back(line);
+    errors.push_back(error);
+  }
+}
+
+void begin_scan(env& e){
+  df_tmp(milliseconds);
+  if(e.patterns_path){
+    std::vector<int> errors;
+    read_patterns(e, pattern_names, errors);
+    if(pattern_names.empty()){
+      fprintf(stderr, "ERROR: The patterns file is empty.\n");
+      exit(1);
+    }
+    multi_levenshtein_scanner* scanner;
+    auto compile_time = time(milliseconds, scanner = new multi_levenshtein_scanner(pattern_names, errors));
+    padding = scanner->window() + 5;
+    dprintf("READ: %zu patterns from %s\n", pattern_names.size(), e.patterns_path);
+    dprintf("Scanner NFA compiled in %llu ms\n", FORCE(unsigned long long, compile_time));
+    run_scan(e, *scanner);
+    delete scanner;
+  }else{
+    check_error(e.pattern, e.error);
+    pattern_names.push_back(e.pattern);
+    single_scanner* scanner;
+    auto compile_time = time(milliseconds, scanner = new single_scanner(e.pattern, e.error));
+    padding = scanner->window() + 5;
+    dprintf("READ: %s, %d\n", e.pattern, e.error);
+    dprintf("Scanner DFA size: %zu states (compiled in %llu ms)\n", scanner->size(),
+      FORCE(unsigned long long, compile_time));
+    run_scan(e, *scanner);
+    delete scanner;
+  }
+}
+
+void debug_switch(env& _env_, int& flag_pos, char* argv[]){
+  _env_.debug = true;
+}
+
+int nargs;
+void change_error(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "The error must be specified after the -e or --error flag!\n");
+    exit(1);
+  }
+  _env_.error = atoi(argv[++flag_pos]);
+}
+
+void change_threads(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "The number of threads must be specified after the -t or --threads flag!\n");
+    exit(1);
+  }
+  _env_.threads = atoi(argv[++flag_pos]);
+}
+
+void patterns_file(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "A file must be specified after the -p or --patterns flag!\n");
+    exit(1);
+  }
+  _env_.patterns_path = argv[++flag_pos];
+}
+
+void help(env& _env_, int& flag_pos, char* argv[]){
+  printf(
+    "usage: fuzzy_grep [-d | --debug] [-e | --error N] [-t | --threads N]\n"\
+    "                  [-h | --help] PATTERN [FILE_NAME]\n"\
+    "       fuzzy_grep [-p | --patterns FILE] [options] [FILE_NAME]\n\n"\
+    "Scans the given file (or stdin if no file name or `-` is provided) for the\n"\
+    "pattern with the given levenschtein error, without building an index. Each\n"\
+    "hit is printed with its line/column, its byte offset and its error.\n\n"\
+    "  d : print debug information [for developer use only]\n"\
+    "  e : the levenschtein error (0 by default, smaller than the pattern length)\n"\
+    "  t : the number of threads used to scan a file (one per core by default)\n"\
+    "  p : scan for every pattern in the file at once (one pattern per line,\n"\
+    "      optionally followed by a tab and the error of that pattern); each\n"\
+    "      hit also prints the pattern that matched\n"\
+    "  h : print this help message\n"
+    );
+  exit(0);
+}
+
+int main(int argc, char* argv[]){
+  env main_env{};
+  nargs = argc;
+  std::unordered_map<std::string, std::function<void(env&,int&,char**)> > commands;
+  commands["-d"] = debug_switch;
+  commands["--debug"] = debug_switch;
+  commands["-e"] = change_error;
+  commands["--error"] = change_error;
+  commands["-t"] = change_threads;
+  commands["--threads"] = change_threads;
+  commands["-p"] = patterns_file;
+  commands["--patterns"] = patterns_file;
+  commands["-h"] = help;
+  commands["--help"] = help;
+  std::vector<char*> positional;
+  int st = 1;
+  while(st < argc){
+    if(commands.count(argv[st])){ // if the flag is found
+      commands[argv[st]](main_env,st,argv);
+    }else{
+      positional.push_back(argv[st]);
+    }
+    ++st;
+  }
+  size_t pos = 0;
+  if(main_env.patterns_path == NULL && pos < positional.size()) main_env.pattern = positional[pos++];
+  if(pos < positional.size()) main_env.file_path = positional[pos++]; // the filepath
+  if(pos < positional.size()){
+    fprintf(stderr, "ERROR: Invalid # of position arguments provided. Use \"--help\""\
+      " to display correct usage.\n");
+    exit(1);
+  }
+  if(main_env.patterns_path == NULL && (main_env.pattern == NULL || strlen(main_env.pattern) == 0)){
+    fprintf(stderr, "ERROR: A pattern must be provided. Use \"--help\" to display correct usage.\n");
+    exit(1);
+  }
+  if(main_env.threads <= 0) main_env.threads = std::max(1u, std::thread::hardware_concurrency());
+
+  begin_scan(main_env);
+}
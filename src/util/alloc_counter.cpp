@@ -0,0 +1,16 @@
+#include "../data_structures/FA/arena.hpp"
+#include <new>
+#include <cstdlib>
+
+// Replaces the global operator new/delete of the program to count every heap allocation of a thread in
+// `alloc_stats().heap_calls` (the search tools report the allocations of a query with -d).
+void* operator new(std::size_t n){
+    alloc_stats().heap_calls++;
+    void* p = std::malloc(n ? n : 1);
+    if(p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
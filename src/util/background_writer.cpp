@@ -0,0 +1,133 @@
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <algorithm>
+#include <stdio.h>
+
+// Cache files are written whole: the bytes go to `PATH.tmp`, which is then renamed to PATH, so a reader (or the next
+// run after a crash) sees either the old file or the new one, never a part of it.
+
+#define SAVE_BLOCK      (1 << 22)      // the bytes of a single fwrite
+
+// Writes the bytes to `path.tmp` and renames it to path. Returns false (and leaves path as it was) on an error.
+bool write_then_rename(const std::string& path, const std::string& bytes){
+  std::string tmp = path + ".tmp";
+  FILE* fs = fopen(tmp.c_str(), "wb");
+  if(fs == NULL) return false;
+  bool ok = true;
+  for(size_t i = 0; ok && i < bytes.size(); i += SAVE_BLOCK){
+    size_t n = std::min((size_t) SAVE_BLOCK, bytes.size() - i);
+    ok = fwrite(bytes.data() + i, 1, n, fs) == n;
+  }
+  ok = fclose(fs) == 0 && ok;
+  if(ok) ok = rename(tmp.c_str(), path.c_str()) == 0;
+  if(!ok) remove(tmp.c_str());
+  return ok;
+}
+
+/**
+ * @brief Writes files on a background thread, so the caller does not wait for the disk. A save hands over the bytes
+ * of the whole file (the index is encoded in memory first, so it may change as soon as `save` returns), and the
+ * files are written with `write_then_rename` in the order they were saved. The destructor waits for every save.
+ */
+class background_writer {
+private:
+  typedef struct _save_t_ {
+    std::string path;
+    std::string bytes;
+    bool erase;           // remove the file instead
+  } save_t;
+
+  std::deque<save_t> queue;
+  bool busy{false}, stop{false};
+  size_t failed{0};
+  std::mutex lock;
+  std::condition_variable wake, idle;
+  std::thread worker;
+
+  void run(){
+    std::unique_lock<std::mutex> guard(lock);
+    while(true){
+      wake.wait(guard, [this](){ return stop || queue.size(); });
+      if(queue.empty()) return; // stopped, and nothing is left
+      save_t file = std::move(queue.front());
+      queue.pop_front();
+      busy = true;
+      guard.unlock();
+      bool ok = file.erase ? (remove(file.path.c_str()), true) : write_then_rename(file.path, file.bytes);
+      if(!ok) fprintf(stderr, "ERROR: Could not save '%s'!\n", file.path.c_str());
+      guard.lock();
+      busy = false;
+      if(!ok) ++failed;
+      if(queue.empty()) idle.notify_all();
+    }
+  }
+public:
+  background_writer() : worker(&background_writer::run, this) {}
+
+  background_writer(const background_writer&) = delete;
+  background_writer& operator=(const background_writer&) = delete;
+
+  ~background_writer(){
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stop = true;
+    }
+    wake.notify_one();
+    worker.join();
+  }
+
+  /**
+   * @brief Queues the file (the bytes are moved, not copied).
+   *
+   * @param path the path of the file.
+   * @param bytes the contents of the file.
+   */
+  void save(const std::string& path, std::string&& bytes){
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      queue.push_back({path, std::move(bytes), false});
+    }
+    wake.notify_one();
+  }
+
+  /**
+   * @brief Queues the removal of the file (after the saves that are already queued, which may write it).
+   *
+   * @param path the path of the file.
+   */
+  void erase(const std::string& path){
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      queue.push_back({path, std::string(), true});
+    }
+    wake.notify_one();
+  }
+
+  /**
+   * @brief Waits until every queued file is written.
+   */
+  void wait(){
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this](){ return queue.empty() && !busy; });
+  }
+
+  /**
+   * @brief The number of files that are queued or being written.
+   */
+  size_t pending(){
+    std::lock_guard<std::mutex> guard(lock);
+    return queue.size() + (busy ? 1 : 0);
+  }
+
+  /**
+   * @brief The number of files that could not be written.
+   */
+  size_t failures(){
+    std::lock_guard<std::mutex> guard(lock);
+    return failed;
+  }
+};
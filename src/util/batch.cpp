@@ -0,0 +1,278 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Batch mode: queries are read one per line, either as TSV (`QUERY` or `QUERY<TAB>N`) or as JSONL
+// (`{"query": "QUERY", "error": N}`), and each query is answered with one JSON line.
+
+#define BATCH_BLOCK     4096       // the number of queries that are answered (in parallel) before they are written
+#define WRITER_SIZE     (1 << 22)
+
+typedef struct batch_query_t {
+  std::string query;
+  int error{0};
+  ll line{0};                 // the line number of the query in the input
+  std::string message;        // why the line could not be parsed (empty if it was parsed)
+  std::string index;          // the index the query asks for (empty for the default)
+  size_t limit{0};            // the number of results the query asks for (0: every result)
+} batch_query;
+
+// Appends the string as a JSON string. Bytes that are not part of a valid UTF-8 sequence are written as \u00XX.
+void json_string(std::string& out, const std::string& s){
+  static const char* hex = "0123456789abcdef";
+  out += '"';
+  for(size_t i = 0; i < s.size(); ++i){
+    unsigned char c = s[i];
+    if(c == '"' || c == '\\'){ out += '\\'; out += c; }
+    else if(c == '\n') out += "\\n";
+    else if(c == '\r') out += "\\r";
+    else if(c == '\t') out += "\\t";
+    else if(c < 0x20 || c == 0x7f){ out += "\\u00"; out += hex[c >> 4]; out += hex[c & 15]; }
+    else if(c < 0x80) out += c;
+    else{
+      size_t n = c >= 0xf0 && c < 0xf5 ? 4 : c >= 0xe0 ? 3 : c >= 0xc2 && c < 0xe0 ? 2 : 0;
+      bool valid = n && n <= 4 && i + n <= s.size();
+      for(size_t j = 1; valid && j < n; ++j) valid = ((unsigned char) s[i + j] & 0xc0) == 0x80;
+      if(valid){
+        out.append(s, i, n);
+        i += n - 1;
+      }else{
+        out += "\\u00"; out += hex[c >> 4]; out += hex[c & 15];
+      }
+    }
+  }
+  out += '"';
+}
+
+// Appends the code point as UTF-8.
+static void utf8_append(std::string& out, unsigned cp){
+  if(cp < 0x80) out += (char) cp;
+  else if(cp < 0x800){ out += (char) (0xc0 | (cp >> 6)); out += (char) (0x80 | (cp & 0x3f)); }
+  else if(cp < 0x10000){
+    out += (char) (0xe0 | (cp >> 12)); out += (char) (0x80 | ((cp >> 6) & 0x3f)); out += (char) (0x80 | (cp & 0x3f));
+  }else{
+    out += (char) (0xf0 | (cp >> 18)); out += (char) (0x80 | ((cp >> 12) & 0x3f));
+    out += (char) (0x80 | ((cp >> 6) & 0x3f)); out += (char) (0x80 | (cp & 0x3f));
+  }
+}
+
+// Parses a JSON string starting at s[i] (the opening quote). Returns false if the string is malformed.
+static bool parse_json_string(const std::string& s, size_t& i, std::string& out){
+  if(i >= s.size() || s[i] != '"') return false;
+  for(++i; i < s.size(); ++i){
+    char c = s[i];
+    if(c == '"'){ ++i; return true; }
+    if(c != '\\'){ out += c; continue; }
+    if(++i >= s.size()) return false;
+    switch(s[i]){
+      case '"': case '\\': case '/': out += s[i]; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        if(i + 4 >= s.size()) return false;
+        unsigned cp = strtoul(s.substr(i + 1, 4).c_str(), NULL, 16);
+        i += 4;
+        if(cp >= 0xd800 && cp < 0xdc00 && i + 6 < s.size() && s[i + 1] == '\\' && s[i + 2] == 'u'){ // a surrogate pair
+          unsigned lo = strtoul(s.substr(i + 3, 4).c_str(), NULL, 16);
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+          i += 6;
+        }
+        utf8_append(out, cp);
+        break;
+      }
+      default: return false;
+    }
+  }
+  return false;
+}
+
+static void skip_ws(const std::string& s, size_t& i){
+  while(i < s.size() && isspace((unsigned char) s[i])) ++i;
+}
+
+// Parses a JSONL query: an object with a "query" string, an (optional) "error" number, an (optional) "limit" number
+// and an (optional) "index" string. Other keys must have scalar values and are ignored.
+static bool parse_json_query(const std::string& s, batch_query& q){
+  size_t i = 0;
+  bool has_query = false;
+  skip_ws(s, i);
+  if(i >= s.size() || s[i++] != '{'){ q.message = "expected a JSON object"; return false; }
+  skip_ws(s, i);
+  if(i < s.size() && s[i] == '}') ++i;
+  else while(true){
+    std::string key;
+    skip_ws(s, i);
+    if(!parse_json_string(s, i, key)){ q.message = "expected a key"; return false; }
+    skip_ws(s, i);
+    if(i >= s.size() || s[i++] != ':'){ q.message = "expected a ':'"; return false; }
+    skip_ws(s, i);
+    if(i < s.size() && s[i] == '"'){
+      std::string val;
+      if(!parse_json_string(s, i, val)){ q.message = "malformed string"; return false; }
+      if(key == "query"){ q.query = val; has_query = true; }
+      else if(key == "index") q.index = val;
+    }else{
+      size_t st = i;
+      while(i < s.size() && s[i] != ',' && s[i] != '}' && !isspace((unsigned char) s[i])) ++i;
+      std::string val = s.substr(st, i - st);
+      if(val.empty() || val[0] == '{' || val[0] == '['){ q.message = "values must be strings or numbers"; return false; }
+      if(key == "error"){
+        char* end;
+        q.error = strtol(val.c_str(), &end, 10);
+        if(*end != '\0'){ q.message = "the error must be an integer"; return false; }
+      }else if(key == "limit"){
+        char* end;
+        long long limit = strtoll(val.c_str(), &end, 10);
+        if(*end != '\0' || limit < 0){ q.message = "the limit must be a non-negative integer"; return false; }
+        q.limit = limit;
+      }
+    }
+    skip_ws(s, i);
+    if(i < s.size() && s[i] == ','){ ++i; continue; }
+    if(i < s.size() && s[i] == '}'){ ++i; break; }
+    q.message = "expected a ',' or a '}'";
+    return false;
+  }
+  if(!has_query){ q.message = "missing \"query\""; return false; }
+  return true;
+}
+
+/**
+ * @brief Parses a line of batch input (a JSONL object if it starts with a '{', otherwise `QUERY` or
+ * `QUERY<TAB>N`). On failure, `q.message` says why.
+ *
+ * @param line the line (without the newline).
+ * @param q the parsed query.
+ * @return true if the line was parsed.
+ */
+bool parse_query(const std::string& line, batch_query& q){
+  size_t i = 0;
+  skip_ws(line, i);
+  if(i < line.size() && line[i] == '{'){
+    if(!parse_json_query(line, q)) return false;
+  }else{
+    size_t tab = line.rfind('\t');
+    q.query = line.substr(0, tab);
+    if(tab != std::string::npos){
+      char* end;
+      q.error = strtol(line.c_str() + tab + 1, &end, 10);
+      while(isspace((unsigned char) *end)) ++end;
+      if(*end != '\0' || end == line.c_str() + tab + 1){ q.message = "the error must be an integer"; return false; }
+    }
+  }
+  if(q.error < 0){ q.message = "the error must not be negative"; return false; }
+  return true;
+}
+
+// Appends the start of a result line (the query and its error).
+void json_query(std::string& out, const batch_query& q){
+  out += "{\"query\":";
+  json_string(out, q.query);
+  out += ",\"error\":" + std::to_string(q.error);
+}
+
+/**
+ * @brief Writes to a file through a large buffer, so that results are written in a few large writes rather than
+ * a character at a time.
+ */
+class buffered_writer {
+private:
+  FILE* fs;
+  std::vector<char> buf;
+  size_t used{0};
+public:
+  explicit buffered_writer(FILE* fs, size_t size = WRITER_SIZE) : fs(fs), buf(size) {}
+
+  buffered_writer(const buffered_writer&) = delete;
+  buffered_writer& operator=(const buffered_writer&) = delete;
+
+  ~buffered_writer(){
+    this->flush();
+  }
+
+  void write(const char* s, size_t n){
+    if(used + n > buf.size()){
+      this->flush();
+      if(n > buf.size()){ fwrite(s, 1, n, fs); return; }
+    }
+    memcpy(buf.data() + used, s, n);
+    used += n;
+  }
+
+  void write(const std::string& s){
+    this->write(s.data(), s.size());
+  }
+
+  void flush(){
+    if(used) fwrite(buf.data(), 1, used, fs);
+    used = 0;
+    fflush(fs);
+  }
+};
+
+/**
+ * @brief Reads the queries from the file and writes one JSON line per query, in input order. Queries are answered
+ * BATCH_BLOCK at a time, by `threads` threads. Lines that cannot be parsed are answered with
+ * `{"line": N, "message": "..."}`.
+ *
+ * @tparam F a callable (const batch_query&, std::string&) that appends the JSON line of a query.
+ * @param in the input file.
+ * @param out the writer.
+ * @param threads the number of threads.
+ * @param answer the query callback (called concurrently).
+ * @return ll the number of queries answered.
+ */
+template <class F>
+ll run_batch(FILE* in, buffered_writer& out, int threads, F answer){
+  char* line = NULL;
+  size_t len = 0;
+  ssize_t read;
+  ll line_number = 0, answered = 0;
+  bool done = false;
+  while(!done){
+    std::vector<batch_query> queries;
+    while(queries.size() < BATCH_BLOCK){
+      if((read = getline(&line, &len, in)) == -1){ done = true; break; }
+      ++line_number;
+      std::string s(line, read);
+      while(s.size() && (s.back() == '\n' || s.back() == '\r')) s.pop_back();
+      if(s.empty()) continue;
+      batch_query q;
+      q.line = line_number;
+      parse_query(s, q);
+      queries.push_back(q);
+    }
+
+    std::vector<std::string> results(queries.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&](){
+      for(size_t i = next++; i < queries.size(); i = next++){
+        if(queries[i].message.empty()){
+          answer(queries[i], results[i]);
+        }else{
+          results[i] = "{\"line\":" + std::to_string(queries[i].line) + ",\"message\":";
+          json_string(results[i], queries[i].message);
+          results[i] += "}\n";
+        }
+      }
+    };
+    std::vector<std::thread> workers;
+    for(int t = 1; t < threads && (size_t) t < queries.size(); ++t) workers.push_back(std::thread(worker));
+    worker();
+    for(auto& t : workers) t.join();
+
+    for(std::string& r : results) out.write(r);
+    answered += queries.size();
+  }
+  free(line);
+  out.flush();
+  return answered;
+}
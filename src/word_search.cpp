@@ -2,15 +2,33 @@
 #include "data_structures/FA/NFA.hpp"
 #include "data_structures/FA/DFA.hpp"
 #include "data_structures/trie.hpp"
+#include "data_structures/dawg.hpp"
+#include "data_structures/typeahead.hpp"
+#include "data_structures/deletion_index.hpp"
+#include "data_structures/louds_trie.hpp"
+#include "data_structures/radix_trie.hpp"
+#include "data_structures/query_planner.hpp"
+#include "data_structures/neighbourhood.hpp"
+#include "data_structures/shards.hpp"
+#include "data_structures/FA/lazy_DFA.hpp"
+#include "data_structures/FA/match_iterator.hpp"
 #include "data_structures/FA/encoding_util.hpp"
+#include "data_structures/FA/alphabet_map.hpp"
 #include "util/trim.cpp"
+#include "util/batch.cpp"
+#include "util/background_writer.cpp"
+#include "util/alloc_counter.cpp"
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <set>
+#include <memory>
+#include <thread>
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 #include <algorithm> 
 #include <cctype>
@@ -32,6 +50,8 @@
 #define FORCE(typ, v)   (*((typ*) &(v)))
 #define MAX_WORD        25
 #define MAX_STRING      256
+#define FLUSH_INTERVAL  64
+#define TYPEAHEAD_LIMIT 10
 
 // Overloading hash for vector:
 namespace std{
@@ -53,107 +73,796 @@ typedef struct env_t {
   char* file_path{NULL};
   bool debug{false};
   bool save_trie{false};
+  bool use_arena{false};      // bump-allocate the automata of each query
   bool cli{true};
+  char* batch_path{NULL};     // answer the queries in this file (`-` for stdin) as JSON lines
+  int  threads{0};            // the number of threads used in batch mode (0: one per core)
+  bool use_deletion_index{false}; // load (or build) the symmetric delete index, for `@WORD N` queries
+  int  shards{1};             // the number of shards the dictionary is split into (by the hash of the words)
+  bool use_louds{false};      // answer the queries with a (read-only) LOUDS trie instead of the DAWG
+  bool use_radix{false};      // answer the queries with a (read-only) radix trie instead of the DAWG
+  size_t lazy_budget{0};      // answer the queries from a normalized file through a cache of this many bytes (0: off)
+  bool utf8{false};           // count the errors in UTF-8 code points instead of bytes
 } env;
 
-void computation(env& e, DFA<ll, char>& compressed_dict, std::unordered_set<char>& alphabet, char* word, int& error){
+// A shard of the dictionary (the whole dictionary if it is not sharded): the words whose hash is the index of the
+// shard (modulo the number of shards). Every shard is built, cached and updated on its own.
+typedef struct shard_t {
+  std::string trie_path;
+  dawg dict;
+  alphabet_map amap;
+  bool has_index{false};      // whether the deletion index is in use
+  deletion_index index;
+  int dirty{0};               // the number of updates that have not been saved
+  std::unique_ptr<typeahead_session<ll> > session; // the typeahead session (reset when the dictionary changes)
+  bool has_louds{false};      // whether the queries are answered by the LOUDS trie (the DAWG is then empty)
+  louds_trie louds;
+  std::unique_ptr<typeahead_session<ll, louds_trie> > louds_session;
+  bool has_radix{false};      // whether the queries are answered by the radix trie (the DAWG is then empty)
+  radix_trie radix;
+  std::unique_ptr<typeahead_session<ll, radix_trie> > radix_session;
+  std::unique_ptr<lazy_DFA<char> > lazy; // the DAWG on disk (the DAWG is then empty)
+  std::unique_ptr<typeahead_session<ll, lazy_DFA<char> > > lazy_session;
+  index_stats stats;          // the shape of the dictionary, for the query planner (none for a lazy DFA)
+
+  const deletion_index* get_index() const {
+    return this->has_index ? &this->index : NULL;
+  }
+
+  // Is the dictionary read-only (a LOUDS trie, a radix trie or a lazy DFA)?
+  bool read_only() const {
+    return this->has_louds || this->has_radix || this->lazy;
+  }
+
+  // The read-only form of the dictionary, and its flag.
+  const char* read_only_name() const {
+    return this->has_louds ? "LOUDS trie (-l)" : this->has_radix ? "radix trie (-r)" : "lazy DFA (-z)";
+  }
+
+  bool contains(const std::string& w){
+    if(this->lazy) return this->lazy->contains(w);
+    return this->has_louds ? this->louds.contains(w) : this->has_radix ? this->radix.contains(w) : this->dict.contains(w);
+  }
+} shard;
+
+// Runs f(i) for every shard i: on a thread per shard in the CLI, and in order in batch mode (the queries are already
+// answered in parallel) or when the debug output of the shards must not interleave.
+template <class F>
+void scatter(env& e, std::vector<shard>& shards, F f){
+  if(shards.size() == 1 || e.debug || !e.cli){
+    for(size_t i = 0; i < shards.size(); ++i) f(i);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for(size_t i = 0; i < shards.size(); ++i) workers.push_back(std::thread(f, i));
+  for(std::thread& w : workers) w.join();
+}
+
+void print_words(const std::vector<std::string>& words){
+  printf("(");
+  for(size_t i = 0; i < words.size(); ++i){
+    printf(i ? ", %s" : "%s", words[i].c_str());
+  }
+  printf(")\n");
+}
+
+// The Levenshtein DFA of the word over the symbols of the alphabet (its errors counted in code points with -u).
+DFA<ll, char> levenshtein_dfa(env& e, const alphabet_map& amap, const std::string& word, int error){
+  if(e.utf8) return utf8_levenshtein_nfa(word, error, amap).convert_to_compressed_dfa();
+  return levenshtein_nfa(amap.encode(word), error).convert_to_compressed_dfa();
+}
+
+// The allocations of a query (the difference of the counters taken before and after it).
+void print_allocations(env& e, const alloc_stats_t& before, const alloc_stats_t& after){
+  dprintf("Allocations [%s]: %zu heap (%zu by the automata), %zu arena (%zu bytes in %zu blocks)\n",
+    e.use_arena ? "arena" : "heap", after.heap_calls - before.heap_calls,
+    after.heap_allocations - before.heap_allocations, after.arena_allocations - before.arena_allocations,
+    after.arena_bytes - before.arena_bytes, after.arena_blocks - before.arena_blocks);
+}
+
+// The (decoded) words of the dictionary within the error of the word (at most `limit` of them if it is not 0), by
+// walking the dictionary together with the Levenshtein automaton of the word (see match_iterator.hpp).
+std::vector<std::string> automaton_matches(env& e, DFA<ll, char>& compressed_dict, alphabet_map& amap,
+  const std::string& word, int error, size_t limit = 0){
+  arena query_arena;
+  arena_scope scope(e.use_arena ? &query_arena : NULL);
+  alloc_stats_t before = alloc_stats();
+
+  DFA<ll, char> lnfa = levenshtein_dfa(e, amap, word, error);
+  std::vector<std::string> ret;
+  std::chrono::microseconds start = get_time(microseconds), first{0};
+  match_iterator<DFA<ll, char> > matches(compressed_dict, lnfa, limit);
+  std::string match;
+  ll state;
+  while(matches.next(match, state)){
+    if(matches.count() == 1) first = get_time(microseconds) - start;
+    ret.push_back(amap.decode(match));
+  }
+  std::chrono::microseconds execution_time = get_time(microseconds) - start;
+  alloc_stats_t after = alloc_stats();
+  dprintf("Levenschtein DFA size: %lu states\n", lnfa.states().size());
+  dprintf("Match iterator [dict ^ lnfa]: %lu results, %lu states visited\n", matches.count(),
+    matches.states_visited());
+  dprintf("Match iterator first result: %llu us, execution time: %llu us\n", FORCE(unsigned long long, first),
+    FORCE(unsigned long long, execution_time));
+  print_allocations(e, before, after);
+  ifd { // the intersection (which the iterator does not build), for comparison
+    DFA<ll, char> intersection;
+    df_tmp(milliseconds);
+    auto intersection_time = time(milliseconds, intersection = compressed_dict.intersection(lnfa).compress_dfa());
+    dprintf("Intersection [dict ^ lnfa] DFA size: %lu states\n", intersection.states().size());
+    dprintf("Intersection [dict ^ lnfa] DFA execution time: %llu ms\n", FORCE(unsigned long long, intersection_time));
+  }
+  return ret;
+}
+
+// The (encoded) words of a read-only shard that the automaton accepts (the radix trie stops after `limit` of them if
+// it is not 0).
+std::vector<std::string> read_only_search(shard& sh, DFA<ll, char>& lnfa, size_t* followed = NULL, size_t limit = 0){
+  if(sh.lazy) return sh.lazy->search(lnfa);
+  return sh.has_louds ? sh.louds.search(lnfa) : sh.radix.search(lnfa, followed, limit);
+}
+
+// The (decoded) words of the shard within the error of the word, by the automaton (on its read-only trie if it has
+// one), at most `limit` of them if it is not 0.
+std::vector<std::string> automaton_shard_matches(env& e, shard& sh, const std::string& word, int error,
+  size_t limit = 0){
+  if(!sh.read_only()) return automaton_matches(e, sh.dict, sh.amap, word, error, limit);
+  arena query_arena;
+  arena_scope scope(e.use_arena ? &query_arena : NULL);
+  DFA<ll, char> lnfa = levenshtein_dfa(e, sh.amap, word, error);
+  std::vector<std::string> ret;
+  size_t followed = 0;
+  df_tmp(milliseconds);
+  auto execution_time = time(milliseconds, ret = read_only_search(sh, lnfa, &followed, limit));
+  if(sh.has_louds){
+    dprintf("LOUDS trie [%lu nodes] search time: %llu ms\n", sh.louds.size(), FORCE(unsigned long long, execution_time));
+  }else if(sh.lazy){
+    std::pair<size_t, size_t> stats = sh.lazy->cache_stats();
+    dprintf("Lazy DFA search time: %llu ms\n", FORCE(unsigned long long, execution_time));
+    dprintf("Lazy DFA cache: %lu states, %lu bytes (%lu hits, %lu reads so far)\n", sh.lazy->cached(),
+      sh.lazy->memory(), stats.first, stats.second);
+  }else{
+    dprintf("Radix trie [%lu nodes] search time: %llu ms (%lu edges followed)\n", sh.radix.size(),
+      FORCE(unsigned long long, execution_time), followed);
+  }
+  if(limit && ret.size() > limit) ret.resize(limit);
+  for(std::string& w : ret) w = sh.amap.decode(w);
+  return ret;
+}
+
+// Looks the word up in the deletion index, returns the (decoded) words within the error that are still in the
+// dictionary. Returns false if the index cannot answer the query (in which case the automaton must), which includes
+// every query whose errors are counted in code points.
+bool index_lookup(env& e, shard& sh, const std::string& word, int error, std::set<std::string>& results,
+  size_t* candidates = NULL){
+  const deletion_index* index = sh.get_index();
+  if(index == NULL || e.utf8 || error < 0 || (uint32_t) error > index->get_max_error()) return false;
+  for(const std::string& w : index->lookup(sh.amap.encode(word), error, candidates)){
+    if(sh.contains(w)) results.insert(sh.amap.decode(w));
+  }
+  return true;
+}
+
+plan_tally plans;   // the strategies the planner chose
+
+// Plans a query on the shard (see query_planner.hpp), and reports the plan in the debug output.
+query_plan plan_query(env& e, shard& sh, const std::string& word, int error){
+  query_planner planner(sh.stats);
+  if(e.utf8) planner.count_code_points();
+  if(sh.has_index){
+    planner.use_deletion_index(sh.index.get_max_error(), sh.index.get_prefix_length(), sh.index.bucket_size());
+  }
+  query_plan plan = planner.plan(word.size(), error);
+  plans.add(plan.strategy);
+  ifd {
+    std::string costs;
+    for(const std::pair<search_strategy, double>& c : plan.costs){
+      costs += (costs.size() ? ", " : "") + std::string(strategy_name(c.first)) + " " + std::to_string((ll) c.second);
+    }
+    dprintf("Query plan: %s (estimated costs: %s)\n", strategy_name(plan.strategy), costs.c_str());
+  }
+  return plan;
+}
+
+// The (decoded) words of the shard within the error of the word, at most `limit` of them if it is not 0, in the
+// order of the automaton (the order of the symbols) whichever strategy the planner chose.
+std::vector<std::string> planned_matches(env& e, shard& sh, const query_plan& plan, const std::string& word,
+  int error, size_t limit){
+  if(plan.strategy == search_strategy::automaton) return automaton_shard_matches(e, sh, word, error, limit);
+  std::vector<std::string> ret;
+  df_tmp(microseconds);
+  std::chrono::microseconds execution_time{0};
+  if(plan.strategy == search_strategy::exact){
+    bool found;
+    execution_time = time(microseconds, found = sh.contains(sh.amap.encode(word)));
+    if(found) ret.push_back(word);
+  }else if(plan.strategy == search_strategy::neighbourhood){
+    size_t looked_up = 0;
+    execution_time = time(microseconds, ret = neighbourhood_matches(sh.amap.encode(word), error, sh.amap.size(),
+      [&sh](const std::string& s){ return sh.contains(s); }, &looked_up));
+    dprintf("Neighbourhood: %lu strings looked up, %lu matches\n", looked_up, ret.size());
+    for(std::string& w : ret) w = sh.amap.decode(w);
+  }else{
+    std::set<std::string> results;
+    size_t candidates = 0;
+    execution_time = time(microseconds, index_lookup(e, sh, word, error, results, &candidates));
+    dprintf("Deletion index candidates: %lu words\n", candidates);
+    ret.assign(results.begin(), results.end());
+  }
+  dprintf("Planned [%s] execution time: %llu us\n", strategy_name(plan.strategy),
+    FORCE(unsigned long long, execution_time));
+  ifd { // the automaton, for comparison
+    env quiet = e;
+    quiet.debug = false;
+    execution_time = time(microseconds, automaton_shard_matches(quiet, sh, word, error, limit));
+    dprintf("Levenschtein DFA + search execution time: %llu us\n", FORCE(unsigned long long, execution_time));
+  }
+  if(limit && ret.size() > limit) ret.resize(limit);
+  return ret;
+}
+
+// The (decoded) words of the shard within the error of the word, at most `limit` of them if it is not 0, in byte
+// order.
+std::vector<std::string> shard_matches(env& e, shard& sh, const std::string& word, int error, size_t limit = 0){
+  query_plan plan = plan_query(e, sh, word, error);
+  return first_words(sh.amap, limit, [&](size_t n){ return planned_matches(e, sh, plan, word, error, n); });
+}
+
+// Searches every shard, and prints the words in byte order (the first `limit` of them if it is not 0).
+void computation(env& e, std::vector<shard>& shards, char* word, int& error, size_t limit = 0){
   dprintf("READ: %s, %d\n", word, error);
   if(strlen(word) == 0) {printf("()\n"); return;};
-
-  DFA<ll, char> lnfa = levenshtein_nfa(word, error).convert_to_dfa(alphabet).compress_dfa();
-  DFA<ll , char> intersection;
-  // time(milliseconds, DFA<ll CM char> intersection = compressed_dict.intersection(lnfa).compress_dfa())
+  std::vector<std::vector<std::string> > found(shards.size());
   df_tmp(milliseconds);
-  auto execution_time = time(milliseconds, intersection = compressed_dict.intersection(lnfa).compress_dfa());
-  dprintf("Levenschtein DFA size: %lu states\n", lnfa.states().size());
-  dprintf("Intersection [dict ^ lnfa] DFA size: %lu states\n", intersection.states().size());
-  dprintf("Intersection [dict ^ lnfa] DFA execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+  auto execution_time = time(milliseconds, scatter(e, shards, [&](size_t i){
+    found[i] = shard_matches(e, shards[i], word, error, limit);
+  }));
+  if(shards.size() > 1) dprintf("Scatter-gather over %lu shards: %llu ms\n", shards.size(),
+    FORCE(unsigned long long, execution_time));
+  print_words(merge_words(found, limit));
+}
+
+// Looks the word up in the deletion index of every shard. Returns false if an index cannot answer the query.
+bool index_lookup(env& e, std::vector<shard>& shards, const std::string& word, int error,
+  std::set<std::string>& results, size_t* candidates = NULL){
+  if(candidates) *candidates = 0;
+  for(shard& sh : shards){
+    size_t shard_candidates = 0;
+    if(!index_lookup(e, sh, word, error, results, &shard_candidates)) return false;
+    if(candidates) *candidates += shard_candidates;
+  }
+  return true;
+}
+
+// Answers a query with the deletion index (`@WORD N`), falling back to the automaton if the error is larger than
+// the index allows. The debug output compares the latency of the two.
+void index_computation(env& e, std::vector<shard>& shards, char* line){
+  char word[MAX_WORD + 1] = ""; int error = 0;
+  sscanf(line + 1, "%25s %d", word, &error);
+  dprintf("READ: %s, %d\n", word, error);
+  std::set<std::string> results;
+  size_t candidates = 0;
+  bool answered;
+  df_tmp(microseconds);
+  auto execution_time = time(microseconds, answered = index_lookup(e, shards, word, error, results, &candidates));
+  if(!answered){
+    if(!shards[0].has_index) printf("Error: The deletion index is not loaded (use -y)!\n");
+    else computation(e, shards, word, error);
+    return;
+  }
+  dprintf("Deletion index candidates: %lu words\n", candidates);
+  dprintf("Deletion index execution time: %llu us\n", FORCE(unsigned long long, execution_time));
   ifd {
-    DFA<ll, char> intersection2;
-    execution_time = time(milliseconds, intersection2 = lnfa.intersection(compressed_dict).compress_dfa());
-    dprintf("Intersection [lnfa ^ dict] DFA size: %lu states\n", intersection2.states().size());
-    dprintf("Intersection [lnfa ^ dict] DFA execution time: %llu ms\n", FORCE(unsigned long long, execution_time));
+    DFA<ll, char> lnfa; // the automaton path, for comparison (including building the automaton)
+    execution_time = time(microseconds, scatter(e, shards, [&](size_t i){
+      lnfa = levenshtein_dfa(e, shards[i].amap, word, error);
+      if(shards[i].read_only()){
+        read_only_search(shards[i], lnfa);
+      }else{
+        match_iterator<DFA<ll, char> > matches(shards[i].dict, lnfa);
+        std::string match; ll state;
+        while(matches.next(match, state));
+      }
+    }));
+    dprintf("Levenschtein DFA + search execution time: %llu us\n", FORCE(unsigned long long, execution_time));
   }
-  // std::cout << intersection;
-  bool first = true;
+  print_words(std::vector<std::string>(results.begin(), results.end()));
+}
+
+// Answers a batch query with a JSON line: {"query": ..., "error": N, "results": [...]}
+void batch_computation(env& e, std::vector<shard>& shards, const batch_query& q, std::string& out){
+  std::vector<std::string> words;
+  std::set<std::string> results;
+  if(q.index == "symspell" && index_lookup(e, shards, q.query, q.error, results)){
+    words.assign(results.begin(), results.end());
+  }else{
+    env quiet = e; // the debug output would interleave with the results
+    quiet.debug = false;
+    std::vector<std::vector<std::string> > found;
+    for(shard& sh : shards) found.push_back(shard_matches(quiet, sh, q.query, q.error, q.limit));
+    words = merge_words(found);
+  }
+  if(q.limit && words.size() > q.limit) words.resize(q.limit);
+  json_query(out, q);
+  out += ",\"results\":[";
+  for(size_t i = 0; i < words.size(); ++i){
+    if(i) out += ',';
+    json_string(out, words[i]);
+  }
+  out += "]}\n";
+}
+
+// The closest words of a typeahead session on the dictionary (the session is replaced if the error changed).
+template <class D>
+std::vector<std::pair<std::string, int> > typeahead_matches(std::unique_ptr<typeahead_session<ll, D> >& session,
+  D& dict, const std::string& prefix, int error, size_t limit){
+  if(!session || session->get_max_error() != error) session.reset(new typeahead_session<ll, D>(dict, error));
+  session->set_query(prefix);
+  return session->matches(limit);
+}
+
+// Answers a typeahead query (`~PREFIX N`): the session of every shard is extended from the frontier of the previous
+// prefix (the sessions are replaced if N changed). Prints the closest TYPEAHEAD_LIMIT words that start with a prefix
+// within N edits of PREFIX.
+void typeahead(env& e, std::vector<shard>& shards, char* line){
+  char prefix[MAX_WORD + 1] = ""; int error = 0;
+  sscanf(line + 1, "%25s %d", prefix, &error);
+  if(error < 0){
+    printf("Error: The error must not be negative!\n");
+    return;
+  }
+  std::vector<std::vector<std::pair<std::string, int> > > found(shards.size());
+  df_tmp(microseconds);
+  auto execution_time = time(microseconds, scatter(e, shards, [&](size_t i){
+    shard& sh = shards[i];
+    std::string encoded = sh.amap.encode(prefix);
+    found[i] = first_answers(sh.amap, TYPEAHEAD_LIMIT, [&](size_t n) -> std::vector<std::pair<std::string, int> > {
+      if(sh.has_louds) return typeahead_matches(sh.louds_session, sh.louds, encoded, error, n);
+      if(sh.has_radix) return typeahead_matches(sh.radix_session, sh.radix, encoded, error, n);
+      if(sh.lazy) return typeahead_matches(sh.lazy_session, *sh.lazy, encoded, error, n);
+      return typeahead_matches<DFA<ll, char> >(sh.session, sh.dict, encoded, error, n);
+    });
+  }));
+  // Every shard lists its closest words (by distance, then length, then in byte order), so the closest of all are
+  // among them.
+  std::vector<std::pair<std::string, int> > matches = merge_closest(found, TYPEAHEAD_LIMIT);
+  size_t frontier = 0;
+  for(shard& sh : shards){
+    frontier += sh.has_louds ? sh.louds_session->frontier().size()
+      : sh.has_radix ? sh.radix_session->frontier().size()
+      : sh.lazy ? sh.lazy_session->frontier().size() : sh.session->frontier().size();
+  }
+  dprintf("Typeahead frontier size: %lu entries\n", frontier);
+  dprintf("Typeahead keystroke time: %llu us\n", FORCE(unsigned long long, execution_time));
+  std::vector<std::string> words;
+  for(auto& m : matches) words.push_back(m.first);
+  print_words(words);
+}
+
+// Answers a ranked query (`#WORD N`): prints the TYPEAHEAD_LIMIT heaviest words within N errors of the word, along
+// with their weights.
+void ranked_computation(env& e, std::vector<shard>& shards, char* line){
+  char word[MAX_WORD + 1] = ""; int error = 0;
+  sscanf(line + 1, "%25s %d", word, &error);
+  dprintf("READ: %s, %d\n", word, error);
+  if(shards[0].read_only()){
+    printf("Error: The %s does not keep the counts of the words!\n", shards[0].read_only_name());
+    return;
+  }
+  std::vector<std::vector<std::pair<std::string, ll> > > found(shards.size());
+  std::vector<size_t> expanded(shards.size());
+  df_tmp(microseconds);
+  auto execution_time = time(microseconds, scatter(e, shards, [&](size_t i){
+    shard& sh = shards[i];
+    DFA<ll, char> lnfa = levenshtein_dfa(e, sh.amap, word, error);
+    found[i] = first_answers(sh.amap, TYPEAHEAD_LIMIT, [&](size_t n){
+      return sh.dict.top_k(lnfa, n, &expanded[i]);
+    });
+  }));
+  // The heaviest words of all the shards are among the heaviest words of every shard.
+  std::vector<std::pair<std::string, ll> > ranked = merge_ranked(found, TYPEAHEAD_LIMIT);
+  size_t total = 0;
+  for(size_t x : expanded) total += x;
+  dprintf("Top-k [dict ^ lnfa] expanded states: %lu\n", total);
+  dprintf("Top-k [dict ^ lnfa] execution time: %llu us\n", FORCE(unsigned long long, execution_time));
   printf("(");
-  for(std::vector<char> result : intersection.accept_paths()){
-    if(!first) printf(", ");
-    first = false;
-    for(char c : result){
-      printf("%c", c);
-    }
+  for(size_t i = 0; i < ranked.size(); ++i){
+    printf(i ? ", %s %lli" : "%s %lli", ranked[i].first.c_str(), ranked[i].second);
   }
   printf(")\n");
 }
 
-// the search loop
-void begin_search_loop(env e){
-  // Construct a dict trie:
-  trie dict;
-  std::string trie_path = e.file_path;
+background_writer writer;   // saves the caches (the destructor waits for them)
+
+// The path of the weights of a dictionary, next to its cached trie.
+std::string weights_path(const std::string& trie_path){
+  return trie_path.substr(0, trie_path.rfind('.')) + ".weights";
+}
+
+// Saves the dictionary (and its alphabet) in the `.cache` directory, in the background. The weights of a weighted
+// dictionary are saved in a `.weights` file next to it, as (state, weight) pairs.
+void save_cache(const std::string& trie_path, dawg& compressed_dict, alphabet_map& amap){
+  std::string dir_path = trie_path;
+  dir_path = dir_path.substr(0, dir_path.rfind('/'));
+  // Create the '.cache' folder if not already there
+  struct stat st{0};
+  if(stat(dir_path.c_str(), &st) == -1) {
+    mkdir(dir_path.c_str(), 0700);
+  }
+
+  std::ostringstream of;
+  serialize<char>(of, compressed_dict, &amap);
+  writer.save(trie_path, of.str());
+
+  std::string wpath = weights_path(trie_path);
+  if(compressed_dict.weights().empty()){
+    writer.erase(wpath);
+    return;
+  }
+  std::ostringstream wf;
+  {
+    encode_buffer out(wf);
+    for(auto w : compressed_dict.weights()){
+      out.put(w.first);
+      out.put(w.second);
+    }
+  }
+  writer.save(wpath, wf.str());
+}
+
+// Loads the weights saved by `save_cache` (an empty map if the dictionary is not weighted).
+std::unordered_map<ll, ll> load_weights(const std::string& trie_path){
+  std::unordered_map<ll, ll> weights;
+  std::ifstream wf(weights_path(trie_path).c_str(), std::ios::binary);
+  ll state, w;
+  while(wf.read((char*) &state, sizeof(ll)) && wf.read((char*) &w, sizeof(ll))) weights[state] = w;
+  return weights;
+}
+
+// Splits a `word<TAB>count` line (the count is 0 if there is no tab).
+ll split_count(std::string& s){
+  size_t tab = s.rfind('\t');
+  if(tab == std::string::npos) return 0;
+  ll count = atoll(s.c_str() + tab + 1);
+  s.erase(tab);
+  return count;
+}
+
+// The path of the deletion index of a dictionary, next to its cached trie.
+std::string index_path(const std::string& trie_path){
+  return trie_path.substr(0, trie_path.rfind('.')) + ".symspell";
+}
+
+void save_index(const std::string& trie_path, const deletion_index& index){
+  std::ostringstream of;
+  index.save(of);
+  writer.save(index_path(trie_path), of.str());
+}
+
+// Saves the shard (and its deletion index) in the `.cache` directory.
+void save_shard(shard& sh){
+  save_cache(sh.trie_path, sh.dict, sh.amap);
+  if(sh.has_index) save_index(sh.trie_path, sh.index);
+  sh.dirty = 0;
+}
+
+// The path of the LOUDS trie of a dictionary, next to its cached trie.
+std::string louds_path(const std::string& trie_path){
+  return trie_path.substr(0, trie_path.rfind('.')) + ".louds";
+}
+
+// The path of the radix trie of a dictionary, next to its cached trie.
+std::string radix_path(const std::string& trie_path){
+  return trie_path.substr(0, trie_path.rfind('.')) + ".radix";
+}
+
+// The path of the normalized DAWG of a dictionary (see lazy_DFA.hpp), next to its cached trie.
+std::string lazy_path(const std::string& trie_path){
+  return trie_path.substr(0, trie_path.rfind('.')) + ".lazy";
+}
+
+// Is there a file at the path that is not older than the cached trie of the shard?
+bool fresh(shard& sh, const std::string& path){
+  struct stat st{0}, trie_st{0};
+  if(stat(path.c_str(), &st) == -1) return false;
+  return stat(sh.trie_path.c_str(), &trie_st) == -1 || st.st_mtime >= trie_st.st_mtime;
+}
+
+// Saves a read-only trie of the shard (with its alphabet) next to its cached trie.
+template <class T>
+void save_read_only(shard& sh, const std::string& path, const T& t){
+  struct stat st{0};
+  std::string dir_path = sh.trie_path.substr(0, sh.trie_path.rfind('/'));
+  if(stat(dir_path.c_str(), &st) == -1) mkdir(dir_path.c_str(), 0700);
+  std::ostringstream of;
+  serialize_alphabet(of, sh.amap);
+  t.save(of);
+  writer.save(path, of.str());
+}
+
+// Loads a read-only trie of the shard, unless there is none or it is older than the cached trie.
+template <class T>
+bool load_read_only(shard& sh, const std::string& path, T& t){
+  if(!fresh(sh, path)) return false;
+  std::ifstream ifs(path.c_str(), std::ios::binary);
+  deserialize_alphabet(ifs, sh.amap);
+  return t.load(ifs);
+}
+
+// Writes the DAWG of the shard (with its alphabet) next to its cached trie, and normalizes it for a lazy_DFA.
+void save_lazy(shard& sh){
+  struct stat st{0};
+  std::string dir_path = sh.trie_path.substr(0, sh.trie_path.rfind('/'));
+  if(stat(dir_path.c_str(), &st) == -1) mkdir(dir_path.c_str(), 0700);
+  std::string path = lazy_path(sh.trie_path);
+  std::ostringstream of;
+  serialize<char>(of, sh.dict, &sh.amap);
+  writer.save(path, of.str());
+  writer.wait(); // (it is normalized, and opened, right away)
+  std::fstream fs(path.c_str(), std::fstream::binary | std::fstream::in | std::fstream::out);
+  normalize<char>(fs);
+}
+
+// Opens the normalized DAWG of the shard with a cache of the given bytes.
+bool load_lazy(shard& sh, size_t budget){
+  std::string path = lazy_path(sh.trie_path);
+  if(!fresh(sh, path)) return false;
+  sh.lazy.reset(new lazy_DFA<char>(path, budget));
+  sh.amap = sh.lazy->get_alphabet();
+  return true;
+}
+
+// Loads the read-only dictionary the shard is queried with (-l, -r or -z), returns whether it was loaded.
+bool load_read_only(env& e, shard& sh){
+  if(e.use_louds) return sh.has_louds = load_read_only(sh, louds_path(sh.trie_path), sh.louds);
+  if(e.use_radix) return sh.has_radix = load_read_only(sh, radix_path(sh.trie_path), sh.radix);
+  if(e.lazy_budget) return load_lazy(sh, e.lazy_budget);
+  return false;
+}
+
+// Loads the deletion index next to the cached trie, or builds it from the words of the dictionary (if there is no
+// index, if it is older than the trie, or if `rebuild`).
+void load_index(env& e, shard& sh, bool rebuild){
+  const std::string& trie_path = sh.trie_path;
+  dawg& compressed_dict = sh.dict;
+  deletion_index& index = sh.index;
+  struct stat index_st{0}, trie_st{0};
+  std::string path = index_path(trie_path);
+  bool fresh = !rebuild && stat(path.c_str(), &index_st) == 0
+    && (stat(trie_path.c_str(), &trie_st) == -1 || index_st.st_mtime >= trie_st.st_mtime);
+  if(fresh){
+    std::ifstream ifs(path.c_str(), std::ios::binary);
+    if(index.load(ifs)) return;
+  }
+  std::vector<std::string> words;
+  std::string prefix;
+  std::function<void(ll)> walk = [&](ll node){ // the words of the DAWG, depth first
+    if(compressed_dict.is_accept(node)) words.push_back(prefix);
+    compressed_dict.for_each_transition(node, [&](char c, ll next){
+      prefix.push_back(c);
+      walk(next);
+      prefix.pop_back();
+    });
+  };
+  if(sh.has_louds) sh.louds.for_each_word([&words](const std::string& w){ words.push_back(w); });
+  else if(sh.has_radix) sh.radix.for_each_word([&words](const std::string& w){ words.push_back(w); });
+  else if(sh.lazy) sh.lazy->for_each_word([&words](const std::string& w){ words.push_back(w); });
+  else walk(compressed_dict.get_start());
+  index = deletion_index(words);
+  struct stat st{0};
+  std::string dir_path = trie_path.substr(0, trie_path.rfind('/'));
+  if(stat(dir_path.c_str(), &st) == -1) mkdir(dir_path.c_str(), 0700);
+  save_index(trie_path, index);
+}
+
+// Inserts (`+WORD` or `+WORD<TAB>COUNT`) or deletes (`-WORD`) a word in its shard, returns whether the dictionary
+// changed. A shard is saved (and the statistics of its planner are recomputed) once it has FLUSH_INTERVAL updates
+// that are not saved.
+bool update(env& e, std::vector<shard>& shards, char* line){
+  std::string word = line + 1;
+  ll count = split_count(word);
+  trim(word);
+  if(word.empty()){
+    printf("Error: An update must be followed by a WORD!\n");
+    return false;
+  }
+  shard& sh = shards[shard_of(word, shards.size())];
+  if(sh.read_only()){
+    printf("Error: The %s is read-only!\n", sh.read_only_name());
+    return false;
+  }
+  dawg& compressed_dict = sh.dict;
+  alphabet_map& amap = sh.amap;
+  bool changed;
+  if(line[0] == '+'){
+    for(char c : word) amap.add(c);
+    std::string encoded = amap.encode(word);
+    if(compressed_dict.contains(encoded) && compressed_dict.get_weight(compressed_dict.follow(encoded)) != count){
+      compressed_dict.remove(encoded);
+      compressed_dict.insert(encoded, count);
+      printf("Updated the count of '%s' to %lli\n", word.c_str(), count);
+      changed = true;
+    }else{
+      changed = compressed_dict.insert(encoded, count);
+      if(changed && sh.has_index) sh.index.insert(encoded);
+      printf(changed ? "Inserted '%s'\n" : "'%s' is already in the dictionary\n", word.c_str());
+    }
+  }else{
+    changed = compressed_dict.remove(amap.encode(word));
+    printf(changed ? "Deleted '%s'\n" : "'%s' is not in the dictionary\n", word.c_str());
+  }
+  dprintf("DAWG size: %lu states\n", compressed_dict.size());
+  if(changed && ++sh.dirty >= FLUSH_INTERVAL){
+    save_shard(sh);
+    sh.stats = index_stats(sh.dict, amap.size()); // the planner costs the queries on the updated dictionary
+  }
+  return changed;
+}
+
+// The path of the cached trie of a shard (`.cache/NAME.trie` if the dictionary is not sharded, and
+// `.cache/NAME.shardIofN.trie` otherwise).
+std::string shard_path(const char* file_path, size_t i, size_t shards){
+  std::string trie_path = file_path;
   trie_path.insert(trie_path.rfind('/'), std::string("/.cache"));
-  trie_path = trie_path.replace(trie_path.begin() + trie_path.rfind('.'), trie_path.end(), ".trie");
-  char * line = NULL;
-  size_t len = 0;
-  ssize_t read;
-  int LOADING_INTERVAL = 10000;
-  int dict_size = 0;
-  DFA<ll, char> compressed_dict;
+  std::string ext = shards == 1 ? ".trie" : ".shard" + std::to_string(i) + "of" + std::to_string(shards) + ".trie";
+  return trie_path.replace(trie_path.begin() + trie_path.rfind('.'), trie_path.end(), ext);
+}
 
+// Loads the shards: the shards that have a cache are loaded from it, and the rest (or every shard if `save_trie`)
+// are built from the words of the dictionary file that belong to them, and saved.
+void load_shards(env& e, std::vector<shard>& shards){
   FILE* fs = fopen(e.file_path, "r");
   if(fs == NULL){
     fprintf(stderr, "ERROR: File error! Check if the file exists and if reads are allowed.\n");
     exit(1);
   }
+  size_t n = shards.size();
+  std::vector<bool> build(n), read_only_cached(n);
+  bool any = false;
+  for(size_t i = 0; i < n; ++i){
+    shards[i].trie_path = shard_path(e.file_path, i, n);
+    read_only_cached[i] = !e.save_trie && load_read_only(e, shards[i]); // the DAWG is not needed
+    FILE* cache = fopen(shards[i].trie_path.c_str(), "r");
+    build[i] = !read_only_cached[i] && (e.save_trie || cache == NULL);
+    if(cache) fclose(cache);
+    any = any || build[i];
+  }
 
-  printf("Loading ");
-  bool cache_found = fopen(trie_path.c_str(), "r") != NULL;
-  if(e.save_trie || !cache_found){ // if we want to save the trie, then we must load the file from the source
-    while((read = getline(&line, &len, fs)) != -1){
-      std::string s = line;
-      dprintf("line read from file: %s\n", s.substr(0, s.size() - 1).c_str()); fflush(stdout);
-      if(strcmp(line, "\n") == 0) continue;
-      dict.insert((trim(s), s));
-      if(!e.debug && ++dict_size % LOADING_INTERVAL == 0) (dict_size %= LOADING_INTERVAL, printf("."), fflush(stdout));
-    }
-    compressed_dict = dict.compress_dfa();
-  }else{
-    std::ifstream ifs(trie_path.c_str());
-    deserialize<char>(ifs, compressed_dict);
+  cprintf("Loading ");
+  std::vector<trie> dicts(n);
+  std::vector<std::unordered_map<std::string, ll> > counts(n); // the counts of a `word<TAB>count` dictionary
+  char * line = NULL;
+  size_t len = 0;
+  int LOADING_INTERVAL = 10000;
+  int dict_size = 0;
+  while(any && getline(&line, &len, fs) != -1){
+    std::string s = line;
+    dprintf("line read from file: %s\n", s.substr(0, s.size() - 1).c_str()); fflush(stdout);
+    if(strcmp(line, "\n") == 0) continue;
+    ll count = split_count(s);
+    trim(s);
+    size_t i = shard_of(s, n);
+    if(!build[i]) continue;
+    if(count) counts[i][s] = count;
+    dicts[i].insert(s);
+    if(e.cli && !e.debug && ++dict_size % LOADING_INTERVAL == 0) (dict_size %= LOADING_INTERVAL, printf("."), fflush(stdout));
   }
-  printf(" Done!\n"); 
-  cprintf("> "); fflush(stdout);
+  free(line);
   fclose(fs);
 
-  // Alphabet construction:
-  std::unordered_set<char> alphabet = compressed_dict.get_alphabet();
-  
-
-  if(e.save_trie && !cache_found){
-    std::string dir_path = trie_path;
-    dir_path = dir_path.substr(0, dir_path.rfind('/'));
-    // Create the '.cache' folder if not already there
-    struct stat st{0};
-    if(stat(dir_path.c_str(), &st) == -1) {
-      mkdir(dir_path.c_str(), 0700);
+  std::vector<ll> index_time(n);
+  auto load = [&](size_t i){
+    shard& sh = shards[i];
+    if(build[i]){
+      DFA<ll, char> compressed_trie = dicts[i].compress_dfa();
+      dicts[i] = trie();
+      sh.amap = alphabet_map(compressed_trie.get_alphabet());
+      sh.amap.apply(compressed_trie);
+      std::unordered_map<ll, ll> weights; // the counts, keyed by the accept states of the trie
+      for(auto c : counts[i]) weights[compressed_trie.follow(sh.amap.encode(c.first))] = c.second;
+      counts[i].clear();
+      sh.dict.build(compressed_trie, &weights);
+      if(e.save_trie || n > 1) save_cache(sh.trie_path, sh.dict, sh.amap);
+    }else if(!read_only_cached[i]){
+      std::ifstream ifs(sh.trie_path.c_str());
+      DFA<ll, char> cached;
+      deserialize<char>(ifs, cached, &sh.amap);
+      std::unordered_map<ll, ll> weights = load_weights(sh.trie_path);
+      sh.dict.build(cached, &weights);
+    }
+    if(e.use_deletion_index){
+      df_tmp(milliseconds);
+      index_time[i] = time(milliseconds, load_index(e, sh, build[i])).count();
+      sh.has_index = true;
     }
+    if(e.use_louds && !read_only_cached[i]){ // build the LOUDS trie from the DAWG, then drop the DAWG
+      sh.louds = louds_trie(sh.dict);
+      sh.has_louds = true;
+      sh.dict = dawg();
+      save_read_only(sh, louds_path(sh.trie_path), sh.louds);
+    }else if(e.use_radix && !read_only_cached[i]){ // the same for the radix trie
+      sh.radix = radix_trie(sh.dict);
+      sh.has_radix = true;
+      sh.dict = dawg();
+      save_read_only(sh, radix_path(sh.trie_path), sh.radix);
+    }else if(e.lazy_budget && !read_only_cached[i]){ // write the DAWG out for the lazy DFA, then drop it
+      save_lazy(sh);
+      sh.dict = dawg();
+      load_lazy(sh, e.lazy_budget);
+    }
+    // The statistics of the planner (a lazy DFA would have to be read whole for them, so it has none).
+    if(sh.has_louds) sh.stats = index_stats(sh.louds, sh.amap.size());
+    else if(sh.has_radix) sh.stats = index_stats(sh.radix, sh.amap.size());
+    else if(sh.lazy) sh.stats = index_stats(sh.amap.size());
+    else sh.stats = index_stats(sh.dict, sh.amap.size());
+  };
+  if(n == 1){
+    load(0);
+  }else{ // the shards are built (and loaded) in parallel
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < n; ++i) workers.push_back(std::thread(load, i));
+    for(std::thread& w : workers) w.join();
+  }
+  cprintf(" Done!\n");
+  ifd {
+    for(size_t i = 0; i < n; ++i){
+      if(shards[i].has_louds){ // (braced, as dprintf is an if)
+        dprintf("Shard %lu: LOUDS trie of %lu nodes, %lu bytes [%s]\n", i, shards[i].louds.size(),
+          shards[i].louds.memory(), read_only_cached[i] ? "cached" : "built");
+      }else if(shards[i].has_radix){
+        dprintf("Shard %lu: radix trie of %lu nodes, %lu label bytes, %lu bytes [%s]\n", i, shards[i].radix.size(),
+          shards[i].radix.pool_size(), shards[i].radix.memory(), read_only_cached[i] ? "cached" : "built");
+      }else if(shards[i].lazy){
+        struct stat st{0};
+        stat(lazy_path(shards[i].trie_path).c_str(), &st);
+        dprintf("Shard %lu: lazy DFA of %lli bytes on disk, with a cache of %lu bytes [%s]\n", i,
+          (long long) st.st_size, e.lazy_budget, read_only_cached[i] ? "cached" : "built");
+      }else{
+        dprintf("Shard %lu: %lu states, %lu bytes [%s]\n", i, shards[i].dict.size(),
+          shards[i].dict.memory_usage().total(), build[i] ? "built" : "cached");
+      }
+      if(shards[i].has_index) dprintf("Deletion index: %lu words, %lu bytes, loaded in %lli ms\n",
+        shards[i].index.words(), shards[i].index.memory(), index_time[i]);
+    }
+  }
+}
+
+// the search loop
+void begin_search_loop(env e){
+  char * line = NULL;
+  size_t len = 0;
+  std::vector<shard> shards(e.shards);
+  load_shards(e, shards);
+  cprintf("> "); fflush(stdout);
 
-    std::ofstream of; of.open(trie_path.c_str());
-    serialize<char>(of, compressed_dict);
-    of.close();
+  if(e.batch_path){
+    FILE* in = strcmp(e.batch_path, "-") ? fopen(e.batch_path, "r") : stdin;
+    if(in == NULL){
+      fprintf(stderr, "ERROR: File error! Check if the batch file exists and if reads are allowed.\n");
+      exit(1);
+    }
+    buffered_writer out(stdout);
+    df_tmp(milliseconds);
+    ll answered;
+    auto execution_time = time(milliseconds, answered = run_batch(in, out, e.threads,
+      [&](const batch_query& q, std::string& result){ batch_computation(e, shards, q, result); }));
+    if(e.debug) fprintf(stderr, "Answered %lli queries in %llu ms\n", answered, FORCE(unsigned long long, execution_time));
+    if(e.debug) fprintf(stderr, "Query plans: %s\n", plans.summary().c_str());
+    if(in != stdin) fclose(in);
+    return;
   }
 
   while(getline(&line, &len, stdin) != -1){ // while lines can be read:
-    char word[MAX_WORD] = ""; int error = 0;
-    
+    char word[MAX_WORD] = ""; int error = 0, limit = 0; // `... N LIMIT M` asks for the first M results
+
     if(line[0] == '\'' && e.cli){
       int i = 1;
       while(i < strlen(line) && line[i] != '\'') ++i; // find the last i
       if(i != strlen(line)){
-        sscanf(line+i+1, " %d", &error);
+        sscanf(line+i+1, " %d LIMIT %d", &error, &limit);
         line[i] = '\0';
-        computation(e, compressed_dict, alphabet, line+1, error);
+        computation(e, shards, line+1, error, std::max(limit, 0));
       }else{
         printf("Error: A WORD message must end with a '!\n");
       }
@@ -161,26 +870,38 @@ void begin_search_loop(env e){
       int i = 1;
       while(i < strlen(line) && line[i] != '"') ++i; // find the last i
       if(i != strlen(line)){
-        sscanf(line+i+1, " %d", &error);
+        sscanf(line+i+1, " %d LIMIT %d", &error, &limit);
         line[i] = '\0';
         char buf[MAX_STRING];
         strcpy(buf, line+1);
         char* tok = strtok(buf, " ");
         while(tok){
-          computation(e, compressed_dict, alphabet, tok, error);
+          computation(e, shards, tok, error, std::max(limit, 0));
           tok = strtok(NULL, " ");
         }
       }else{
         printf("Error: A STRING message must end with a \"!\n");
       }
+    }else if(line[0] == '@' && e.cli){
+      index_computation(e, shards, line);
+    }else if(line[0] == '#' && e.cli){
+      ranked_computation(e, shards, line);
+    }else if(line[0] == '~' && e.cli){
+      typeahead(e, shards, line);
+    }else if((line[0] == '+' || line[0] == '-') && e.cli){
+      for(shard& sh : shards) sh.session.reset();
+      update(e, shards, line);
     }else{
-      sscanf(line, "%25s %d", word, &error);
-      computation(e, compressed_dict, alphabet, word, error);
+      sscanf(line, "%25s %d LIMIT %d", word, &error, &limit);
+      computation(e, shards, word, error, std::max(limit, 0));
     }
 
     // for next line:
     cprintf("> "); fflush(stdout);
   }
+  for(shard& sh : shards){
+    if(sh.dirty) save_shard(sh);
+  }
 }
 
 void debug_switch(env& _env_, int& flag_pos, char* argv[]){
@@ -191,26 +912,127 @@ void save_trie(env& _env_, int& flag_pos, char* argv[]){
   _env_.save_trie = true;
 }
 
+void deletion_index_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.use_deletion_index = true;
+}
+
+void arena_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.use_arena = true;
+}
+
+int nargs;
+void batch_mode(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "A file (or `-` for stdin) must be specified after the -b or --batch flag!\n");
+    exit(1);
+  }
+  _env_.batch_path = argv[++flag_pos];
+  _env_.cli = false;
+}
+
+void change_threads(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs){
+    fprintf(stderr, "The number of threads must be specified after the -t or --threads flag!\n");
+    exit(1);
+  }
+  _env_.threads = atoi(argv[++flag_pos]);
+}
+
+void change_shards(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs || atoi(argv[flag_pos + 1]) <= 0){
+    fprintf(stderr, "A positive number of shards must be specified after the -n or --shards flag!\n");
+    exit(1);
+  }
+  _env_.shards = atoi(argv[++flag_pos]);
+}
+
+void louds_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.use_louds = true;
+}
+
+void radix_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.use_radix = true;
+}
+
+void lazy_mode(env& _env_, int& flag_pos, char* argv[]){
+  if(flag_pos + 1 >= nargs || atoi(argv[flag_pos + 1]) <= 0){
+    fprintf(stderr, "A positive number of megabytes must be specified after the -z or --lazy flag!\n");
+    exit(1);
+  }
+  _env_.lazy_budget = (size_t) atoi(argv[++flag_pos]) << 20;
+}
+
+void utf8_mode(env& _env_, int& flag_pos, char* argv[]){
+  _env_.utf8 = true;
+}
+
 void command_line_interface(env& _env_, int& flag_pos, char* argv[]){
   _env_.cli = true;
 }
 
 void help(env& _env_, int& flag_pos, char* argv[]){
   printf(
-    "usage: word_search [-d | --debug] [-s | --save] [-h | --help] FILE_NAME\n\n"\
+    "usage: word_search [-d | --debug] [-s | --save] [-a | --arena] [-h | --help]\n"\
+    "                   [-y | --symspell] [-b | --batch FILE] [-t | --threads N]\n"\
+    "                   [-n | --shards N] [-l | --louds] [-r | --radix]\n"\
+    "                   [-z | --lazy MB] [-u | --utf8] FILE_NAME\n\n"\
     "Builds a trie out of the given dictionary file [FILE_NAME] (the file MUST be\n"\
-    "newline separated). Then, search through the dictionary by specifying a string\n"
-    "and a levenschtein error.\n\n"\
+    "newline separated, and each line may be `WORD<TAB>COUNT` to weigh the word).\n"\
+    "Then, search through the dictionary by specifying a string and a levenschtein\n"\
+    "error.\n\n"\
     "  d : print debug information [for developer use only]\n"\
+    "  a : allocate the automata of each query from a single arena that is\n"\
+    "      released at the end of the query\n"\
     "  s : forces a file read and saves the trie in a `.cache` directory\n"\
+    "  y : loads (or builds) a symmetric delete index next to the trie, which\n"\
+    "      answers `@WORD N` queries (and batch queries with \"index\": \"symspell\")\n"\
+    "      with N <= 2 with a few hash probes; the planner also answers the\n"\
+    "      other queries with it when it is the cheapest\n"\
+    "  b : batch mode, answers every query in FILE (`-` for stdin) without\n"\
+    "      prompts; each line is either `WORD<TAB>N` (or just `WORD`) or\n"\
+    "      {\"query\": \"WORD\", \"error\": N} (with an optional \"limit\": M), and\n"\
+    "      each query is answered with a JSON line {\"query\": ..., \"error\": N,\n"\
+    "      \"results\": [...]}\n"\
+    "  t : the number of threads used in batch mode (one per core by default)\n"\
+    "  n : splits the dictionary into N shards (by the hash of the words), each\n"\
+    "      built and cached on its own (a shard whose cache is missing is rebuilt\n"\
+    "      without rebuilding the rest); every query is answered by all of the\n"\
+    "      shards in parallel, and their results are merged\n"\
+    "  l : answers the queries with a read-only LOUDS trie (about 11 bits per\n"\
+    "      node), which is cached next to the trie and loaded without it; the\n"\
+    "      dictionary cannot be updated, and `#WORD N` is not available\n"\
+    "  r : answers the queries with a read-only radix trie, whose single child\n"\
+    "      chains are folded into edges labeled with strings (a search follows a\n"\
+    "      whole label at a time); it is cached like the LOUDS trie (-l), and has\n"\
+    "      the same limits\n"\
+    "  z : answers the queries from a normalized copy of the DAWG on disk\n"\
+    "      (cached next to the trie), decoding the states on demand into a\n"\
+    "      cache of at most MB megabytes; it has the same limits as -l\n"\
+    "  u : counts the errors in UTF-8 code points instead of bytes (so an\n"\
+    "      accented letter is one error); the dictionary is still indexed by\n"\
+    "      bytes, and `~PREFIX N` still counts bytes\n"\
     "  h : print this help message\n\n"\
-    "There are three ways to search in the provided dictionary via the command line\n"\
+    "There are several ways to search in the provided dictionary via the command line\n"\
     "interface:\n\n"\
     "  > WORD                      : searches for the word in the dictionary with 0 errors\n"\
     "  > WORD N                    : searches for the word in the dictionary with N errors\n"\
+    "  > WORD N LIMIT M            : prints the first M matches (and stops searching)\n"\
     "  > \"WORD_1 WORD_2 ...\" N     : searches for each of the words with N errors\n"\
     "  > 'WORD' N                  : searches for the word (without escaping spaces)\n"\
-    "                                with N errors\n" 
+    "                                with N errors\n"\
+    "  > @WORD N                   : searches for the word with N errors with the\n"\
+    "                                symmetric delete index (see -y)\n"\
+    "  > #WORD N                   : lists the heaviest words within N errors (with\n"\
+    "                                their counts)\n"\
+    "  > +WORD                     : inserts the word into the dictionary (or\n"\
+    "                                `+WORD<TAB>COUNT` to insert it with a count)\n"\
+    "  > -WORD                     : deletes the word from the dictionary\n"\
+    "  > ~PREFIX N                 : lists the closest words that start with a\n"\
+    "                                prefix within N errors of PREFIX; typing the\n"\
+    "                                next PREFIX (eg. ~h, ~ho, ~how) reuses the\n"\
+    "                                work of the last one\n\n"\
+    "Updates are saved in the `.cache` directory every %d updates and on exit.\n",
+    FLUSH_INTERVAL
     );
   exit(0);
 }
@@ -218,11 +1040,30 @@ void help(env& _env_, int& flag_pos, char* argv[]){
 // the main driver
 int main(int argc, char* argv[]){
   env main_env{};
+  nargs = argc;
   std::unordered_map<std::string, std::function<void(env&,int&,char**)> > commands;
   commands["-d"] = debug_switch;
   commands["--debug"] = debug_switch;
   commands["-s"] = save_trie;
   commands["--save"] = save_trie;
+  commands["-a"] = arena_mode;
+  commands["--arena"] = arena_mode;
+  commands["-y"] = deletion_index_mode;
+  commands["--symspell"] = deletion_index_mode;
+  commands["-b"] = batch_mode;
+  commands["--batch"] = batch_mode;
+  commands["-t"] = change_threads;
+  commands["--threads"] = change_threads;
+  commands["-n"] = change_shards;
+  commands["--shards"] = change_shards;
+  commands["-l"] = louds_mode;
+  commands["--louds"] = louds_mode;
+  commands["-r"] = radix_mode;
+  commands["--radix"] = radix_mode;
+  commands["-z"] = lazy_mode;
+  commands["--lazy"] = lazy_mode;
+  commands["-u"] = utf8_mode;
+  commands["--utf8"] = utf8_mode;
   commands["-h"] = help;
   commands["--help"] = help;
   int st = 1;
@@ -251,5 +1092,12 @@ int main(int argc, char* argv[]){
     exit(1);
   }
 
+  if(main_env.use_louds + main_env.use_radix + (main_env.lazy_budget > 0) > 1){
+    fprintf(stderr, "ERROR: Only one of the -l, -r and -z flags can be used.\n");
+    exit(1);
+  }
+
+  if(main_env.threads <= 0) main_env.threads = std::max(1u, std::thread::hardware_concurrency());
+
   begin_search_loop(main_env);
 }
\ No newline at end of file
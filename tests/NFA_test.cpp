@@ -149,6 +149,120 @@ void run_test_suite(){
     run_test([&dfa2](){return dfa2.run(std::vector<char>{' ', '|', ' '});}, true);
     run_test([&inter](){return inter.run(std::vector<char>{' ', '|', ' '});}, false);
 
+    /**
+     * Testing default transitions (STAR is kept as an "otherwise" edge instead of being expanded):
+     */
+    std::cout << "\nTesting default transitions\n";
+    DFA<ll, char> med_def = match_ELLO.convert_to_dfa().compress_dfa();
+    run_test([&med_def](){return med_def.run(std::vector<char>{'f', 'e', 'l', 'l', 'o'});}, true);
+    run_test([&med_def](){return med_def.run(std::vector<char>{'Z', 'e', 'l', 'l', 'o'});}, true); // outside of `alphabet`
+    run_test([&med_def](){return med_def.run(std::vector<char>{'e', 'e', 'l', 'l', 'o'});}, true);
+    run_test([&med_def](){return med_def.run(std::vector<char>{'f', 'e', 'k', 'l', 'o'});}, false);
+    run_test([&med_def](){return med_def.run(std::vector<char>{});}, false);
+    DFA<ll, char> ones = construct_subseq("el").convert_to_dfa().compress_dfa();
+    DFA<ll, char> med_inter = med_def.intersection(ones).compress_dfa();
+    run_test([&med_inter](){return med_inter.run(std::vector<char>{'e', 'l'});}, false);
+    run_test([&med_def](){return med_def.has_transition(med_def.get_start(), '#');}, true);
+    NFA<std::string, char> any_o;
+    any_o.add_start("");
+    any_o.add_transition("", nfa_val<char>::STAR, "");
+    any_o.add_transition("", 'o', "o");
+    any_o.add_final_state("o");
+    DFA<ll, char> any_o_dfa = any_o.convert_to_dfa().compress_dfa();
+    DFA<ll, char> any_o_inter = any_o_dfa.intersection(med_def).compress_dfa();
+    run_test([&any_o_inter](){return any_o_inter.run(std::vector<char>{'Z', 'e', 'l', 'l', 'o'});}, true);
+    run_test([&any_o_inter](){return any_o_inter.run(std::vector<char>{'e', 'l', 'l', 'o'});}, true);
+    run_test([&any_o_inter](){return any_o_inter.run(std::vector<char>{'Z', 'e', 'l', 'l'});}, false);
+    run_test([&any_o_inter](){return any_o_inter.run(std::vector<char>{'Z', 'e', 'l', 'o'});}, false);
+    run_test([&any_o_dfa](){return any_o_dfa.run(std::vector<char>{'Z', '?', 'o'});}, true);
+
+    /**
+     * Testing the interned subset construction (the same DFA as `convert_to_dfa().compress_dfa()`):
+     */
+    std::cout << "\nTesting interned subset construction\n";
+    std::vector<std::unordered_set<std::string> > subsets;
+    DFA<ll, char> med_int = match_ELLO.convert_to_compressed_dfa(&subsets);
+    run_test([&med_int CM &med_def](){return med_int.states().size();}, med_def.states().size());
+    run_test([&med_int CM &subsets](){return subsets.size();}, med_int.states().size());
+    run_test([&med_int](){return med_int.get_start();}, 0LL);
+    run_test([&med_int](){return med_int.run(std::vector<char>{'Z', 'e', 'l', 'l', 'o'});}, true);
+    run_test([&med_int](){return med_int.run(std::vector<char>{'f', 'e', 'k', 'l', 'o'});}, false);
+    run_test([&med_int](){return med_int.has_transition(med_int.get_start(), '#');}, true);
+    DFA<ll, char> any_o_int = any_o.convert_to_compressed_dfa(&subsets);
+    run_test([&subsets](){return subsets[0];}, std::unordered_set<std::string>{""});
+    run_test([&any_o_int](){return any_o_int.run(std::vector<char>{'Z', '?', 'o'});}, true);
+    run_test([&any_o_int](){return any_o_int.run(std::vector<char>{'o', '?'});}, false);
+    subset_interner interner;
+    std::vector<uint32_t> set1{3, 1, 2, 3}, set2{1, 2, 3}, set3{1, 2};
+    subset_interner::canonical(set1);
+    run_test([&interner CM &set2](){return interner.intern(set2);}, (size_t) 0);
+    run_test([&interner CM &set3](){return interner.intern(set3);}, (size_t) 1);
+    run_test([&interner CM &set1](){bool added; size_t id = interner.intern(set1 CM &added); return !added && id == 0;}, true);
+    run_test([&interner](){return interner.size();}, (size_t) 2);
+
+    /**
+     * Testing arena allocation (the automata should not touch the heap allocator inside of a scope):
+     */
+    std::cout << "\nTesting arena allocation\n";
+    {
+        arena query_arena;
+        arena_scope scope(&query_arena);
+        alloc_stats_t before = alloc_stats();
+        DFA<ll, char> arena_dfa = construct_subseq("unicorn").convert_to_dfa().compress_dfa();
+        DFA<ll, char> arena_inter = arena_dfa.intersection(med_def).compress_dfa();
+        run_test([&arena_dfa](){return arena_dfa.run(std::vector<char>{'u', 'i', 'r', 'n'});}, true);
+        run_test([&arena_inter](){return arena_inter.run(std::vector<char>{});}, false);
+        run_test([&before](){return alloc_stats().heap_allocations - before.heap_allocations;}, (size_t) 0);
+        run_test([&before](){return alloc_stats().arena_allocations > before.arena_allocations;}, true);
+    }
+
+    /**
+     * Testing automata that cross an arena scope (an automaton built outside of the scope keeps its maps, nested
+     * ones included, on the heap; a copy binds to the arena active where it is made):
+     */
+    std::cout << "\nTesting automata across arena scopes\n";
+    DFA<ll, int> long_lived;
+    long_lived.add_start(0);
+    DFA<ll, char>* heap_copy = NULL;
+    {
+        arena query_arena;
+        DFA<ll, char>* scoped = NULL;
+        {
+            arena_scope scope(&query_arena);
+            alloc_stats_t before = alloc_stats();
+            long_lived.add_transition(0, 700, 1);
+            long_lived.add_transition(1, -3, 2);
+            long_lived.add_final_state(2);
+            run_test([&before](){return alloc_stats().arena_allocations - before.arena_allocations;}, (size_t) 0);
+            scoped = new DFA<ll, char>(construct_subseq("unicorn").convert_to_dfa().compress_dfa());
+        }
+        alloc_stats_t before = alloc_stats();
+        heap_copy = new DFA<ll, char>(*scoped);
+        run_test([&before](){return alloc_stats().arena_allocations - before.arena_allocations;}, (size_t) 0);
+        delete scoped;
+    }
+    run_test([&long_lived](){return long_lived.run(std::vector<int>{700 CM -3});}, true);
+    run_test([&heap_copy](){return heap_copy->run(std::vector<char>{'u' CM 'i' CM 'r' CM 'n'});}, true);
+    delete heap_copy;
+
+    /**
+     * Testing the byte edge map (labels with the high bit set, and the null byte):
+     */
+    std::cout << "\nTesting byte edge map labels\n";
+    DFA<ll, char> bytes;
+    bytes.add_start(0);
+    bytes.add_transition(0, (char) 0xFF, 1);
+    bytes.add_transition(0, '\0', 2);
+    bytes.add_transition(0, (char) 0x80, 3);
+    bytes.add_transition(0, 'a', 4);
+    bytes.add_final_state(1); bytes.add_final_state(4);
+    run_test([&bytes](){return bytes.run(std::vector<char>{(char) 0xFF});}, true);
+    run_test([&bytes](){return bytes.run(std::vector<char>{'\0'});}, false);
+    run_test([&bytes](){return bytes.run(std::vector<char>{'a'});}, true);
+    run_test([&bytes](){return bytes.next_state(0, (char) 0x80);}, 3LL);
+    run_test([&bytes](){return bytes.has_transition(0, 'b');}, false);
+    run_test([&bytes](){return bytes.transitions(0).size();}, (size_t) 4);
+
     std::ofstream of(tmp_file, std::ofstream::binary);
     serialize(of, unicorn);
     of.close();
@@ -187,6 +301,26 @@ void run_test_suite(){
     run_assert([&unicorn CM &unicorn_cpy](){auto v = std::vector<char>{'c' CM 'o' CM 'n'};return unicorn.run(v) == unicorn_cpy.run(v);});
     run_assert([&unicorn CM &unicorn_cpy](){auto v = std::vector<char>{'u' CM 'u' CM 'n'};return unicorn.run(v) == unicorn_cpy.run(v);});
 
+    alphabet_map amap(alphabet);
+    DFA<ll,char> unicorn_sym = unicorn;
+    amap.apply(unicorn_sym);
+    of = std::ofstream(tmp_file, std::ofstream::binary);
+    serialize(of, unicorn_sym, &amap);
+    of.close();
+
+    alphabet_map amap_cpy;
+    is = std::ifstream(tmp_file, std::istream::binary);
+    deserialize(is, unicorn_cpy, &amap_cpy);
+    is.close();
+
+    std::cout << "\nTesting alphabet remapping:\n";
+    run_test([&amap_cpy](){return amap_cpy.size();}, 26);
+    run_test([&amap_cpy](){return amap_cpy.encode('!') == amap_cpy.other();}, true);
+    run_test([&amap_cpy](){return amap_cpy.decode(amap_cpy.encode('q'));}, 'q');
+    run_test([&unicorn_cpy CM &amap_cpy](){return unicorn_cpy.run(amap_cpy.encode(std::string("uirn")));}, true);
+    run_test([&unicorn_cpy CM &amap_cpy](){return unicorn_cpy.run(amap_cpy.encode(std::string("uun")));}, false);
+    run_test([&unicorn_cpy CM &amap_cpy](){return unicorn_cpy.run(amap_cpy.encode(std::string("u!n")));}, false);
+
     remove(tmp_file);
 
     print_test_results();
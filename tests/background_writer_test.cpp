@@ -0,0 +1,224 @@
+#include "../src/data_structures/FA/DFA.hpp"
+#include "../src/data_structures/FA/encoding_util.hpp"
+#include "../src/util/background_writer.cpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <functional>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+const char* tmp_file = "background_writer.txt";
+const char* other_file = "background_writer_other.txt";
+
+std::string read_file(const std::string& path){
+    std::ifstream ifs(path.c_str(), std::ifstream::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+bool exists(const std::string& path){
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// Puts `n` (char, ll) pairs into an encode_buffer, and reads them back from the stream.
+bool fields_round_trip(size_t n){
+    std::stringstream ss;
+    {
+        encode_buffer out(ss);
+        for(size_t i = 0; i < n; ++i){
+            out.put((char) (i % 251));
+            out.put((ll) (i * 2654435761u));
+        }
+    } // (the rest is written when the buffer is destroyed)
+    if(ss.str().size() != n * (sizeof(char) + sizeof(ll))) return false;
+    for(size_t i = 0; i < n; ++i){
+        char c; ll v;
+        if(!ss.get(c) || !ss.read((char*) &v, sizeof(ll))) return false;
+        if(c != (char) (i % 251) || v != (ll) (i * 2654435761u)) return false;
+    }
+    return ss.peek() == EOF;
+}
+
+// A DFA with the given number of states, with transitions, default transitions and accept states.
+DFA<ll, char> make_dfa(ll n){
+    DFA<ll, char> dfa;
+    dfa.add_start(0);
+    for(ll i = 0; i < n; ++i){
+        dfa.add_transition(i, 'a', (i + 1) % n);
+        dfa.add_transition(i, 'b', (i * 7 + 3) % n);
+        if(i % 5 == 0) dfa.add_transition(i, 'c', i);
+        if(i % 4 == 0) dfa.add_default_transition(i, (i + 2) % n);
+        if(i % 3 == 0) dfa.add_final_state(i);
+    }
+    return dfa;
+}
+
+// The states of a DFA, each with its accept flag, default transition and sorted transitions.
+std::vector<std::vector<ll> > dump(DFA<ll, char>& dfa){
+    std::vector<std::vector<ll> > ret;
+    dfa.for_each_state([&](ll st){
+        std::vector<ll> row{st, dfa.get_start() == st, dfa.is_accept(st),
+            dfa.has_default_transition(st) ? dfa.default_state(st) : -1};
+        std::vector<ll> edges;
+        dfa.for_each_transition(st, [&](char c, ll next){ edges.push_back(c * (1ll << 40) + next); });
+        std::sort(edges.begin(), edges.end());
+        row.insert(row.end(), edges.begin(), edges.end());
+        ret.push_back(row);
+    });
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+// Serializes the DFA (with and without an alphabet map) and deserializes it.
+bool dfa_round_trip(ll n, bool remapped, size_t* bytes = NULL){
+    DFA<ll, char> dfa = make_dfa(n), back;
+    alphabet_map am(std::string("abc")), am_back;
+    std::stringstream ss;
+    serialize<char>(ss, dfa, remapped ? &am : NULL);
+    if(bytes) *bytes = ss.str().size();
+    deserialize<char>(ss, back, &am_back);
+    if(remapped && am_back.size() != am.size()) return false;
+    return dump(dfa) == dump(back);
+}
+
+void run_test_suite(){
+    std::cout << "Testing encode buffers:\n";
+    run_assert([](){return fields_round_trip(0);});
+    run_assert([](){return fields_round_trip(10);});
+    run_assert([](){return fields_round_trip(ENCODE_BLOCK / 9);});           // just under a block
+    run_assert([](){return fields_round_trip(ENCODE_BLOCK / 9 + 1);});       // across the first block
+    run_assert([](){return fields_round_trip(3 * ENCODE_BLOCK / 9 + 5);});   // (the blocks do not end on a field)
+    run_test([](){
+        std::stringstream ss;
+        encode_buffer out(ss);
+        out.put((ll) 7);
+        size_t before = ss.str().size();
+        out.flush();
+        return std::make_pair(before CM ss.str().size());
+    }, std::make_pair((size_t) 0 CM sizeof(ll)));
+
+    std::cout << "\nTesting DFA round trips:\n";
+    run_assert([](){return dfa_round_trip(1 CM false);});
+    run_assert([](){return dfa_round_trip(100 CM false);});
+    run_assert([](){return dfa_round_trip(100 CM true);});
+    run_assert([](){ // across several blocks
+        size_t bytes = 0;
+        return dfa_round_trip(60000 CM true CM &bytes) && bytes > 2 * ENCODE_BLOCK;
+    });
+
+    std::cout << "\nTesting write then rename:\n";
+    remove(tmp_file);
+    run_assert([](){return write_then_rename(tmp_file CM "hello") && read_file(tmp_file) == "hello";});
+    run_assert([](){ // over an existing file, in several writes
+        std::string big(2 * SAVE_BLOCK + 3 CM 'x');
+        return write_then_rename(tmp_file CM big) && read_file(tmp_file) == big;
+    });
+    run_test([](){return exists(std::string(tmp_file) + ".tmp");}, false);
+    run_assert([](){ // the temporary file cannot be opened (it is a directory)
+        write_then_rename(tmp_file CM "old");
+        std::string tmp = std::string(tmp_file) + ".tmp";
+        mkdir(tmp.c_str(), 0700);
+        bool ok = write_then_rename(tmp_file CM "new");
+        rmdir(tmp.c_str());
+        return !ok && read_file(tmp_file) == "old";
+    });
+
+    std::cout << "\nTesting the background writer:\n";
+    remove(tmp_file);
+    run_assert([](){ // wait() returns after the rename
+        background_writer writer;
+        std::string big(3 * SAVE_BLOCK CM 'y');
+        writer.save(tmp_file CM std::string(big));
+        writer.wait();
+        return writer.pending() == 0 && read_file(tmp_file) == big && !exists(std::string(tmp_file) + ".tmp");
+    });
+    run_test([](){ // the saves and the erases run in the order they were queued
+        background_writer writer;
+        for(int i = 0; i < 20; ++i) writer.save(tmp_file CM std::to_string(i));
+        writer.erase(tmp_file);
+        writer.save(tmp_file CM "last");
+        writer.save(other_file CM "other");
+        writer.erase(other_file);
+        writer.wait();
+        return read_file(tmp_file) + "," + std::to_string(exists(other_file));
+    }, std::string("last,0"));
+    run_test([](){ // the destructor waits for every save
+        {
+            background_writer writer;
+            writer.save(other_file CM "saved");
+        }
+        return read_file(other_file);
+    }, std::string("saved"));
+    run_test([](){ // a failed save leaves the file as it was, and is counted
+        background_writer writer;
+        writer.save(tmp_file CM "kept");
+        writer.wait();
+        std::string tmp = std::string(tmp_file) + ".tmp";
+        mkdir(tmp.c_str(), 0700);
+        writer.save(tmp_file CM "lost");
+        writer.save(other_file CM "written");
+        writer.wait();
+        rmdir(tmp.c_str());
+        return read_file(tmp_file) + "," + read_file(other_file) + "," + std::to_string(writer.failures());
+    }, std::string("kept,written,1"));
+    run_test([](){return background_writer().failures();}, (size_t) 0);
+    remove(tmp_file);
+    remove(other_file);
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
@@ -0,0 +1,163 @@
+#include "../src/data_structures/FA/DFA.hpp"
+#include "../src/util/batch.cpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <stdio.h>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+// The JSON string of the bytes.
+std::string json(const std::string& s){
+    std::string out;
+    json_string(out, s);
+    return out;
+}
+
+// Parses the line, returning the query, its error, its limit and its index (or the message if it cannot be parsed).
+std::string parse(const std::string& line){
+    batch_query q;
+    if(!parse_query(line, q)) return "! " + q.message;
+    return q.query + "|" + std::to_string(q.error) + "|" + std::to_string(q.limit) + "|" + q.index;
+}
+
+// Runs a batch over the input with the given number of threads (each answer is the query and its line number).
+std::string batch(const std::string& input, int threads, ll* answered = NULL){
+    FILE* in = tmpfile();
+    FILE* out = tmpfile();
+    fwrite(input.data(), 1, input.size(), in);
+    rewind(in);
+    ll n;
+    {
+        buffered_writer writer(out, 64); // (small, so that it is flushed many times)
+        n = run_batch(in, writer, threads, [](const batch_query& q, std::string& res){
+            unsigned spin = 0;
+            for(char c : q.query) spin = spin * 31 + c;
+            for(volatile unsigned i = 0; i < spin % 2000; ++i){} // (the answers take different times)
+            res = q.query + " " + std::to_string(q.error) + " @" + std::to_string(q.line) + "\n";
+        });
+    }
+    if(answered) *answered = n;
+    std::string ret;
+    rewind(out);
+    char buf[4096];
+    size_t r;
+    while((r = fread(buf, 1, sizeof(buf), out)) > 0) ret.append(buf, r);
+    fclose(in);
+    fclose(out);
+    return ret;
+}
+
+void run_test_suite(){
+    std::cout << "Testing JSON strings:\n";
+    run_test([](){return json("plain");}, std::string("\"plain\""));
+    run_test([](){return json("say \"hi\" \\ bye");}, std::string("\"say \\\"hi\\\" \\\\ bye\""));
+    run_test([](){return json("a\nb\tc\r");}, std::string("\"a\\nb\\tc\\r\""));
+    run_test([](){return json(std::string("\x01" "\x7f", 2));}, std::string("\"\\u0001\\u007f\""));
+    run_test([](){return json("caf\xC3\xA9 \xF0\x9F\x98\x80");}, std::string("\"caf\xC3\xA9 \xF0\x9F\x98\x80\""));
+    run_test([](){return json("bad \xC3" "x \xFF");}, std::string("\"bad \\u00c3x \\u00ff\""));
+    run_test([](){return json("cut \xE2\x82");}, std::string("\"cut \\u00e2\\u0082\""));
+
+    std::cout << "\nTesting TSV queries:\n";
+    run_test([](){return parse("hello");}, std::string("hello|0|0|"));
+    run_test([](){return parse("hello\t2");}, std::string("hello|2|0|"));
+    run_test([](){return parse("two words\t1 ");}, std::string("two words|1|0|"));
+    run_test([](){return parse("a\tb\t3");}, std::string("a\tb|3|0|"));  // the last tab
+    run_test([](){return parse("hello\t1.5");}, std::string("! the error must be an integer"));
+    run_test([](){return parse("hello\t");}, std::string("! the error must be an integer"));
+    run_test([](){return parse("hello\t-1");}, std::string("! the error must not be negative"));
+
+    std::cout << "\nTesting JSON queries:\n";
+    run_test([](){return parse("{\"query\": \"hello\", \"error\": 2}");}, std::string("hello|2|0|"));
+    run_test([](){return parse(" { \"error\" : 1 , \"query\" : \"x\" } ");}, std::string("x|1|0|"));
+    run_test([](){return parse("{\"query\": \"say \\\"hi\\\"\"}");}, std::string("say \"hi\"|0|0|"));
+    run_test([](){return parse("{\"query\": \"a\\\\b\\/c\\n\\t\"}");}, std::string("a\\b/c\n\t|0|0|"));
+    run_test([](){return parse("{\"query\": \"\\u0041\\u00e9\\u20ac\"}");}, std::string("A\xC3\xA9\xE2\x82\xAC|0|0|"));
+    run_test([](){return parse("{\"query\": \"\\ud83d\\ude00!\"}");}, std::string("\xF0\x9F\x98\x80!|0|0|"));
+    run_test([](){return parse("{\"query\": \"x\", \"limit\": 5, \"index\": \"words\"}");}, std::string("x|0|5|words"));
+    run_test([](){return parse("{\"query\": \"x\", \"foo\": 3, \"bar\": \"baz\", \"ok\": true}");},
+        std::string("x|0|0|"));                                              // unknown keys are ignored
+    run_test([](){return parse("{\"query\": \"x\", \"foo\": {\"a\": 1}}");},
+        std::string("! values must be strings or numbers"));
+    run_test([](){return parse("{\"query\": \"x\", \"error\": 1.5}");}, std::string("! the error must be an integer"));
+    run_test([](){return parse("{\"query\": \"x\", \"error\": \"one\"}");}, std::string("x|0|0|"));
+    run_test([](){return parse("{\"query\": \"x\", \"error\": -2}");}, std::string("! the error must not be negative"));
+    run_test([](){return parse("{\"query\": \"x\", \"limit\": -2}");},
+        std::string("! the limit must be a non-negative integer"));
+    run_test([](){return parse("{\"error\": 1}");}, std::string("! missing \"query\""));
+    run_test([](){return parse("{}");}, std::string("! missing \"query\""));
+    run_test([](){return parse("{\"query\": \"x\"");}, std::string("! expected a ',' or a '}'"));
+    run_test([](){return parse("{\"query\" \"x\"}");}, std::string("! expected a ':'"));
+    run_test([](){return parse("{query: \"x\"}");}, std::string("! expected a key"));
+    run_test([](){return parse("{\"query\": \"x}");}, std::string("! malformed string"));
+    run_test([](){return parse("{\"query\": \"\\q\"}");}, std::string("! malformed string"));
+
+    std::cout << "\nTesting batches:\n";
+    run_test([](){return batch("a\n\nb\t1\r\n\r\n{\"query\": \"c\"}\n" CM 1);},
+        std::string("a 0 @1\nb 1 @3\nc 0 @5\n"));                           // blank lines are skipped
+    run_test([](){return batch("a\nb\t-1\n{\"query\": 1}\nd" CM 2);},
+        std::string("a 0 @1\n{\"line\":2,\"message\":\"the error must not be negative\"}\n"
+            "{\"line\":3,\"message\":\"missing \\\"query\\\"\"}\nd 0 @4\n"));
+    run_test([](){ll n = -1; batch("" CM 4 CM &n); return n;}, (ll) 0);
+    run_assert([](){ // the order of the input, whatever the number of threads (across several blocks)
+        std::string input CM expected;
+        for(int i = 0; i < 2 * BATCH_BLOCK + 123; ++i){
+            std::string q = "q" + std::to_string(i * 7919 % 100003);
+            input += q + "\t" + std::to_string(i % 3) + "\n";
+            expected += q + " " + std::to_string(i % 3) + " @" + std::to_string(i + 1) + "\n";
+        }
+        ll n = 0;
+        for(int threads : {1 CM 3 CM 8}){
+            if(batch(input CM threads CM &n) != expected || n != 2 * BATCH_BLOCK + 123) return false;
+        }
+        return true;
+    });
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
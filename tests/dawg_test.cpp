@@ -0,0 +1,154 @@
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+std::set<std::string> words(dawg& d){
+    std::set<std::string> ret;
+    for(auto path : d.accept_paths()) ret.insert(std::string(path.begin(), path.end()));
+    return ret;
+}
+
+// The size of the minimal automaton of the given words (built from a trie).
+size_t minimal_size(std::set<std::string> ws){
+    trie t;
+    for(std::string w : ws) t.insert(w);
+    DFA<ll, char> compressed = t.compress_dfa();
+    dawg d; d.build(compressed);
+    return d.size();
+}
+
+// Do the weights of the top-k words (within k errors of the query) match a sort of every match?
+bool top_k_matches(dawg& d, const std::vector<std::pair<std::string, ll> >& weighted, std::string q, int error,
+    size_t k){
+    DFA<ll, char> lev = levenshtein_nfa(q, error).convert_to_dfa().compress_dfa();
+    std::vector<ll> expected;
+    for(auto p : weighted){
+        if(lev.run(p.first)) expected.push_back(p.second);
+    }
+    std::sort(expected.rbegin(), expected.rend());
+    std::vector<std::pair<std::string, ll> > got = d.top_k(lev, k);
+    if(got.size() != std::min(k, expected.size())) return false;
+    for(size_t i = 0; i < got.size(); ++i){
+        if(got[i].second != expected[i] || !lev.run(got[i].first)) return false;
+    }
+    return true;
+}
+
+size_t top_k_expanded(dawg& d, std::string q, int error, size_t k){
+    size_t expanded;
+    DFA<ll, char> lev = levenshtein_nfa(q, error).convert_to_dfa().compress_dfa();
+    d.top_k(lev, k, &expanded);
+    return expanded;
+}
+
+void run_test_suite(){
+    std::cout << "Testing dawg inserts:\n";
+    dawg d;
+    run_test([&d](){return d.insert("tap");}, true);
+    run_test([&d](){return d.insert("taps");}, true);
+    run_test([&d](){return d.insert("top");}, true);
+    run_test([&d](){return d.insert("tops");}, true);
+    run_test([&d](){return d.insert("tops");}, false);
+    run_test([&d](){return d.size();}, (size_t) 5); // t -> {a, o} -> p -> s
+    run_test([&d](){return d.contains("tap") && d.contains("tops") && !d.contains("to");}, true);
+    run_test([&d](){return words(d);}, std::set<std::string>{"tap" CM "taps" CM "top" CM "tops"});
+
+    std::cout << "\nTesting dawg deletes:\n";
+    run_test([&d](){return d.remove("taps");}, true);
+    run_test([&d](){return d.remove("taps");}, false);
+    run_test([&d](){return d.contains("tap") && !d.contains("taps") && d.contains("tops");}, true);
+    run_test([&d](){return d.size();}, minimal_size({"tap" CM "top" CM "tops"}));
+    run_test([&d](){return d.remove("tap") && d.remove("top") && d.remove("tops");}, true);
+    run_test([&d](){return d.size();}, (size_t) 1);
+    run_test([&d](){return d.insert("") && d.contains("");}, true);
+
+    std::cout << "\nTesting dawg against a rebuilt minimal automaton:\n";
+    std::vector<std::string> ops = {"+cat", "+cats", "+bat", "+bats", "+ca", "-cat", "+rat", "+rats",
+        "-bats", "+cab", "+crab", "-ca", "+bat", "-cats", "+cars", "+bars"};
+    dawg e;
+    std::set<std::string> ref;
+    for(std::string op : ops){
+        std::string w = op.substr(1);
+        if(op[0] == '+'){ e.insert(w); ref.insert(w); }
+        else{ e.remove(w); ref.erase(w); }
+        run_assert([&e CM &ref](){return words(e) == ref && e.size() == minimal_size(ref);});
+    }
+
+    std::cout << "\nTesting weighted dawgs:\n";
+    dawg w;
+    run_test([&w](){return w.insert("tap", 5) && w.insert("top", 5) && w.insert("taps", 2) && w.insert("tops", 7);}, true);
+    run_test([&w](){return w.size();}, (size_t) 8); // nothing below `t` is shared: taps weighs 2, tops 7
+    run_test([&w](){return w.get_bound(w.get_start()) == 7 && w.get_bound(w.follow(std::string("ta"))) == 5;}, true);
+    run_test([&w](){return w.get_weight(w.follow(std::string("taps")));}, (ll) 2);
+    run_test([&w](){return w.remove("tops") && w.insert("tops", 2);}, true);
+    run_test([&w](){return w.size() == minimal_size({"tap" CM "taps" CM "top" CM "tops"}) && w.get_bound(w.get_start()) == 5;}, true);
+    run_test([&w](){return w.remove("tap") && w.get_bound(w.get_start()) == 5 && w.remove("top");}, true);
+    run_test([&w](){return w.get_bound(w.get_start());}, (ll) 2);
+
+    std::cout << "\nTesting weighted top-k:\n";
+    std::vector<std::pair<std::string, ll> > weighted = {{"cat", 40}, {"cats", 3}, {"bat", 25}, {"bats", 1},
+        {"car", 60}, {"cart", 60}, {"rat", 12}, {"rats", 7}, {"cab", 33}, {"crab", 2}, {"a", 80}, {"at", 5}};
+    dawg t;
+    for(auto p : weighted) t.insert(p.first, p.second);
+    DFA<ll, char> any_word = levenshtein_nfa("cat", 4).convert_to_dfa().compress_dfa();
+    run_test([&t CM &any_word](){return t.top_k(any_word, 3);},
+        std::vector<std::pair<std::string CM ll> >{{"a" CM 80} CM {"car" CM 60} CM {"cart" CM 60}});
+    for(int k = 0; k <= 2; ++k){
+        run_assert([&t CM &weighted CM k](){return top_k_matches(t CM weighted CM "cat" CM k CM 4);});
+    }
+    run_test([&t](){return top_k_expanded(t CM "cat" CM 0 CM 1);}, (size_t) 4); // the start, c, ca, cat
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
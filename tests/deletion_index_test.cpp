@@ -0,0 +1,110 @@
+#include "../src/data_structures/deletion_index.hpp"
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+int edit_distance(const std::string& a, const std::string& b){
+    std::vector<std::vector<int> > dp(a.size() + 1, std::vector<int>(b.size() + 1));
+    for(size_t i = 0; i <= a.size(); ++i) dp[i][0] = i;
+    for(size_t j = 0; j <= b.size(); ++j) dp[0][j] = j;
+    for(size_t i = 1; i <= a.size(); ++i)
+        for(size_t j = 1; j <= b.size(); ++j)
+            dp[i][j] = std::min(std::min(dp[i-1][j], dp[i][j-1]) + 1, dp[i-1][j-1] + (a[i-1] != b[j-1]));
+    return dp[a.size()][b.size()];
+}
+
+std::set<std::string> brute_force(const std::vector<std::string>& ws, std::string q, int k){
+    std::set<std::string> ret;
+    for(std::string w : ws){
+        if(edit_distance(w, q) <= k) ret.insert(w);
+    }
+    return ret;
+}
+
+std::set<std::string> lookup(const deletion_index& index, std::string q, int k){
+    std::vector<std::string> found = index.lookup(q, k);
+    return std::set<std::string>(found.begin(), found.end());
+}
+
+void run_test_suite(){
+    std::vector<std::string> ws = {"howdy", "rowdy", "hoody", "how", "hello", "yellow", "a", "ab", "", "abcdefghij",
+        "xbcdefghij", "abcdefghijk", "bcdefghij", "abdcefghij", "kitten", "sitting", "mitten", "smitten"};
+    deletion_index index(ws, 2, 4);
+
+    std::cout << "Testing the band edit distance:\n";
+    run_test([](){return deletion_index::within("kitten", "sitting", 3);}, true);
+    run_test([](){return deletion_index::within("kitten", "sitting", 2);}, false);
+    run_test([](){return deletion_index::within("", "ab", 2) && !deletion_index::within("", "abc", 2);}, true);
+    run_test([](){return deletion_index::within("abcdefghij", "bcdefghijx", 2);}, true);
+
+    std::cout << "\nTesting deletion index lookups against a brute force search:\n";
+    std::vector<std::string> queries = {"howdy", "hwody", "yello", "", "b", "abcdefghij", "bacdefghij",
+        "abcdefghijkl", "cdefghij", "kitten", "sittin", "smiten"};
+    for(int k = 0; k <= 2; ++k){
+        for(std::string q : queries){
+            run_assert([&index CM &ws CM q CM k](){return lookup(index CM q CM k) == brute_force(ws CM q CM k);});
+        }
+    }
+
+    std::cout << "\nTesting deletion index updates and persistence:\n";
+    index.insert("howdie");
+    run_test([&index](){return lookup(index CM "howdi" CM 1);}, std::set<std::string>{"howdie" CM "howdy"});
+    std::stringstream ss;
+    index.save(ss);
+    deletion_index loaded;
+    run_test([&loaded CM &ss](){return loaded.load(ss);}, true);
+    run_test([&loaded](){return loaded.words() == 19 && loaded.get_max_error() == 2;}, true);
+    run_test([&loaded](){return lookup(loaded CM "howdi" CM 1);}, std::set<std::string>{"howdie" CM "howdy"});
+    run_test([](){std::stringstream bad("not an index"); deletion_index d; return d.load(bad);}, false);
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
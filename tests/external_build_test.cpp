@@ -0,0 +1,161 @@
+#include "../src/data_structures/suffix_tree/suffix_tree.hpp"
+#include "../src/data_structures/suffix_tree/suffix_tree_encoding.hpp"
+#include "../src/data_structures/suffix_tree/doc_position_serialize.hpp"
+#include "../src/data_structures/suffix_tree/external_build.hpp"
+#include <random>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <set>
+#include <functional>
+#include <stdexcept>
+#include <stdio.h>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+const char* tmp_file = "external_build.txt";
+
+std::string write_document(const std::string& text){
+    std::ofstream of(tmp_file, std::ofstream::binary);
+    of << text;
+    return tmp_file;
+}
+
+// Does the tree built within the budget hold the same chunks (at the same indices) as the one built in memory?
+bool same_as_in_memory(const std::string& text, ll chunk, size_t budget, size_t expected_runs){
+    suffix_tree doc;
+    doc.load_file(write_document(text), chunk);
+    compressed_suffix_tree in_memory = doc.compress_dfa();
+
+    std::stringstream ss;
+    size_t runs = 0;
+    build_suffix_tree_external(ss, tmp_file, chunk, budget, tmp_file, &runs);
+    compressed_suffix_tree external; alphabet_map am;
+    deserialize_suffix_tree(ss, external, &am);
+    if(runs != expected_runs || in_memory.states().size() != external.states().size()) return false;
+    std::string padded = text + (char) EOF;
+    for(size_t i = 0; i + chunk <= padded.size(); ++i){
+        std::string s = padded.substr(i, chunk);
+        if(in_memory.get_indices(s) != external.get_indices(am.encode(s))) return false;
+    }
+    return true;
+}
+
+// Are the temporary files of a build with the given prefix gone?
+bool no_temporary_files(const std::string& prefix){
+    for(const std::string& p : {prefix + ".run0" CM prefix + ".run1" CM prefix + ".pos"}){
+        if(std::ifstream(p.c_str())) return false;
+    }
+    return true;
+}
+
+// Does the build throw a std::runtime_error (and leave no temporary files behind)?
+bool build_fails(std::ostream& os, const std::string& prefix){
+    try{
+        build_suffix_tree_external(os, write_document("abracadabra"), 3, 20, prefix);
+    }catch(const std::runtime_error&){
+        return no_temporary_files(prefix);
+    }
+    return false;
+}
+
+void run_test_suite(){
+    std::cout << "Testing external builds:\n";
+    run_assert([](){return same_as_in_memory("abracadabra" CM 3 CM 20 CM 3);});
+    run_assert([](){return same_as_in_memory("abracadabra" CM 3 CM 1 << 20 CM 1);});
+    run_assert([](){return same_as_in_memory("aaaaaaaaaa" CM 4 CM 5 CM 8);});
+    run_assert([](){return same_as_in_memory("the cat\nthe hat\n" CM 16 CM 5 CM 2);});
+    run_assert([](){return same_as_in_memory("short" CM 8 CM 64 CM 0);});
+    run_test([](){
+        std::stringstream ss; compressed_suffix_tree t;
+        build_suffix_tree_external(ss CM write_document("hello") CM 2 CM 10 CM tmp_file);
+        deserialize_suffix_tree(ss CM t);
+        return t.get_prefix_positions(std::string()).size();
+    }, (size_t) 5);
+
+    std::cout << "\nTesting external builds of random documents:\n";
+    std::mt19937 rng(11);
+    for(int t = 0; t < 6; ++t){
+        std::string text;
+        size_t n = 500 + rng() % 3000;
+        for(size_t i = 0; i < n; ++i) text += "ab \ncd"[rng() % 6];
+        ll chunk = 1 + rng() % 12;
+        size_t budget = 5 * (50 + rng() % 400);
+        size_t runs = (n + 1 - chunk + budget / 5 - 1) / (budget / 5);
+        run_assert([text CM chunk CM budget CM runs](){return same_as_in_memory(text CM chunk CM budget CM runs);});
+    }
+
+    std::cout << "\nTesting failed external builds:\n";
+    run_assert([](){ // the temporary files are removed
+        std::stringstream ss;
+        build_suffix_tree_external(ss CM write_document("abracadabra") CM 3 CM 20 CM tmp_file);
+        return no_temporary_files(tmp_file);
+    });
+    run_assert([](){ // the runs cannot be written
+        std::stringstream ss;
+        return build_fails(ss CM "no_such_directory/external_build");
+    });
+    run_assert([](){ // the index cannot be written
+        std::stringstream ss;
+        ss.setstate(std::ios::badbit);
+        return build_fails(ss CM tmp_file);
+    });
+    run_assert([](){
+        std::stringstream ss;
+        try{
+            build_suffix_tree_external(ss CM "no_such_file.txt" CM 3 CM 20 CM tmp_file);
+        }catch(const std::runtime_error&){
+            return true;
+        }
+        return false;
+    });
+    remove(tmp_file);
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
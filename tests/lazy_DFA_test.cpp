@@ -0,0 +1,165 @@
+#include "../src/data_structures/FA/lazy_DFA.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include "../src/data_structures/typeahead.hpp"
+#include <random>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <set>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+const char* tmp_file = "lazy_DFA_test.tmp";
+
+std::set<std::string> automaton_search(dawg& d, std::string q, int k){
+    DFA<ll, char> lnfa = levenshtein_nfa(q, k).convert_to_dfa().compress_dfa();
+    std::set<std::string> ret;
+    for(std::vector<char> r : d.intersection(lnfa).compress_dfa().accept_paths()) ret.insert(std::string(r.begin(), r.end()));
+    return ret;
+}
+
+std::set<std::string> lazy_search(lazy_DFA<char>& l, std::string q, int k){
+    DFA<ll, char> lnfa = levenshtein_nfa(q, k).convert_to_dfa().compress_dfa();
+    std::vector<std::string> found = l.search(lnfa);
+    return std::set<std::string>(found.begin(), found.end());
+}
+
+std::vector<std::string> words_of(lazy_DFA<char>& l){
+    std::vector<std::string> ret;
+    l.for_each_word([&ret](const std::string& w){ ret.push_back(w); });
+    return ret;
+}
+
+// Does a typeahead session on the lazy DFA find the same words as one on the DAWG?
+bool typeahead_matches(dawg& d, lazy_DFA<char>& l, std::string prefix, int k){
+    typeahead_session<ll> on_dawg(d, k);
+    typeahead_session<ll, lazy_DFA<char> > on_lazy(l, k);
+    for(size_t i = 1; i <= prefix.size(); ++i){
+        on_dawg.set_query(prefix.substr(0, i));
+        on_lazy.set_query(prefix.substr(0, i));
+        if(on_dawg.matches(10) != on_lazy.matches(10)) return false;
+    }
+    return true;
+}
+
+// Serializes the DFA to the temporary file (normalizing it if asked to).
+void write(DFA<ll, char>& d, const alphabet_map* am, bool normalized){
+    std::ofstream of(tmp_file, std::ofstream::binary);
+    serialize(of, d, am);
+    of.close();
+    if(!normalized) return;
+    std::fstream f(tmp_file, std::fstream::binary | std::fstream::in | std::fstream::out);
+    normalize<char>(f);
+}
+
+bool throws(size_t budget){
+    try{
+        lazy_DFA<char> l(tmp_file, budget);
+    }catch(std::runtime_error& err){
+        return true;
+    }
+    return false;
+}
+
+void run_test_suite(){
+    std::mt19937 rng(7);
+    std::vector<std::string> ws = {"howdy", "rowdy", "hoody", "how", "hello", "yellow", "a", "ab", "abc", "kitten",
+        "sitting", "mitten", "smitten", "howdies", "rowdies"};
+    for(int i = 0; i < 300; ++i){ // and some random words, so the DFA does not fit in a small cache
+        std::string w;
+        for(int j = 3 + rng() % 6; j > 0; --j) w += (char) ('a' + rng() % 8);
+        ws.push_back(w);
+    }
+    trie words;
+    for(std::string w : ws) words.insert(w);
+    DFA<ll, char> compressed = words.compress_dfa();
+    alphabet_map amap(compressed.get_alphabet());
+    amap.apply(compressed);
+    dawg d;
+    d.build(compressed);
+    std::set<std::string> sorted;
+    for(std::string w : ws) sorted.insert(amap.encode(w));
+
+    write(d, &amap, false);
+    std::cout << "Testing that the DFA must be normalized:\n";
+    run_test([](){return throws(1 << 20);}, true);
+
+    write(d, &amap, true);
+    lazy_DFA<char> big(tmp_file, 1 << 20), small(tmp_file, 2048);
+
+    std::cout << "\nTesting the lazy DFA:\n";
+    run_test([&big CM &amap](){return big.get_alphabet().size() == amap.size() && big.get_alphabet().decode(big.get_alphabet().encode('k')) == 'k';}, true);
+    run_test([&small CM &amap](){return small.contains(amap.encode("howdy")) && small.contains(amap.encode("a"));}, true);
+    run_test([&small CM &amap](){return small.contains(amap.encode("howd")) || small.contains("");}, false);
+    run_test([&small CM &d](){return small.states().size();}, d.size());
+    run_test([&small CM &sorted](){return words_of(small);}, std::vector<std::string>(sorted.begin() CM sorted.end()));
+    run_test([&big CM &amap](){ll s = big.next_state(big.get_start() CM amap.encode('a')); return big.is_accept(s) && big.has_transition(s CM amap.encode('b'));}, true);
+    run_test([&big CM &amap](){return big.has_transition(big.get_start() CM amap.encode('z'));}, false);
+    run_test([&big](){try{ big.is_accept(big.get_start() + 1); }catch(std::runtime_error& err){ return true; } return false;}, true);
+
+    std::cout << "\nTesting Levenshtein searches on the lazy DFA:\n";
+    std::vector<std::string> queries = {"howdy", "hwody", "yello", "b", "kitten", "abcde", "hgfed"};
+    for(int k = 0; k <= 2; ++k){
+        for(std::string q : queries){
+            run_assert([&small CM &d CM &amap CM q CM k](){return lazy_search(small CM amap.encode(q) CM k) == automaton_search(d CM amap.encode(q) CM k);});
+        }
+    }
+    run_assert([&small CM &d CM &amap](){return typeahead_matches(d CM small CM amap.encode("howdi") CM 1);});
+
+    std::cout << "\nTesting the cache:\n";
+    run_assert([&small](){return small.memory() <= 2048 && small.cached() > 0;});
+    run_assert([&small](){return small.cache_stats().second > small.cached();}); // states were evicted and read again
+    run_assert([&big](){return big.cache_stats().first > 0 && big.cached() <= (size_t) 4000;});
+    run_assert([&big CM &d](){words_of(big); auto before = big.cache_stats(); words_of(big); return big.cache_stats().second == before.second && big.cached() == d.size();}); // everything fits
+
+    remove(tmp_file);
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
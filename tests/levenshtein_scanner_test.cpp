@@ -0,0 +1,221 @@
+#include "../src/data_structures/levenshtein_scanner.hpp"
+#include "../src/data_structures/multi_levenshtein_scanner.hpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <functional>
+#include <stdexcept>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+// Scans the text in pieces of the given size, returning the (start, end, distance) of every hit.
+std::vector<std::vector<ll> > scan(levenshtein_scanner& sc, std::string text, size_t piece){
+    std::vector<std::vector<ll> > ret;
+    auto emit = [&](ll end, int d){ ret.push_back({sc.match_start(text.data(), 0, end, d), end, d}); };
+    levenshtein_scanner::cursor_t c = sc.begin();
+    for(size_t i = 0; i < text.size(); i += piece){
+        sc.feed(c, text.data(), 0, i, std::min(text.size(), i + piece), emit);
+    }
+    sc.finish(c, emit);
+    return ret;
+}
+
+// Scans the parts of the text between the given split points one by one (with scan_part), returning the
+// (start, end, distance) of every hit.
+std::vector<std::vector<ll> > part_scan(levenshtein_scanner& sc, std::string text, std::vector<ll> splits){
+    std::vector<std::vector<ll> > ret;
+    auto emit = [&](ll end, int d){ ret.push_back({sc.match_start(text.data(), 0, end, d), end, d}); };
+    splits.insert(splits.begin(), 0);
+    splits.push_back(text.size());
+    for(size_t i = 0; i + 1 < splits.size(); ++i){
+        scan_part(sc, text.data(), text.size(), splits[i], splits[i + 1], emit);
+    }
+    return ret;
+}
+
+// Scans the text for every pattern at once, returning the sorted (start, end, distance, pattern) of every hit.
+std::vector<std::vector<ll> > multi_scan(multi_levenshtein_scanner& sc, std::string text){
+    std::vector<std::vector<ll> > ret;
+    auto emit = [&](ll end, int d, int p){ ret.push_back({sc.match_start(text.data(), 0, end, d, p), end, d, p}); };
+    multi_levenshtein_scanner::cursor_t c = sc.begin();
+    sc.feed(c, text.data(), 0, 0, text.size(), emit);
+    sc.finish(c, emit);
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+// The multi-pattern version of part_scan.
+std::vector<std::vector<ll> > multi_part_scan(multi_levenshtein_scanner& sc, std::string text,
+    std::vector<ll> splits){
+    std::vector<std::vector<ll> > ret;
+    auto emit = [&](ll end, int d, int p){ ret.push_back({sc.match_start(text.data(), 0, end, d, p), end, d, p}); };
+    splits.insert(splits.begin(), 0);
+    splits.push_back(text.size());
+    for(size_t i = 0; i + 1 < splits.size(); ++i){
+        scan_part(sc, text.data(), text.size(), splits[i], splits[i + 1], emit);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+// Does every way of splitting the text (at one point, or every `stride` bytes) give the hits of the whole text?
+template <class W, class P>
+bool parts_agree(const std::string& text, size_t window, W whole_scan, P part_scan){
+    std::vector<std::vector<ll> > whole = whole_scan();
+    for(ll i = 1; i < (ll) text.size(); ++i){
+        if(part_scan(std::vector<ll>{i}) != whole) return false;
+    }
+    for(ll stride = 1; stride <= 3 * (ll) window; ++stride){
+        std::vector<ll> splits;
+        for(ll i = stride; i < (ll) text.size(); i += stride) splits.push_back(i);
+        if(part_scan(splits) != whole) return false;
+    }
+    return true;
+}
+
+bool parts_agree(levenshtein_scanner& sc, std::string text){
+    return parts_agree(text, sc.window(), [&](){ return scan(sc, text, text.size()); },
+        [&](std::vector<ll> splits){ return part_scan(sc, text, splits); });
+}
+
+bool parts_agree(multi_levenshtein_scanner& sc, std::string text){
+    return parts_agree(text, sc.window(), [&](){ return multi_scan(sc, text); },
+        [&](std::vector<ll> splits){ return multi_part_scan(sc, text, splits); });
+}
+
+// Does building the scanner throw?
+template <class F>
+bool throws(F build){
+    try{
+        build();
+    }catch(const std::runtime_error&){
+        return true;
+    }
+    return false;
+}
+
+void run_test_suite(){
+    std::cout << "Testing exact scans:\n";
+    levenshtein_scanner exact("abc", 0);
+    run_test([&exact](){return exact.window();}, (size_t) 3);
+    run_test([&exact](){return scan(exact, "abc", 1);}, std::vector<std::vector<ll> >{{0 CM 2 CM 0}});
+    run_test([&exact](){return scan(exact, "xxabcxabcabc", 1).size();}, (size_t) 3);
+    run_test([&exact](){return scan(exact, "xxabcxabcabc", 5);}, scan(exact, "xxabcxabcabc", 1));
+    run_test([&exact](){return scan(exact, "ab\nc", 2).size();}, (size_t) 0);
+
+    std::cout << "\nTesting fuzzy scans:\n";
+    levenshtein_scanner fuzzy("hello", 1);
+    run_test([&fuzzy](){return scan(fuzzy, "say helo there", 3);}, std::vector<std::vector<ll> >{{4 CM 7 CM 1}});
+    run_test([&fuzzy](){return scan(fuzzy, "say hello there", 3);}, std::vector<std::vector<ll> >{{4 CM 8 CM 0}});
+    run_test([&fuzzy](){return scan(fuzzy, "jello, hallo", 4);},
+        std::vector<std::vector<ll> >{{1 CM 4 CM 1} CM {7 CM 11 CM 1}});
+    run_test([&fuzzy](){return scan(fuzzy, "hxllo", 1);}, std::vector<std::vector<ll> >{{0 CM 4 CM 1}});
+    run_test([&fuzzy](){return scan(fuzzy, "goodbye", 1).size();}, (size_t) 0);
+
+    std::cout << "\nTesting scans in parts:\n";
+    levenshtein_scanner aaa("aaa", 1);
+    run_assert([&aaa](){return parts_agree(aaa CM std::string(200 CM 'a'));});
+    run_assert([&aaa](){return parts_agree(aaa CM std::string(101 CM 'a') + "\n" + std::string(60 CM 'b'));});
+    run_assert([&aaa](){return parts_agree(aaa CM "xaaxaaaxaxaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");});
+    run_assert([&fuzzy](){return parts_agree(fuzzy CM "say helo there, hello hello jello hhhhhhhhhhhhhhhhhhhhhhhhhhhhhhhh");});
+    run_assert([&exact](){return parts_agree(exact CM "abcabcabcabcabcxabcabcabcabcab");});
+    run_assert([](){
+        levenshtein_scanner abab("abab", 2);
+        std::string text;
+        unsigned seed = 7;
+        for(int i = 0; i < 300; ++i){ seed = seed * 1103515245 + 12345; text += "ab"[(seed >> 16) % 2]; }
+        return parts_agree(abab CM text);
+    });
+    multi_levenshtein_scanner ab({"aaa" CM "bbbb"}, {1 CM 1});
+    run_assert([&ab](){return parts_agree(ab CM std::string(150 CM 'a') + "\n" + std::string(80 CM 'b'));});
+    run_assert([&ab](){return parts_agree(ab CM "abababbbbbbbbbbaaaaaaaaaaaaaaaaaaaaaaabbbbbbbbbbbbbbbbbbbbbbbbbxxab");});
+    run_assert([](){
+        multi_levenshtein_scanner mixed({"aab" CM "bbbb" CM "ba"}, {1 CM 2 CM 0}, 8); // flushes its cache often
+        std::string text;
+        unsigned seed = 11;
+        for(int i = 0; i < 300; ++i){ seed = seed * 1103515245 + 12345; text += "aab"[(seed >> 16) % 3]; }
+        return parts_agree(mixed CM text + std::string(50 CM 'b'));
+    });
+
+    std::cout << "\nTesting multi-pattern scans:\n";
+    multi_levenshtein_scanner multi({"hello" CM "there" CM "say"}, {1 CM 0 CM 0});
+    run_test([&multi](){return multi.window();}, (size_t) 6);
+    run_test([&multi](){return multi_scan(multi, "say helo there");},
+        std::vector<std::vector<ll> >{{0 CM 2 CM 0 CM 2} CM {4 CM 7 CM 1 CM 0} CM {9 CM 13 CM 0 CM 1}});
+    run_test([&multi](){return multi_scan(multi, "thera");}, std::vector<std::vector<ll> >{});
+    run_test([&multi](){return multi_scan(multi, "jello, hallo");},
+        std::vector<std::vector<ll> >{{1 CM 4 CM 1 CM 0} CM {7 CM 11 CM 1 CM 0}});
+    multi_levenshtein_scanner tiny({"hello" CM "there" CM "say"}, {1 CM 0 CM 0}, 4); // flushes its cache often
+    run_test([&tiny](){return multi_scan(tiny, "say helo there, jello, hallo");},
+        multi_scan(multi, "say helo there, jello, hallo"));
+    multi_levenshtein_scanner one({"hello"}, {1});
+    run_test([&one CM &fuzzy](){
+        std::vector<std::vector<ll> > ret;
+        for(auto h : scan(fuzzy, "jello, hallo, hxllo, helo there", 7)) ret.push_back({h[0] CM h[1] CM h[2] CM 0});
+        return ret;
+    }, multi_scan(one, "jello, hallo, hxllo, helo there"));
+
+    std::cout << "\nTesting the bounds of the error:\n";
+    run_assert([](){return throws([](){ levenshtein_scanner("ab" CM 2); });});
+    run_assert([](){return throws([](){ levenshtein_scanner("ab" CM -1); });});
+    run_assert([](){return throws([](){ multi_levenshtein_scanner({"abc" CM "ab"} CM {1 CM 2}); });});
+    run_assert([](){return throws([](){ multi_levenshtein_scanner({"abc"} CM {-1}); });});
+    run_assert([](){return !throws([](){ multi_levenshtein_scanner({"abc" CM "ab"} CM {2 CM 1}); });});
+    run_assert([](){ // with an error of the length - 1, every hit is a non-empty match inside the text
+        levenshtein_scanner ab("ab" CM 1);
+        std::string text = "abcdefg\nhijkaln\nb";
+        std::vector<std::vector<ll> > hits = scan(ab CM text CM 3);
+        for(auto& h : hits){
+            if(h[0] > h[1] || h[1] >= (ll) text.size()) return false;
+        }
+        return hits.size() == 3;
+    });
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
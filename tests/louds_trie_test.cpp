@@ -0,0 +1,141 @@
+#include "../src/data_structures/louds_trie.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include <random>
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+// Are the rank and select of random bits the same as counting?
+bool rank_select_matches(size_t n, int density){
+    std::mt19937 rng(n);
+    rank_select_bits bits;
+    std::vector<bool> naive;
+    for(size_t i = 0; i < n; ++i){
+        bool b = (int) (rng() % 100) < density;
+        bits.push_back(b);
+        naive.push_back(b);
+    }
+    bits.build();
+    size_t ones = 0, zeros = 0;
+    for(size_t i = 0; i < n; ++i){
+        if(bits.rank1(i) != ones || bits.get(i) != naive[i]) return false;
+        if(naive[i] && bits.select1(++ones) != i) return false;
+        if(!naive[i] && bits.select0(++zeros) != i) return false;
+    }
+    return bits.rank1(n) == ones;
+}
+
+std::vector<std::string> words_of(const louds_trie& t){
+    std::vector<std::string> ret;
+    t.for_each_word([&ret](const std::string& w){ ret.push_back(w); });
+    return ret;
+}
+
+std::set<std::string> automaton_search(dawg& d, std::string q, int k){
+    DFA<ll, char> lnfa = levenshtein_nfa(q, k).convert_to_dfa().compress_dfa();
+    std::set<std::string> ret;
+    for(std::vector<char> r : d.intersection(lnfa).compress_dfa().accept_paths()) ret.insert(std::string(r.begin(), r.end()));
+    return ret;
+}
+
+std::set<std::string> louds_search(const louds_trie& t, std::string q, int k){
+    DFA<ll, char> lnfa = levenshtein_nfa(q, k).convert_to_dfa().compress_dfa();
+    std::vector<std::string> found = t.search(lnfa);
+    return std::set<std::string>(found.begin(), found.end());
+}
+
+void run_test_suite(){
+    std::cout << "Testing rank and select:\n";
+    run_assert([](){return rank_select_matches(1 CM 50);});
+    run_assert([](){return rank_select_matches(64 CM 50);});
+    run_assert([](){return rank_select_matches(5000 CM 50);});
+    run_assert([](){return rank_select_matches(5000 CM 3);});
+    run_assert([](){return rank_select_matches(5000 CM 97);});
+
+    std::vector<std::string> ws = {"howdy", "rowdy", "hoody", "how", "hello", "yellow", "a", "ab", "abc", "kitten",
+        "sitting", "mitten", "smitten", "howdies", "rowdies"};
+    trie words;
+    for(std::string w : ws) words.insert(w);
+    DFA<ll, char> compressed = words.compress_dfa();
+    dawg d;
+    d.build(compressed);
+    louds_trie t(d);
+    std::set<std::string> sorted(ws.begin(), ws.end());
+
+    std::cout << "\nTesting the LOUDS trie of a DAWG:\n";
+    run_test([&t](){return words_of(t);}, std::vector<std::string>(sorted.begin() CM sorted.end()));
+    run_test([&t](){return t.size();}, (size_t) 58);
+    run_test([&t](){return t.contains("howdy") && t.contains("a") && !t.contains("howd") && !t.contains("");}, true);
+    run_test([&t](){return t.is_accept(t.next_state(t.next_state(t.get_start() CM 'a') CM 'b'));}, true);
+    run_test([&t](){return t.has_transition(t.get_start() CM 'z');}, false);
+    run_test([](){louds_trie empty; return empty.size() == 1 && !empty.contains("") && words_of(empty).empty();}, true);
+
+    std::cout << "\nTesting Levenshtein searches on the LOUDS trie:\n";
+    std::vector<std::string> queries = {"howdy", "hwody", "yello", "b", "kitten", "sittin", "rowdie"};
+    for(int k = 0; k <= 2; ++k){
+        for(std::string q : queries){
+            run_assert([&t CM &d CM q CM k](){return louds_search(t CM q CM k) == automaton_search(d CM q CM k);});
+        }
+    }
+
+    std::cout << "\nTesting LOUDS trie persistence:\n";
+    std::stringstream ss;
+    t.save(ss);
+    louds_trie loaded;
+    run_test([&loaded CM &ss](){return loaded.load(ss);}, true);
+    run_test([&loaded CM &t](){return words_of(loaded) == words_of(t) && loaded.size() == t.size();}, true);
+    run_test([](){std::stringstream bad("not a trie"); louds_trie l; return l.load(bad);}, false);
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
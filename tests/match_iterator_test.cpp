@@ -0,0 +1,171 @@
+#include "../src/data_structures/FA/match_iterator.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include "../src/data_structures/suffix_tree/suffix_tree.hpp"
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <random>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+const char* tmp_file = "match_iterator_test.txt";
+
+dawg build(const std::vector<std::string>& ws){
+    trie t;
+    for(const std::string& w : ws) t.insert(w);
+    DFA<ll, char> compressed = t.compress_dfa();
+    dawg d; d.build(compressed);
+    return d;
+}
+
+// Every word the iterator returns (at most `limit`), in order.
+std::vector<std::string> iterate(DFA<ll, char>& d, DFA<ll, char>& lev, size_t limit = 0){
+    match_iterator<DFA<ll, char> > matches(d, lev, limit);
+    std::vector<std::string> ret;
+    std::string w; ll state;
+    while(matches.next(w, state)) ret.push_back(w);
+    return ret;
+}
+
+// Does the iterator find the words of the intersection, in (unsigned) label order, each with the state it ends at?
+bool same_as_intersection(dawg& d, std::string q, int error){
+    DFA<ll, char> lev = levenshtein_nfa(q, error).convert_to_compressed_dfa();
+    std::set<std::string> expected;
+    for(auto path : d.intersection(lev).compress_dfa().accept_paths()) expected.insert(std::string(path.begin(), path.end()));
+    match_iterator<DFA<ll, char> > matches(d, lev);
+    std::vector<std::string> got;
+    std::string w; ll state;
+    while(matches.next(w, state)){
+        if(d.follow(w) != state) return false;
+        got.push_back(w);
+    }
+    auto unsigned_less = [](const std::string& a, const std::string& b){
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y){
+            return (unsigned char) x < (unsigned char) y;
+        });
+    };
+    return std::is_sorted(got.begin(), got.end(), unsigned_less)
+        && std::set<std::string>(got.begin(), got.end()) == expected && got.size() == expected.size();
+}
+
+void run_test_suite(){
+    std::cout << "Testing the match iterator:\n";
+    dawg d = build({"cat", "cats", "cut", "dog", "dot", "kitten", "mitten", "sitting", "smitten"});
+    DFA<ll, char> kitten = levenshtein_nfa("kitten", 1).convert_to_compressed_dfa();
+    run_test([&d CM &kitten](){return iterate(d CM kitten);}, std::vector<std::string>{"kitten" CM "mitten"});
+    run_test([&d CM &kitten](){return iterate(d CM kitten CM 1);}, std::vector<std::string>{"kitten"});
+    DFA<ll, char> ca = levenshtein_nfa("ca", 1).convert_to_compressed_dfa();
+    run_test([&d CM &ca](){return iterate(d CM ca);}, std::vector<std::string>{"cat"});
+    DFA<ll, char> none = levenshtein_nfa("zzzzzz", 1).convert_to_compressed_dfa();
+    run_test([&d CM &none](){return iterate(d CM none).size();}, (size_t) 0);
+    run_assert([&d](){return same_as_intersection(d CM "kitten" CM 2);});
+    run_assert([&d](){return same_as_intersection(d CM "dat" CM 1);});
+    run_assert([&d](){return same_as_intersection(d CM "" CM 3);});
+    run_test([&d CM &kitten](){
+        match_iterator<DFA<ll CM char> > matches(d CM kitten CM 1);
+        std::string w; ll state;
+        bool first = matches.next(w CM state);
+        return first && !matches.next(w CM state) && matches.count() == 1;
+    }, true);
+    run_test([](){ // the start state is a result (the empty word)
+        dawg e = build({"" CM "a"});
+        DFA<ll CM char> lev = levenshtein_nfa("" CM 0).convert_to_compressed_dfa();
+        return iterate(e CM lev);
+    }, std::vector<std::string>{""});
+    run_test([&d](){ // a limit stops the walk early
+        DFA<ll CM char> any = levenshtein_nfa("cat" CM 7).convert_to_compressed_dfa();
+        match_iterator<DFA<ll CM char> > all(d CM any);
+        match_iterator<DFA<ll CM char> > first(d CM any CM 2);
+        std::string w; ll state;
+        while(all.next(w CM state));
+        while(first.next(w CM state));
+        return first.count() == 2 && all.count() == 9 && first.states_visited() < all.states_visited();
+    }, true);
+
+    std::cout << "\nTesting the match iterator on random dictionaries:\n";
+    std::mt19937 rng(5);
+    for(int t = 0; t < 6; ++t){
+        std::vector<std::string> ws;
+        for(int i = 0; i < 300; ++i){
+            std::string w;
+            for(size_t n = 1 + rng() % 7; n; --n) w += "abcd"[rng() % 4];
+            ws.push_back(w);
+        }
+        dawg rd = build(ws);
+        std::string q = ws[rng() % ws.size()];
+        int error = rng() % 3;
+        run_assert([&rd CM q CM error](){return same_as_intersection(rd CM q CM error);});
+    }
+
+    std::cout << "\nTesting positions by state on a suffix tree:\n";
+    { std::ofstream of(tmp_file, std::ofstream::binary); of << "the cat sat on the mat"; }
+    suffix_tree doc;
+    doc.load_file(tmp_file, 4);
+    compressed_suffix_tree tree = doc.compress_dfa();
+    levenshtein_nfa at_nfa("at", 0);
+    for(auto acc : at_nfa.accept_states()) at_nfa.add_transition(acc, nfa_val<char>::STAR, acc); // the chunks starting with it
+    DFA<ll, char> at = at_nfa.convert_to_compressed_dfa();
+    run_test([&tree CM &at](){
+        match_iterator<compressed_suffix_tree> matches(tree CM at);
+        std::string w; ll state;
+        std::set<ll> indices;
+        while(matches.next(w CM state)){
+            if(tree.get_indices_at(state) != tree.get_indices(w)) return std::set<ll>();
+            for(ll i : tree.get_indices_at(state)) indices.insert(i);
+        }
+        return indices;
+    }, std::set<ll>{8 CM 12}); // "at s" and "at o" (indexed by their last character)
+    remove(tmp_file);
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
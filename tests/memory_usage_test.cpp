@@ -0,0 +1,151 @@
+#include "../src/data_structures/FA/memory_usage.hpp"
+#include "../src/data_structures/FA/DFA.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include "../src/data_structures/suffix_tree/suffix_tree.hpp"
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <unordered_map>
+#include <stdio.h>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+dawg build(const std::vector<std::string>& ws){
+    trie t;
+    for(const std::string& w : ws) t.insert(w);
+    DFA<ll, char> compressed = t.compress_dfa();
+    dawg d; d.build(compressed);
+    return d;
+}
+
+// The components of the memory of a structure, in the order of memory_usage_t.
+std::vector<size_t> components(const memory_usage_t& m){
+    return {m.states, m.accept, m.edges, m.defaults, m.alphabet, m.positions, m.other};
+}
+
+void run_test_suite(){
+    std::cout << "Testing the estimates of the heap:\n";
+    run_test([](){return heap_block(1);}, (size_t) 32);
+    run_test([](){return heap_block(24);}, (size_t) 32);
+    run_test([](){return heap_block(25);}, (size_t) 48);
+    run_test([](){return heap_bytes(std::string("short"));}, (size_t) 0); // kept in the string itself
+    run_test([](){return heap_bytes(std::string(100 CM 'x'));}, heap_block(101));
+    run_test([](){return heap_bytes(42);}, (size_t) 0);
+    run_test([](){std::vector<int> v; v.reserve(10); return heap_bytes(v);}, heap_block(10 * sizeof(int)));
+    run_test([](){return hash_table_bytes(std::unordered_map<ll CM ll>());}, (size_t) 0);
+    run_test([](){
+        std::unordered_map<ll CM ll> m{{1 CM 2} CM {3 CM 4}};
+        return hash_table_bytes(m) == m.bucket_count() * sizeof(void*) + 2 * heap_block(sizeof(std::pair<const ll CM ll>)
+            + sizeof(void*));
+    }, true);
+    run_test([](){ // a string key caches its hash
+        std::unordered_map<std::string CM ll> m{{"a" CM 1}};
+        return hash_table_bytes(m) - m.bucket_count() * sizeof(void*);
+    }, heap_block(sizeof(std::pair<const std::string CM ll>) + 2 * sizeof(void*)));
+    run_test([](){
+        memory_usage_t a CM b;
+        a.states = 1; a.edges = 2; b.edges = 3; b.positions = 4; b.other = 5;
+        a += b;
+        return components(a);
+    }, std::vector<size_t>{1 CM 0 CM 5 CM 0 CM 0 CM 4 CM 5});
+
+    std::cout << "\nTesting the memory of a DFA:\n";
+    run_test([](){return components(DFA<ll CM char>().memory_usage());}, std::vector<size_t>(7 CM 0));
+    DFA<ll, char> dfa;
+    dfa.add_start(0);
+    dfa.add_transition(0, 'a', 1);
+    dfa.add_transition(0, 'b', 2);
+    dfa.add_transition(1, 'c', 2);
+    dfa.add_final_state(2);
+    run_test([&dfa](){return dfa.edge_count();}, (size_t) 3);
+    run_test([&dfa](){size_t n = 0; dfa.for_each_state([&n](ll){ ++n; }); return n;}, (size_t) 3);
+    run_test([&dfa](){return dfa.memory_usage().accept;}, 3 * (sizeof(dfa_node<ll>) - sizeof(ll)));
+    run_test([&dfa](){
+        memory_usage_t m = dfa.memory_usage();
+        return m.states > 0 && m.edges > 0 && m.defaults == 0 && m.positions == 0 && m.other == 0;
+    }, true);
+    run_test([&dfa](){
+        DFA<ll CM char> more = dfa;
+        more.add_transition(2 CM 'd' CM 3);
+        more.add_default_transition(3 CM 0);
+        memory_usage_t a = dfa.memory_usage() CM b = more.memory_usage();
+        return b.states > a.states && b.edges > a.edges && b.defaults > 0;
+    }, true);
+    run_test([](){ // the names of a trie are strings, long names are on the heap
+        DFA<std::string CM char> s CM l;
+        s.add_transition("a" CM 'x' CM "b");
+        l.add_transition(std::string(40 CM 'a') CM 'x' CM std::string(40 CM 'b'));
+        return l.memory_usage().states - s.memory_usage().states;
+    }, 2 * 2 * heap_block(41)); // two names, each kept twice in the state table
+
+    std::cout << "\nTesting the memory of a DAWG and a suffix tree:\n";
+    dawg d = build({"cat", "cats", "cut", "dog"});
+    run_test([&d](){return d.memory_usage().other > 0;}, true);
+    run_test([&d](){
+        memory_usage_t m = d.memory_usage() CM base = d.DFA<ll CM char>::memory_usage();
+        m.other = 0;
+        return components(m) == components(base);
+    }, true);
+    const char* tmp_file = "memory_usage.txt";
+    {
+        std::ofstream of(tmp_file, std::ofstream::binary);
+        of << "the quick brown fox\njumps over the lazy dog\n";
+    }
+    suffix_tree st;
+    st.load_file(tmp_file, 5);
+    remove(tmp_file);
+    compressed_suffix_tree cst = st.compress_dfa();
+    run_test([&cst](){return cst.positions() > 0 && cst.memory_usage().positions >= cst.positions();}, true);
+    run_test([&st](){return st.memory_usage().positions > 0;}, true);
+    run_test([&st CM &cst](){ // the compressed tree is smaller
+        return cst.memory_usage().total() < st.memory_usage().total();
+    }, true);
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
@@ -0,0 +1,176 @@
+#include "../src/data_structures/suffix_tree/suffix_tree.hpp"
+#include "../src/data_structures/suffix_tree/pigeonhole.hpp"
+#include "../src/data_structures/FA/match_iterator.hpp"
+#include "../src/data_structures/FA/alphabet_map.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <set>
+#include <random>
+#include <functional>
+#include <stdio.h>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+const char* tmp_file = "pigeonhole.txt";
+
+// The suffix tree of the chunks of a text, relabeled with a dense alphabet (as in document_search).
+struct document {
+    std::string text;
+    ll chunk_size;
+    compressed_suffix_tree tree;
+    alphabet_map amap;
+
+    document(const std::string& text, ll chunk_size) : text(text), chunk_size(chunk_size) {
+        { std::ofstream of(tmp_file, std::ofstream::binary); of << text; }
+        suffix_tree doc;
+        doc.load_file(tmp_file, chunk_size);
+        tree = doc.compress_dfa();
+        amap = alphabet_map(tree.get_alphabet());
+        amap.apply(tree);
+        remove(tmp_file);
+    }
+};
+
+// The chunks that start with something within the error of the word, by intersecting the tree with the
+// Levenshtein automaton of the word.
+std::vector<needle_t> intersection(document& doc, const std::string& word, int error){
+    levenshtein_nfa lnfa(doc.amap.encode(word), error);
+    for(auto acc : lnfa.accept_states()) lnfa.add_transition(acc, nfa_val<char>::STAR, acc);
+    DFA<ll, char> dfa = lnfa.convert_to_compressed_dfa();
+    match_iterator<compressed_suffix_tree> matches(doc.tree, dfa);
+    std::vector<needle_t> ret;
+    std::string needle;
+    ll state;
+    while(matches.next(needle, state)) ret.push_back({needle, state});
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+std::vector<needle_t> pigeonhole(document& doc, const std::string& word, int error){
+    std::vector<needle_t> ret;
+    pigeonhole_matches(doc.tree, doc.amap, doc.text, doc.chunk_size, word, error, ret);
+    return ret;
+}
+
+// Does the pigeonhole search find the chunks of the intersection (and at least one, if `some`)?
+bool same_as_intersection(document& doc, const std::string& word, int error, bool some = false){
+    std::vector<needle_t> expected = intersection(doc, word, error);
+    return pigeonhole(doc, word, error) == expected && (!some || expected.size());
+}
+
+void run_test_suite(){
+    std::cout << "Testing the edit distance of prefixes:\n";
+    run_assert([](){return prefix_within("abc", "abcdef", 0);});
+    run_assert([](){return prefix_within("abc", "abxdef", 1);});
+    run_test([](){return prefix_within("abc", "xbxdef", 1);}, false);
+    run_assert([](){return prefix_within("abc", "bcdef", 1);});
+    run_assert([](){return prefix_within("abc", "axbc", 1);});
+    run_assert([](){return prefix_within("abc", "", 3);});
+    run_test([](){return prefix_within("abc", "", 2);}, false);
+
+    std::cout << "\nTesting the document at an offset:\n";
+    run_test([](){return document_at("hello", 1, 3);}, std::string("ell"));
+    run_test([](){return document_at("hello", 3, 4);}, std::string("lo") + (char) EOF);
+    run_test([](){return document_at("hello", 5, 2);}, std::string(1, (char) EOF));
+
+    std::cout << "\nTesting words that are too short to split:\n";
+    document small("the cat sat on the mat", 4);
+    run_test([&small](){std::vector<needle_t> n; return pigeonhole_matches(small.tree CM small.amap CM small.text CM
+        4 CM "at" CM 2 CM n);}, false);
+    run_test([&small](){std::vector<needle_t> n; return pigeonhole_matches(small.tree CM small.amap CM small.text CM
+        4 CM "at" CM -1 CM n);}, false);
+
+    std::cout << "\nTesting against the intersection:\n";
+    run_assert([&small](){return same_as_intersection(small CM "cat" CM 0 CM true);});
+    run_assert([&small](){return same_as_intersection(small CM "cat" CM 1 CM true);});
+    run_assert([&small](){return same_as_intersection(small CM "the" CM 0 CM true);});   // a candidate at offset 0
+    run_assert([&small](){return same_as_intersection(small CM "xhe" CM 1 CM true);});   // (the start is moved)
+    run_assert([&small](){return same_as_intersection(small CM "hte" CM 2 CM true);});
+    run_assert([&small](){return same_as_intersection(small CM "mat" CM 0 CM true);});   // in the last chunk
+    run_assert([&small](){return same_as_intersection(small CM "xat" CM 1 CM true);});   // a piece after it
+    run_assert([&small](){return same_as_intersection(small CM "at" CM 1 CM true);});    // k = m - 1
+    run_assert([&small](){return same_as_intersection(small CM "mxt" CM 2 CM true);});
+    run_assert([&small](){return same_as_intersection(small CM "dog" CM 0);});
+    document tail("abcdefghijklmnopqrstuvwxyz", 6);
+    run_test([&tail](){return pigeonhole(tail CM "xyz" CM 0).size();}, (size_t) 0); // no chunk starts there
+    run_assert([&tail](){return same_as_intersection(tail CM "xyz" CM 0);});
+    run_assert([&tail](){return same_as_intersection(tail CM "vwxyz" CM 2 CM true);});
+    run_assert([&tail](){return same_as_intersection(tail CM "Xwxyz" CM 1 CM true);}); // only "xyz" is found
+    run_assert([&tail](){return same_as_intersection(tail CM "zz" CM 1);});
+    run_assert([&tail](){return same_as_intersection(tail CM "az" CM 1 CM true);});
+    run_assert([&tail](){return same_as_intersection(tail CM "abd" CM 1 CM true);});
+
+    std::cout << "\nTesting random words against the intersection:\n";
+    std::mt19937 rng(38);
+    for(int t = 0; t < 12; ++t){
+        std::string text;
+        for(int i = 0; i < 80; ++i) text += "abcd "[rng() % 5];
+        document doc(text, 3 + rng() % 6);
+        bool same = true;
+        for(int w = 0; w < 40 && same; ++w){
+            ll m = 1 + rng() % 6;
+            std::string word;
+            if(rng() % 2){ // a substring of the text (the tail included), with a typo
+                ll start = rng() % (text.size() - m + 1);
+                if(rng() % 3 == 0) start = text.size() - m;
+                word = text.substr(start, m);
+                word[rng() % m] = "abcd "[rng() % 5];
+            }else{
+                for(ll i = 0; i < m; ++i) word += "abcde"[rng() % 5];
+            }
+            int error = rng() % m; // up to k = m - 1
+            same = same_as_intersection(doc, word, error);
+        }
+        run_assert([same](){return same;});
+    }
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
@@ -0,0 +1,111 @@
+#include "../src/data_structures/qgram_index.hpp"
+#include <random>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+// The (start, end, distance) of the matches.
+std::vector<std::vector<ll> > search(const qgram_index& index, std::string p, int k){
+    std::vector<std::vector<ll> > ret;
+    for(qgram_match m : index.search(p, k)) ret.push_back({m.start, m.end, m.distance});
+    return ret;
+}
+
+// Is there a substring that ends at `end` and is within k edits of the pattern (brute force)?
+int best_ending_at(const std::string& text, std::string p, ll end){
+    size_t m = p.size();
+    std::vector<int> prev(m + 1), cur(m + 1);
+    for(size_t i = 0; i <= m; ++i) prev[i] = i;
+    int best = prev[m];
+    for(ll s = end - 1; s >= 0; --s){ // prepend text[s]
+        cur[0] = end - s;
+        for(size_t i = 1; i <= m; ++i)
+            cur[i] = std::min(std::min(prev[i] + 1, cur[i - 1] + 1), prev[i - 1] + (p[m - i] != text[s]));
+        prev.swap(cur);
+        best = std::min(best, prev[m]);
+    }
+    return best;
+}
+
+void run_test_suite(){
+    std::string text = "the quick brown fox\njumps over the lazy dog\nthe quick brown fax jumps\n";
+    qgram_index index(text, 3);
+
+    std::cout << "Testing q-gram searches:\n";
+    run_test([](){return qgram_index::threshold(20 CM 2 CM 4);}, (ll) 9);
+    run_test([&index](){return search(index CM "quick brown fox" CM 0);}, std::vector<std::vector<ll> >{{4 CM 19 CM 0}});
+    run_test([&index](){return search(index CM "quick brown fox" CM 1);},
+        std::vector<std::vector<ll> >{{4 CM 19 CM 0} CM {48 CM 63 CM 1}});
+    run_test([&index](){return search(index CM "over the lazy cat" CM 3).size();}, (size_t) 1);
+    run_test([&index](){return search(index CM "nothing like this at all" CM 2).size();}, (size_t) 0);
+    run_test([&index](){return index.line_col(0) == std::pair<ll CM ll>{1 CM 1} && index.line_col(25) == std::pair<ll CM ll>{2 CM 6};}, true);
+
+    std::cout << "\nTesting q-gram searches against a scan of the whole text:\n";
+    std::mt19937 rng(7);
+    std::string random_text;
+    for(int i = 0; i < 20000; ++i) random_text += "abcd"[rng() % 4];
+    qgram_index filtered(random_text, 4), unfiltered(random_text, 64); // the threshold of the latter is never positive
+    for(int t = 0; t < 12; ++t){
+        size_t m = 20 + rng() % 40; int k = rng() % 4;
+        ll at = rng() % (random_text.size() - m);
+        std::string p = random_text.substr(at, m);
+        for(int e = 0; e < k; ++e) p[rng() % p.size()] = "abcd"[rng() % 4];
+        run_assert([&filtered CM &unfiltered CM p CM k](){return search(filtered CM p CM k) == search(unfiltered CM p CM k);});
+        run_assert([&filtered CM &random_text CM p CM k](){
+            for(qgram_match m : filtered.search(p CM k)){
+                if(best_ending_at(random_text CM p CM m.end) != m.distance) return false;
+            }
+            return filtered.search(p CM k).size() > 0;
+        });
+    }
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
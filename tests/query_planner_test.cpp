@@ -0,0 +1,201 @@
+#include "../src/data_structures/query_planner.hpp"
+#include "../src/data_structures/neighbourhood.hpp"
+#include "../src/data_structures/deletion_index.hpp"
+#include "../src/data_structures/FA/match_iterator.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <random>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+dawg build(const std::vector<std::string>& ws){
+    trie t;
+    for(const std::string& w : ws) t.insert(w);
+    DFA<ll, char> compressed = t.compress_dfa();
+    dawg d; d.build(compressed);
+    return d;
+}
+
+std::vector<double> nodes(const index_stats& s){
+    std::vector<double> ret;
+    for(size_t d = 0; d <= s.depth(); ++d) ret.push_back(s.nodes_at(d));
+    return ret;
+}
+
+// The statistics of the sorted words.
+index_stats sorted_stats(std::vector<std::string> ws, size_t alphabet){
+    std::sort(ws.begin(), ws.end());
+    return index_stats(ws.size(), [&ws](size_t i){ return ws[i]; }, alphabet);
+}
+
+// Is the neighbourhood the strings (of at most length + error characters over the alphabet) within the error?
+bool same_as_brute_force(const std::string& word, int error, int sigma){
+    std::unordered_set<std::string> got;
+    std::string w = word;
+    edit_neighbourhood(w, error, sigma, got);
+    std::set<std::string> expected;
+    std::function<void(std::string&)> all = [&](std::string& s){
+        if(deletion_index::within(s, word, error)) expected.insert(s);
+        if(s.size() == word.size() + error) return;
+        for(int c = 0; c < sigma; ++c){
+            s.push_back((char) c);
+            all(s);
+            s.pop_back();
+        }
+    };
+    std::string s;
+    all(s);
+    return std::set<std::string>(got.begin(), got.end()) == expected;
+}
+
+// Does a neighbourhood search find the words of the automaton, in the same order?
+bool same_as_automaton(dawg& d, const std::string& q, int error, int sigma){
+    DFA<ll, char> lev = levenshtein_nfa(q, error).convert_to_compressed_dfa();
+    match_iterator<DFA<ll, char> > matches(d, lev);
+    std::vector<std::string> expected;
+    std::string w; ll state;
+    while(matches.next(w, state)) expected.push_back(w);
+    return neighbourhood_matches(q, error, sigma, [&d](const std::string& s){ return d.contains(s); }) == expected;
+}
+
+void run_test_suite(){
+    std::cout << "Testing the statistics of a dictionary:\n";
+    dawg d = build({"cat", "cats", "cut", "dog"});
+    index_stats stats(d, 26);
+    run_test([&stats](){return nodes(stats);}, std::vector<double>{1 CM 2 CM 3 CM 3 CM 1});
+    run_test([&stats](){return stats.words();}, 4.0);
+    run_test([&stats](){return stats.words_of_length(3);}, 3.0);
+    run_test([&stats](){return stats.fanout(0);}, 2.0);
+    run_test([&stats](){return stats.nodes_at(9);}, 0.0);
+    run_test([](){ // the states of a DAWG are shared by the prefixes ("ab" and "cb" end at the same state)
+        dawg shared = build({"ab" CM "abc" CM "cb" CM "cbc"});
+        return nodes(index_stats(shared CM 3));
+    }, std::vector<double>{1 CM 2 CM 2 CM 2});
+    run_test([&stats](){return nodes(sorted_stats({"dog" CM "cut" CM "cats" CM "cat"} CM 26)) == nodes(stats);}, true);
+    run_test([](){return sorted_stats({"ab" CM "ab" CM "ac"} CM 3).words();}, 2.0);
+    run_test([](){return index_stats(26).empty() && index_stats(26).depth() == 0;}, true);
+
+    std::cout << "\nTesting the neighbourhood of a word:\n";
+    run_assert([](){return same_as_brute_force(std::string{0 CM 1} CM 1 CM 2);});
+    run_assert([](){return same_as_brute_force(std::string{0 CM 1 CM 2} CM 2 CM 3);});
+    run_assert([](){return same_as_brute_force(std::string() CM 2 CM 2);});
+    run_test([](){
+        std::unordered_set<std::string> got;
+        std::string w{0 CM 1};
+        edit_neighbourhood(w CM 0 CM 2 CM got);
+        return got.size();
+    }, (size_t) 1);
+    std::mt19937 rng(7);
+    std::vector<std::string> words;
+    for(int i = 0; i < 200; ++i){
+        std::string w;
+        for(int j = 1 + rng() % 6; j > 0; --j) w += (char) (rng() % 4);
+        words.push_back(w);
+    }
+    dawg rd = build(words);
+    for(int i = 0; i < 10; ++i){
+        std::string q = words[rng() % words.size()];
+        int error = rng() % 3;
+        run_assert([&rd CM q CM error](){return same_as_automaton(rd CM q CM error CM 4);});
+    }
+
+    std::cout << "\nTesting the query planner:\n";
+    index_stats big = sorted_stats(words, 4);
+    query_planner planner(big);
+    run_test([&planner](){return planner.plan(4 CM 0).strategy;}, search_strategy::exact);
+    run_test([&planner](){return planner.plan(3 CM 1).costs.size();}, (size_t) 2); // neighbourhood and automaton
+    run_test([&planner](){ // every string of the alphabet is a neighbour, the walk is cheaper
+        index_stats wide(sorted_stats(std::vector<std::string>{"abcdefghijkl"} CM 200));
+        return query_planner(wide).plan(12 CM 2).strategy;
+    }, search_strategy::automaton);
+    run_test([&big](){
+        query_planner indexed(big);
+        indexed.use_deletion_index(2 CM 7 CM 0.5);
+        std::vector<search_strategy> ret;
+        for(auto c : indexed.plan(5 CM 2).costs) ret.push_back(c.first);
+        for(auto c : indexed.plan(5 CM 3).costs) ret.push_back(c.first); // more than the index allows
+        return ret;
+    }, std::vector<search_strategy>{search_strategy::neighbourhood CM search_strategy::deletion_index CM
+        search_strategy::automaton CM search_strategy::neighbourhood CM search_strategy::automaton});
+    run_test([&big](){ // the chunks of a document: no exact lookup or neighbourhood, no partition of a short word
+        query_planner chunks(big);
+        chunks.match_prefixes();
+        chunks.use_partition(6 CM 1000);
+        return chunks.plan(1 CM 1).costs.size() == 1 && chunks.plan(4 CM 1).costs.size() == 2
+            && chunks.plan(4 CM 0).costs[0].first == search_strategy::partition;
+    }, true);
+    run_test([&big](){ // only the automaton counts code points (an exact query is the same in bytes)
+        query_planner utf8(big);
+        utf8.use_deletion_index(2 CM 7 CM 0.5);
+        utf8.use_partition(6 CM 1000);
+        utf8.count_code_points();
+        return utf8.plan(5 CM 1).costs.size() == 1 && utf8.plan(5 CM 1).strategy == search_strategy::automaton
+            && utf8.plan(5 CM 0).costs.size() == 3;
+    }, true);
+    run_test([&planner](){ // the cheapest
+        query_plan plan = planner.plan(6 CM 2);
+        for(auto c : plan.costs) if(c.second < plan.cost) return false;
+        return true;
+    }, true);
+    run_test([](){
+        plan_tally tally;
+        tally.add(search_strategy::automaton);
+        tally.add(search_strategy::exact);
+        tally.add(search_strategy::automaton);
+        return tally.summary();
+    }, std::string("1 exact, 2 automaton"));
+    run_test([](){return plan_tally().summary();}, std::string("none"));
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
@@ -0,0 +1,179 @@
+#include "../src/data_structures/radix_trie.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include "../src/data_structures/typeahead.hpp"
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+std::vector<std::string> words_of(const radix_trie& t){
+    std::vector<std::string> ret;
+    t.for_each_word([&ret](const std::string& w){ ret.push_back(w); });
+    return ret;
+}
+
+std::set<std::string> automaton_search(dawg& d, std::string q, int k){
+    DFA<ll, char> lnfa = levenshtein_nfa(q, k).convert_to_dfa().compress_dfa();
+    std::set<std::string> ret;
+    for(std::vector<char> r : d.intersection(lnfa).compress_dfa().accept_paths()) ret.insert(std::string(r.begin(), r.end()));
+    return ret;
+}
+
+std::set<std::string> radix_search(const radix_trie& t, std::string q, int k){
+    DFA<ll, char> lnfa = levenshtein_nfa(q, k).convert_to_dfa().compress_dfa();
+    std::vector<std::string> found = t.search(lnfa);
+    return std::set<std::string>(found.begin(), found.end());
+}
+
+// Does a typeahead session on the radix trie find the same words as one on the DAWG, keystroke by keystroke?
+bool typeahead_matches(dawg& d, const radix_trie& t, std::string prefix, int k){
+    typeahead_session<ll> on_dawg(d, k);
+    typeahead_session<ll, const radix_trie> on_radix(t, k);
+    for(size_t i = 1; i <= prefix.size(); ++i){
+        on_dawg.set_query(prefix.substr(0, i));
+        on_radix.set_query(prefix.substr(0, i));
+        if(on_dawg.matches(10) != on_radix.matches(10)) return false;
+    }
+    return true;
+}
+
+// Does walking the word one character at a time end in an accept state?
+bool walk(const radix_trie& t, std::string s){
+    ll v = t.get_start();
+    for(char c : s){
+        if(!t.has_transition(v, c)) return false;
+        v = t.next_state(v, c);
+    }
+    return t.is_accept(v);
+}
+
+void run_test_suite(){
+    std::vector<std::string> ws = {"howdy", "rowdy", "hoody", "how", "hello", "yellow", "a", "ab", "abc", "kitten",
+        "sitting", "mitten", "smitten", "howdies", "rowdies"};
+    trie words;
+    for(std::string w : ws) words.insert(w);
+    DFA<ll, char> compressed = words.compress_dfa();
+    dawg d;
+    d.build(compressed);
+    radix_trie t(d);
+    std::set<std::string> sorted(ws.begin(), ws.end());
+
+    std::cout << "Testing the radix trie of a DAWG:\n";
+    run_test([&t](){return words_of(t);}, std::vector<std::string>(sorted.begin() CM sorted.end()));
+    run_test([&t](){return t.size();}, (size_t) 21); // 15 words, and the branches at "h", "ho", "howd", "rowd" and "s"
+    run_test([&t](){return t.contains("howdy") && t.contains("a") && !t.contains("howd") && !t.contains("");}, true);
+    run_test([&t](){return walk(t CM "howdies") && walk(t CM "ab") && !walk(t CM "howdie") && !walk(t CM "kit");}, true);
+    run_test([&t](){return t.has_transition(t.get_start() CM 'z');}, false);
+    run_test([&t](){ll mid = t.next_state(t.get_start() CM 'k'); return !t.is_accept(mid) && mid != t.get_start();}, true);
+    run_test([](){radix_trie empty; return empty.size() == 1 && !empty.contains("") && words_of(empty).empty();}, true);
+
+    std::cout << "\nTesting the label pool:\n";
+    run_assert([&t](){return t.pool_size() < 60;}); // "itten" and "owd" are shared
+    run_test([](){trie one; one.insert("abcdef"); DFA<ll CM char> c = one.compress_dfa(); radix_trie r(c);
+        return r.size() == 2 && r.pool_size() == 6;}, true);
+
+    std::cout << "\nTesting Levenshtein searches on the radix trie:\n";
+    std::vector<std::string> queries = {"howdy", "hwody", "yello", "b", "kitten", "sittin", "rowdie"};
+    for(int k = 0; k <= 2; ++k){
+        for(std::string q : queries){
+            run_assert([&t CM &d CM q CM k](){return radix_search(t CM q CM k) == automaton_search(d CM q CM k);});
+        }
+    }
+    run_test([&t](){DFA<ll CM char> lnfa = levenshtein_nfa("kitten" CM 0).convert_to_dfa().compress_dfa();
+        size_t followed; t.search(lnfa CM &followed); return followed;}, (size_t) 1); // "kitten" is a single edge
+
+    std::cout << "\nTesting limited searches on the radix trie:\n";
+    run_assert([&t](){ // the first words of the whole search, and the search stops there
+        DFA<ll CM char> lnfa = levenshtein_nfa("howdy" CM 2).convert_to_dfa().compress_dfa();
+        size_t all_followed = 0 CM followed = 0;
+        std::vector<std::string> all = t.search(lnfa CM &all_followed) CM first = t.search(lnfa CM &followed CM 2);
+        return all.size() > 3 && first == std::vector<std::string>(all.begin() CM all.begin() + 2)
+            && followed < all_followed;
+    });
+    run_assert([&t](){
+        DFA<ll CM char> lnfa = levenshtein_nfa("howdy" CM 2).convert_to_dfa().compress_dfa();
+        return t.search(lnfa CM NULL CM 100) == t.search(lnfa);
+    });
+    run_assert([&t CM &d](){ // every node knows its state in the DAWG
+        DFA<ll CM char> lnfa = levenshtein_nfa("mitten" CM 2).convert_to_dfa().compress_dfa();
+        bool same = true;
+        size_t found = 0;
+        t.for_each_match(lnfa CM [&](const std::string& w CM uint32_t node){
+            same = same && t.origin(node) == d.follow(w);
+            ++found;
+        });
+        return same && found == 3;
+    });
+
+    std::cout << "\nTesting typeahead on the radix trie:\n";
+    run_assert([&t CM &d](){return typeahead_matches(d CM t CM "howdi" CM 1);});
+    run_assert([&t CM &d](){return typeahead_matches(d CM t CM "smiten" CM 2);});
+
+    std::cout << "\nTesting radix trie persistence:\n";
+    std::stringstream ss;
+    t.save(ss);
+    radix_trie loaded;
+    run_test([&loaded CM &ss](){return loaded.load(ss);}, true);
+    run_test([&loaded CM &t](){return words_of(loaded) == words_of(t) && loaded.size() == t.size();}, true);
+    run_test([](){std::stringstream bad("not a trie"); radix_trie r; return r.load(bad);}, false);
+    run_assert([&loaded](){ // (a loaded trie has no dictionary)
+        try{
+            loaded.origin(0);
+        }catch(const std::runtime_error&){
+            return true;
+        }
+        return false;
+    });
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
@@ -0,0 +1,242 @@
+#include "../src/data_structures/shards.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/typeahead.hpp"
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include "../src/data_structures/FA/match_iterator.hpp"
+#include "../src/data_structures/FA/alphabet_map.hpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <random>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+// A dictionary split into shards (as in word_search): every shard has its own alphabet and weighted DAWG.
+struct sharded {
+    std::vector<alphabet_map> amaps;
+    std::vector<dawg> dicts;
+
+    sharded(const std::vector<std::pair<std::string, ll> >& words, size_t n) : amaps(n), dicts(n) {
+        std::vector<std::string> alphabets(n);
+        for(auto& w : words) alphabets[shard_of(w.first, n)] += w.first;
+        for(size_t i = 0; i < n; ++i) amaps[i] = alphabet_map(alphabets[i]);
+        for(auto& w : words){
+            size_t i = shard_of(w.first, n);
+            dicts[i].insert(amaps[i].encode(w.first), w.second);
+        }
+    }
+
+    size_t size() const {
+        return dicts.size();
+    }
+
+    // Adds a word (`+WORD`): its new bytes get the next symbols of its shard.
+    void add(const std::string& word, ll weight){
+        size_t i = shard_of(word, size());
+        for(char c : word) amaps[i].add(c);
+        dicts[i].insert(amaps[i].encode(word), weight);
+    }
+
+    DFA<ll, char> lnfa(size_t i, const std::string& word, int error){
+        return levenshtein_nfa(amaps[i].encode(word), error).convert_to_compressed_dfa();
+    }
+
+    // The words within the error of the word, the first `limit` of them (`WORD N LIMIT M`).
+    std::vector<std::string> matches(const std::string& word, int error, size_t limit){
+        std::vector<std::vector<std::string> > found(size());
+        for(size_t i = 0; i < size(); ++i){
+            DFA<ll, char> lev = lnfa(i, word, error);
+            found[i] = first_words(amaps[i], limit, [&](size_t n){
+                std::vector<std::string> ret;
+                match_iterator<DFA<ll, char> > it(dicts[i], lev, n);
+                std::string match; ll state;
+                while(it.next(match, state)) ret.push_back(amaps[i].decode(match));
+                return ret;
+            });
+        }
+        return merge_words(found, limit);
+    }
+
+    // The k heaviest words within the error of the word (`#WORD N`).
+    std::vector<std::pair<std::string, ll> > ranked(const std::string& word, int error, size_t k){
+        std::vector<std::vector<std::pair<std::string, ll> > > found(size());
+        for(size_t i = 0; i < size(); ++i){
+            DFA<ll, char> lev = lnfa(i, word, error);
+            found[i] = first_answers(amaps[i], k, [&](size_t n){ return dicts[i].top_k(lev, n); });
+        }
+        return merge_ranked(found, k);
+    }
+
+    // The k closest words that start with a prefix within the error of the prefix (`~PREFIX N`).
+    std::vector<std::pair<std::string, int> > closest(const std::string& prefix, int error, size_t k){
+        std::vector<std::vector<std::pair<std::string, int> > > found(size());
+        for(size_t i = 0; i < size(); ++i){
+            typeahead_session<ll> session(dicts[i], error);
+            session.set_query(amaps[i].encode(prefix));
+            found[i] = first_answers(amaps[i], k, [&](size_t n){ return session.matches(n); });
+        }
+        return merge_closest(found, k);
+    }
+};
+
+// Random words over a small alphabet, with few distinct weights (so that there are many ties).
+std::vector<std::pair<std::string, ll> > random_words(std::mt19937& rng, size_t n){
+    std::set<std::string> seen;
+    std::vector<std::pair<std::string, ll> > ret;
+    while(ret.size() < n){
+        std::string w;
+        for(size_t len = 1 + rng() % 6; w.size() < len; ) w += "abcdex"[rng() % 6];
+        if(seen.insert(w).second) ret.push_back({w, (ll) (rng() % 4)});
+    }
+    return ret;
+}
+
+void run_test_suite(){
+    std::cout << "Testing the shard of a word:\n";
+    run_test([](){return shard_of("" CM 7);}, (size_t) (1469598103934665603ull % 7));
+    run_test([](){return shard_of("hello" CM 1);}, (size_t) 0);
+    run_assert([](){ // every shard gets words
+        std::set<size_t> used;
+        for(int i = 0; i < 100; ++i) used.insert(shard_of("w" + std::to_string(i) CM 4));
+        return used.size() == 4;
+    });
+
+    std::cout << "\nTesting the merges:\n";
+    run_test([](){return merge_words({{"b" CM "d"} CM {"a" CM "c" CM "e"}} CM 4);},
+        std::vector<std::string>{"a" CM "b" CM "c" CM "d"});
+    run_test([](){return merge_words({{"b" CM "a"}});}, std::vector<std::string>{"a" CM "b"}); // one shard is sorted
+    run_test([](){return merge_ranked({{{"bb" CM 5} CM {"c" CM 2}} CM {{"a" CM 5} CM {"ab" CM 5}}} CM 3);},
+        std::vector<std::pair<std::string CM ll> >{{"a" CM 5} CM {"ab" CM 5} CM {"bb" CM 5}});
+    run_test([](){return merge_closest({{{"abc" CM 1} CM {"b" CM 1}} CM {{"zz" CM 0} CM {"ab" CM 1}}} CM 3);},
+        std::vector<std::pair<std::string CM int> >{{"zz" CM 0} CM {"b" CM 1} CM {"ab" CM 1}});
+
+    std::cout << "\nTesting shards against the whole dictionary:\n";
+    std::mt19937 rng(40);
+    std::vector<std::pair<std::string, ll> > words = random_words(rng, 600);
+    sharded whole(words, 1);
+    for(size_t n : {2 CM 3 CM 5}){
+        sharded parts(words, n);
+        bool same_limit = true, same_ranked = true, same_closest = true;
+        for(int t = 0; t < 40; ++t){
+            std::string q;
+            for(size_t len = 1 + rng() % 5; q.size() < len; ) q += "abcdey"[rng() % 6];
+            int error = rng() % 3;
+            size_t limit = rng() % 12;
+            same_limit = same_limit && parts.matches(q, error, limit) == whole.matches(q, error, limit);
+            same_ranked = same_ranked && parts.ranked(q, error, 10) == whole.ranked(q, error, 10);
+            same_closest = same_closest && parts.closest(q, error, 10) == whole.closest(q, error, 10);
+        }
+        run_assert([same_limit](){return same_limit;});     // WORD N LIMIT M (and WORD N, for a limit of 0)
+        run_assert([same_ranked](){return same_ranked;});   // #WORD N
+        run_assert([same_closest](){return same_closest;}); // ~PREFIX N
+    }
+
+    std::cout << "\nTesting shards after a byte is added:\n";
+    run_assert([](){ // a byte below the alphabet takes the last symbol
+        alphabet_map amap(std::string("bc"));
+        bool before = amap.byte_ordered();
+        amap.add('d');
+        bool after_larger = amap.byte_ordered();
+        amap.add('a');
+        return before && after_larger && !amap.byte_ordered() && amap.encode(std::string("a")) > amap.encode("b");
+    });
+    std::set<std::string> known;
+    for(auto& w : words) known.insert(w.first);
+    std::vector<std::pair<std::string, ll> > added; // (with bytes that sort before the rest of the alphabet)
+    while(added.size() < 60){
+        std::string w;
+        for(size_t len = 1 + rng() % 5; w.size() < len; ) w += "AB0abc"[rng() % 6];
+        if(known.insert(w).second) added.push_back({w, (ll) (rng() % 4)});
+    }
+    std::vector<std::pair<std::string, ll> > all = words;
+    all.insert(all.end(), added.begin(), added.end());
+    sharded fresh(all, 1); // the same words, with the symbols in byte order
+    for(size_t n : {1 CM 2 CM 3 CM 5}){
+        sharded parts(words, n);
+        for(auto& w : added) parts.add(w.first, w.second);
+        bool same_limit = true, same_ranked = true, same_closest = true;
+        for(int t = 0; t < 40; ++t){
+            std::string q;
+            for(size_t len = 1 + rng() % 4; q.size() < len; ) q += "AB0abc"[rng() % 6];
+            int error = rng() % 3;
+            size_t limit = 1 + rng() % 8;
+            same_limit = same_limit && parts.matches(q, error, limit) == fresh.matches(q, error, limit);
+            same_ranked = same_ranked && parts.ranked(q, error, 5) == fresh.ranked(q, error, 5);
+            same_closest = same_closest && parts.closest(q, error, 5) == fresh.closest(q, error, 5);
+        }
+        run_assert([same_limit](){return same_limit;});     // WORD N LIMIT M
+        run_assert([same_ranked](){return same_ranked;});   // #WORD N
+        run_assert([same_closest](){return same_closest;}); // ~PREFIX N
+    }
+
+    std::cout << "\nTesting the order of a single dictionary:\n";
+    run_assert([&whole](){ // the ties of the heaviest words are broken by length, then by bytes
+        std::vector<std::pair<std::string CM ll> > r = whole.ranked("abc" CM 2 CM 50);
+        for(size_t i = 1; i < r.size(); ++i){
+            if(r[i - 1].second < r[i].second) return false;
+            if(r[i - 1].second == r[i].second && !shorter_word(r[i - 1].first CM r[i].first)) return false;
+        }
+        return r.size() == 50;
+    });
+    run_assert([&whole](){ // the closest words: by distance, then by length, then by bytes
+        std::vector<std::pair<std::string CM int> > r = whole.closest("ab" CM 1 CM 60);
+        for(size_t i = 1; i < r.size(); ++i){
+            if(r[i - 1].second > r[i].second) return false;
+            if(r[i - 1].second == r[i].second && !shorter_word(r[i - 1].first CM r[i].first)) return false;
+        }
+        return r.size() == 60;
+    });
+    run_assert([&whole](){ // the matches: in byte order
+        std::vector<std::string> r = whole.matches("abc" CM 2 CM 0);
+        return r.size() > 20 && std::is_sorted(r.begin() CM r.end());
+    });
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
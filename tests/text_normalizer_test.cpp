@@ -0,0 +1,126 @@
+#include "../src/data_structures/text_normalizer.hpp"
+#include <string>
+#include <iostream>
+#include <vector>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+text_normalizer steps(const std::vector<std::string>& names){
+    text_normalizer n;
+    for(const std::string& s : names) n.enable(s);
+    return n;
+}
+
+void run_test_suite(){
+    // the steps
+    run_assert([](){return text_normalizer().identity();});
+    run_test([](){return text_normalizer().suffix();}, std::string(""));
+    run_test([](){text_normalizer n; return n.enable("case") && !n.identity();}, true);
+    run_test([](){text_normalizer n; return n.enable("Case");}, false);
+    run_test([](){text_normalizer n; n.enable("bogus"); return n.identity();}, true);
+    run_test([](){return steps({"punct" CM "case"}).suffix();}, std::string(".case-punct"));
+    run_test([](){return steps({"case" CM "space" CM "punct"}).suffix();}, std::string(".case-space-punct"));
+
+    // no steps
+    run_test([](){return text_normalizer().apply("Lorem,  Ipsum\n");}, std::string("Lorem,  Ipsum\n"));
+
+    // case folding
+    run_test([](){return steps({"case"}).apply("Lorem IPSUM 42 @Z[");}, std::string("lorem ipsum 42 @z["));
+    run_test([](){return steps({"case"}).apply("\xC3\x89t\xC3\xA9");}, std::string("\xC3\x89t\xC3\xA9"));
+
+    // whitespace collapsing
+    run_test([](){return steps({"space"}).apply("a \t\n b\r\nc  ");}, std::string("a b c "));
+    run_test([](){return steps({"space"}).apply("a, \n ,b");}, std::string("a, ,b"));
+
+    // punctuation stripping
+    run_test([](){return steps({"punct"}).apply("\"Hello,\" (world)! a-b_c");}, std::string("Hello world abc"));
+    run_test([](){return steps({"punct"}).apply("a  b");}, std::string("a  b"));
+
+    // all of them (the whitespace around stripped punctuation is one run)
+    run_test([](){return steps({"case" CM "space" CM "punct"}).apply("Lorem ,\n Ipsum. Dolor");},
+        std::string("lorem ipsum dolor"));
+    run_test([](){return steps({"space" CM "punct"}).apply("a - - b");}, std::string("a b"));
+
+    // origins
+    run_test([](){
+        std::vector<ll> origins;
+        steps({"case"}).apply("AbC" CM &origins);
+        return origins;
+    }, std::vector<ll>({0 CM 1 CM 2 CM 3}));
+    run_test([](){
+        std::vector<ll> origins;
+        steps({"space" CM "punct"}).apply("a, \n b." CM &origins);
+        return origins;
+    }, std::vector<ll>({0 CM 2 CM 5 CM 7}));
+    run_test([](){
+        std::vector<ll> origins;
+        text_normalizer().apply("" CM &origins);
+        return origins;
+    }, std::vector<ll>({0}));
+    run_test([](){ // the origins are reset
+        std::vector<ll> origins = {7 CM 7};
+        steps({"punct"}).apply("!a" CM &origins);
+        return origins;
+    }, std::vector<ll>({1 CM 2}));
+    run_assert([](){ // every byte maps back to the byte it came from (case aside)
+        std::string text = "The  Quick,\tBrown -- fox.\n\nJumps";
+        std::vector<ll> origins;
+        std::string norm = steps({"case" CM "space" CM "punct"}).apply(text CM &origins);
+        if(origins.size() != norm.size() + 1 || origins.back() != (ll) text.size()) return false;
+        for(size_t i = 0; i < norm.size(); ++i){
+            char c = text[origins[i]];
+            if(c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+            if(c == '\t' || c == '\n') c = ' ';
+            if(c != norm[i]) return false;
+            if(i && origins[i] <= origins[i - 1]) return false;
+        }
+        return true;
+    });
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
@@ -0,0 +1,130 @@
+#include "../src/data_structures/typeahead.hpp"
+#include "../src/data_structures/trie.hpp"
+#include <string>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <functional>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+int edit_distance(const std::string& a, const std::string& b){
+    std::vector<std::vector<int> > dp(a.size() + 1, std::vector<int>(b.size() + 1));
+    for(size_t i = 0; i <= a.size(); ++i) dp[i][0] = i;
+    for(size_t j = 0; j <= b.size(); ++j) dp[0][j] = j;
+    for(size_t i = 1; i <= a.size(); ++i)
+        for(size_t j = 1; j <= b.size(); ++j)
+            dp[i][j] = std::min(std::min(dp[i-1][j], dp[i][j-1]) + 1, dp[i-1][j-1] + (a[i-1] != b[j-1]));
+    return dp[a.size()][b.size()];
+}
+
+// The (word, distance) pairs of the words that have a prefix within k edits of the query, where the distance
+// is the smallest edit distance between the query and a prefix of the word.
+std::set<std::pair<std::string, int> > brute_force(const std::vector<std::string>& ws, std::string q, int k){
+    std::set<std::pair<std::string, int> > ret;
+    for(std::string w : ws){
+        int best = k + 1;
+        for(size_t len = 0; len <= w.size(); ++len) best = std::min(best, edit_distance(w.substr(0, len), q));
+        if(best <= k) ret.insert({w, best});
+    }
+    return ret;
+}
+
+template <typename N>
+std::set<std::pair<std::string, int> > session_matches(typeahead_session<N>& s){
+    std::set<std::pair<std::string, int> > ret;
+    for(auto m : s.matches()) ret.insert(m);
+    return ret;
+}
+
+// Are the matches ordered by (distance, length)?
+template <typename N>
+bool ordered(typeahead_session<N>& s){
+    std::vector<std::pair<std::string, int> > ms = s.matches();
+    for(size_t i = 1; i < ms.size(); ++i){
+        if(ms[i-1].second > ms[i].second) return false;
+        if(ms[i-1].second == ms[i].second && ms[i-1].first.size() > ms[i].first.size()) return false;
+    }
+    return true;
+}
+
+void run_test_suite(){
+    std::vector<std::string> ws = {"how", "howdy", "hello", "help", "hold", "cow", "cowboy", "show", "shower",
+        "h", "howl", "yellow", "bellow", "a"};
+    trie t;
+    for(std::string w : ws) t.insert(w);
+    DFA<ll, char> dict = t.compress_dfa();
+
+    std::cout << "Testing typeahead keystrokes:\n";
+    typeahead_session<ll> s(dict, 1);
+    run_test([&](){return session_matches(s);}, brute_force(ws, "", 1));
+    std::string typed = "howdy";
+    for(char c : typed){
+        s.push(c);
+        run_test([&](){return session_matches(s);}, brute_force(ws, s.get_query(), 1));
+    }
+    run_test([&](){return s.matches(1);}, std::vector<std::pair<std::string CM int> >{{"howdy" CM 0}});
+    run_assert([&](){return ordered(s);});
+
+    std::cout << "\nTesting typeahead backspaces:\n";
+    run_test([&](){return s.pop() && s.pop() && s.get_query() == "how";}, true);
+    run_test([&](){return session_matches(s);}, brute_force(ws, "how", 1));
+    run_test([&](){return s.matches(2);}, std::vector<std::pair<std::string CM int> >{{"how" CM 0} CM {"howl" CM 0}});
+    run_test([&](){s.set_query(""); return s.pop();}, false);
+
+    std::cout << "\nTesting typeahead against a brute force search:\n";
+    std::vector<std::string> queries = {"hwo", "shw", "yel", "cowby", "xyz", "ab", "helpp", "bello"};
+    for(int k = 0; k <= 2; ++k){
+        typeahead_session<ll> session(dict, k);
+        for(std::string q : queries){
+            session.set_query(q);
+            run_assert([&](){return session_matches(session) == brute_force(ws, q, k) && ordered(session);});
+        }
+    }
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}
@@ -0,0 +1,160 @@
+#include "../src/data_structures/levenshtein_nfa.hpp"
+#include "../src/data_structures/FA/alphabet_map.hpp"
+#include "../src/data_structures/FA/match_iterator.hpp"
+#include "../src/data_structures/dawg.hpp"
+#include "../src/data_structures/trie.hpp"
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+
+#define run_test(fn, eo) run_test_fn(fn, eo, #fn, #eo)
+#define run_assert(fn)   run_test_fn(fn, true, #fn, "true")
+#define CM               ,
+
+int test_number = 1;
+int failed_tests = 0;
+std::vector<int> failed_test_numbers = {};
+template <class T, class Callable>
+void run_test_fn(Callable fn, T expected_output, std::string str_fn, std::string str_eo){
+    std::cout << "Test #" << test_number++ << ": ";
+    T result = fn();
+    if(result == expected_output){
+        std::cout << "[PASS]";
+    }else{
+        std::cout << "[FAIL]\n";
+        std::cout << " - TEST INPUTS: " << str_fn << " == " << str_eo;
+        failed_tests += 1;
+        failed_test_numbers.push_back(test_number - 1);
+    }
+    std::cout << "\n";
+}
+
+void print_test_results(){
+    std::cout << "\n\nTest Results:\n";
+    std::cout << "# of tests run: " << test_number - 1 << "\n";
+    std::cout << "# of failed tests: " << failed_tests << "\n";
+}
+
+namespace std{
+  template <typename T> struct hash<std::vector<T> >
+  {
+    size_t operator()(const std::vector<T>& x) const
+    {
+      size_t tot = 0;
+      for(T a : x){
+        tot = tot * 31 + a;
+      }
+      return tot;
+    }
+  };
+}
+
+// The edit distance between the code points of the strings.
+int code_point_distance(const std::string& a, const std::string& b){
+    std::vector<std::string> x = utf8_code_points(a), y = utf8_code_points(b);
+    std::vector<int> col(y.size() + 1);
+    for(size_t j = 0; j <= y.size(); ++j) col[j] = j;
+    for(size_t i = 1; i <= x.size(); ++i){
+        int diag = col[0]++;
+        for(size_t j = 1; j <= y.size(); ++j){
+            int up = col[j];
+            col[j] = std::min(std::min(col[j] + 1, col[j - 1] + 1), diag + (x[i - 1] != y[j - 1]));
+            diag = up;
+        }
+    }
+    return col.back();
+}
+
+const std::vector<std::string> letters = {"a", "b", "\xC3\xA9", "\xC3\x9F", "\xE2\x82\xAC", "\xF0\x9D\x84\x9E"};
+
+std::string random_word(std::mt19937& rng, size_t max_length){
+    std::string ret;
+    for(size_t i = rng() % (max_length + 1); i > 0; --i) ret += letters[rng() % letters.size()];
+    return ret;
+}
+
+// Does the automaton accept exactly the words within the error (in code points)?
+bool same_as_distance(const std::string& q, int error, const std::vector<std::string>& words){
+    DFA<ll, char> lev = utf8_levenshtein_nfa(q, error).convert_to_compressed_dfa();
+    for(const std::string& w : words){
+        if(lev.run(w) != (code_point_distance(q, w) <= error)) return false;
+    }
+    return true;
+}
+
+// The (decoded) words of a remapped dictionary within the error of the query, by a walk with the automaton.
+std::vector<std::string> search(const std::vector<std::string>& words, const std::string& q, int error){
+    trie t;
+    for(const std::string& w : words) t.insert(w);
+    DFA<ll, char> compressed = t.compress_dfa();
+    alphabet_map am(compressed.get_alphabet());
+    am.apply(compressed);
+    dawg d; d.build(compressed);
+    DFA<ll, char> lev = utf8_levenshtein_nfa(q, error, am).convert_to_compressed_dfa();
+    match_iterator<DFA<ll, char> > matches(d, lev);
+    std::vector<std::string> ret;
+    std::string w; ll state;
+    while(matches.next(w, state)) ret.push_back(am.decode(w));
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+void run_test_suite(){
+    std::cout << "Testing the code points of a string:\n";
+    run_test([](){return utf8_code_points("a\xC3\xA9\xE2\x82\xAC").size();}, (size_t) 3);
+    run_test([](){return utf8_code_points("\xF0\x9D\x84\x9E");}, std::vector<std::string>{"\xF0\x9D\x84\x9E"});
+    run_test([](){return utf8_code_points("\xC3" "a\x80");}, std::vector<std::string>{"\xC3" CM "a" CM "\x80"});
+    run_test([](){return utf8_code_points("\xE2\x82");}, std::vector<std::string>{"\xE2" CM "\x82"}); // cut short
+    run_test([](){return utf8_code_points("");}, std::vector<std::string>{});
+
+    std::cout << "\nTesting the errors of the automaton:\n";
+    run_test([](){ // one error for an accented letter (two bytes)
+        DFA<ll CM char> lev = utf8_levenshtein_nfa("caf\xC3\xA9" CM 1).convert_to_compressed_dfa();
+        return lev.run(std::string("cafe")) && lev.run(std::string("caf\xC3\xA8")) && lev.run(std::string("caf"))
+            && !lev.run(std::string("ca"));
+    }, true);
+    run_test([](){ // the byte automaton needs two
+        DFA<ll CM char> lev = levenshtein_nfa("caf\xC3\xA9" CM 1).convert_to_compressed_dfa();
+        return lev.run(std::string("cafe"));
+    }, false);
+    run_test([](){ // a 4 byte code point is inserted with one error
+        DFA<ll CM char> lev = utf8_levenshtein_nfa("ab" CM 1).convert_to_compressed_dfa();
+        return lev.run(std::string("a\xF0\x9D\x84\x9E" "b")) && !lev.run(std::string("a\xF0\x9D\x84\x9E\xC3\xA9" "b"));
+    }, true);
+    run_test([](){ // only whole code points are read
+        DFA<ll CM char> lev = utf8_levenshtein_nfa("\xE2\x82\xAC" CM 0).convert_to_compressed_dfa();
+        return lev.run(std::string("\xE2\x82"));
+    }, false);
+    std::mt19937 rng(11);
+    std::vector<std::string> words;
+    for(int i = 0; i < 300; ++i) words.push_back(random_word(rng, 5));
+    for(int i = 0; i < 12; ++i){
+        std::string q = random_word(rng, 4);
+        int error = rng() % 3;
+        run_assert([&words CM q CM error](){return same_as_distance(q CM error CM words);});
+    }
+    run_test([](){ // ASCII is searched as before
+        std::vector<std::string> ascii = {"cat" CM "cart" CM "at" CM "dog" CM "cats" CM "ca"};
+        DFA<ll CM char> a = utf8_levenshtein_nfa("cat" CM 1).convert_to_compressed_dfa();
+        DFA<ll CM char> b = levenshtein_nfa("cat" CM 1).convert_to_compressed_dfa();
+        for(const std::string& w : ascii) if(a.run(w) != b.run(w)) return false;
+        return true;
+    }, true);
+
+    std::cout << "\nTesting a search of a remapped dictionary:\n";
+    std::vector<std::string> dict = {"caf\xC3\xA9", "cafe", "caff\xC3\xA8", "stra\xC3\x9F" "e", "strasse", "\xE2\x82\xAC" "10"};
+    run_test([&dict](){return search(dict CM "caf\xC3\xA8" CM 1);},
+        std::vector<std::string>{"cafe" CM "caff\xC3\xA8" CM "caf\xC3\xA9"});
+    run_test([&dict](){return search(dict CM "strase" CM 1);},
+        std::vector<std::string>{"strasse" CM "stra\xC3\x9F" "e"});
+    run_test([&dict](){return search(dict CM "$10" CM 1);}, std::vector<std::string>{"\xE2\x82\xAC" "10"});
+    run_test([&dict](){return search(dict CM "caf\xC3\xA9" CM 0);}, std::vector<std::string>{"caf\xC3\xA9"});
+
+    print_test_results();
+}
+
+int main(){
+    run_test_suite();
+}